@@ -21,6 +21,9 @@ SET C_FLAGS=/std:c17 /experimental:c11atomics /GR- /nologo /Gm- /WX /Wall ^
 IF %CONFIG%==D SET C_FLAGS=%C_FLAGS% /GS /Zi /Od /D"_DEBUG" /MTd /RTCs
 IF %CONFIG%==R SET C_FLAGS=%C_FLAGS% /O2 /Gy /MT /D"NDEBUG" /Oi /Ot /GS-
 
+:: Every SIMD contact solver is compiled in, box2d picks one at runtime.
+SET BOX2D_FLAGS=/D"BOX2D_ENABLE_SIMD"
+
 SET LINK_FLAGS=/INCREMENTAL:NO /NOLOGO /NOIMPLIB /NOEXP
 IF %CONFIG%==D SET LINK_FLAGS=%LINK_FLAGS% /DEBUG:FULL
 IF %CONFIG%==R SET LINK_FLAGS=%LINK_FLAGS%
@@ -99,7 +102,7 @@ IF NOT EXIST nuklear.lib (
 :: Box2D
 ::
 IF NOT EXIST box2d.lib (
-  %CC% %C_FLAGS% /Fd:"box2d.pdb" /c "src\deps\box2d\src\*.c" ^
+  %CC% %C_FLAGS% %BOX2D_FLAGS% /Fd:"box2d.pdb" /c "src\deps\box2d\src\*.c" ^
   /W3 /wd4242 /wd4244 /wd4018
 
   lib %LIB_FLAGS% "*.obj" /OUT:"box2d.lib"
@@ -127,6 +130,22 @@ IF NOT EXIST pch.lib (
     /c "src\pch\pch.c"
 ) & if ERRORLEVEL 1 GOTO error
 
+::
+:: Headless physics runner (no window, GPU or audio)
+::
+IF "%1"=="headless" (
+  IF EXIST "%NAME%_headless.exe" DEL "%NAME%_headless.exe"
+
+  %CC% %C_FLAGS% /Fd:"headless.pdb" /Fe:"%NAME%_headless.exe" ^
+    "src\headless\*.c" "src\phy.c" "src\obj.c" "src\prof.c" "src\trace.c" "src\cpu.c" ^
+    "src\scn.c" "src\pch\pch.c" ^
+    /link %LINK_FLAGS% box2d.lib enkits.lib
+
+  IF EXIST "*.obj" DEL "*.obj"
+
+  GOTO end
+) & if ERRORLEVEL 1 GOTO error
+
 ::
 :: Game
 ::
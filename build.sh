@@ -0,0 +1,78 @@
+#!/bin/sh
+#
+# Linux build of the headless physics runner (no window, GPU or audio).
+# The game itself is Windows only, see build.bat.
+#
+set -e
+
+NAME=cgame_headless
+
+# (D)ebug, (R)elease
+CONFIG=${CONFIG:-R}
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+OUT_DIR=build/linux
+
+C_FLAGS="-std=gnu17 -Wall -Wextra -fno-strict-aliasing \
+  -Isrc \
+  -Isrc/pch \
+  -Isrc/deps \
+  -Isrc/deps/nuklear \
+  -Isrc/deps/box2d/include \
+  -Isrc/deps/enkits"
+CXX_FLAGS="-std=c++11 -Wall"
+
+if [ "$CONFIG" = "D" ]; then
+  C_FLAGS="$C_FLAGS -g -O0 -D_DEBUG"
+  CXX_FLAGS="$CXX_FLAGS -g -O0 -D_DEBUG"
+else
+  C_FLAGS="$C_FLAGS -O2 -DNDEBUG"
+  CXX_FLAGS="$CXX_FLAGS -O2 -DNDEBUG"
+fi
+
+# Every SIMD contact solver is compiled in, box2d picks one at runtime.
+BOX2D_FLAGS="-DBOX2D_ENABLE_SIMD"
+
+if [ "$1" = "clean" ]; then
+  rm -rf "$OUT_DIR"
+fi
+
+mkdir -p "$OUT_DIR"
+
+#
+# Box2D
+#
+if [ ! -f "$OUT_DIR/libbox2d.a" ]; then
+  mkdir -p "$OUT_DIR/box2d"
+  for f in src/deps/box2d/src/*.c; do
+    $CC $C_FLAGS $BOX2D_FLAGS -w -c "$f" -o "$OUT_DIR/box2d/$(basename "$f" .c).o"
+  done
+  ar rcs "$OUT_DIR/libbox2d.a" "$OUT_DIR"/box2d/*.o
+  rm -rf "$OUT_DIR/box2d"
+fi
+
+#
+# enkiTS
+#
+if [ ! -f "$OUT_DIR/libenkits.a" ]; then
+  mkdir -p "$OUT_DIR/enkits"
+  $CXX $CXX_FLAGS -w -c src/deps/enkits/TaskScheduler.cpp \
+    -o "$OUT_DIR/enkits/TaskScheduler.o"
+  $CXX $CXX_FLAGS -w -c src/deps/enkits/TaskScheduler_c.cpp \
+    -o "$OUT_DIR/enkits/TaskScheduler_c.o"
+  ar rcs "$OUT_DIR/libenkits.a" "$OUT_DIR"/enkits/*.o
+  rm -rf "$OUT_DIR/enkits"
+fi
+
+#
+# Headless runner
+#
+$CC $C_FLAGS -o "$OUT_DIR/$NAME" \
+  src/headless/*.c src/phy.c src/obj.c src/prof.c src/trace.c src/cpu.c \
+  src/scn.c src/pch/pch.c \
+  -L"$OUT_DIR" -lbox2d -lenkits -lstdc++ -lpthread -lm
+
+if [ "$1" = "run" ]; then
+  shift
+  "$OUT_DIR/$NAME" "$@"
+fi
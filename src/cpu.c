@@ -0,0 +1,347 @@
+#include "pch.h"
+#include "cpu.h"
+
+static int
+compare_cores(const void *a, const void *b)
+{
+  const CpuCore *ca = (const CpuCore *)a;
+  const CpuCore *cb = (const CpuCore *)b;
+  if (ca->efficiency_class != cb->efficiency_class)
+    return ca->efficiency_class > cb->efficiency_class ? -1 : 1;
+  return (ca->first_logical > cb->first_logical) -
+    (ca->first_logical < cb->first_logical);
+}
+
+static void
+finish_topology(CpuTopology *topo)
+{
+  qsort(topo->cores, topo->num_cores, sizeof(CpuCore), compare_cores);
+
+  topo->num_performance_cores = 0;
+  topo->has_smt = false;
+  for (uint32_t i = 0; i < topo->num_cores; ++i) {
+    const CpuCore *core = &topo->cores[i];
+    if (core->efficiency_class == topo->cores[0].efficiency_class)
+      topo->num_performance_cores += 1;
+    if (core->num_logical > 1)
+      topo->has_smt = true;
+  }
+  topo->is_hybrid = topo->num_performance_cores < topo->num_cores;
+}
+
+static void
+fallback_topology(CpuTopology *topo, uint32_t num_logical)
+{
+  *topo = (CpuTopology){0};
+  if (num_logical == 0) num_logical = 1;
+  if (num_logical > CPU_MAX_CORES) num_logical = CPU_MAX_CORES;
+
+  topo->num_logical = num_logical;
+  topo->num_cores = num_logical;
+  for (uint32_t i = 0; i < num_logical; ++i) {
+    topo->cores[i] = (CpuCore){ .first_logical = i, .num_logical = 1 };
+  }
+  finish_topology(topo);
+}
+
+#if defined(_WIN32)
+
+typedef struct CpuCacheInfo
+{
+  CpuCache cache;
+  GROUP_AFFINITY affinity;
+} CpuCacheInfo;
+
+static uint32_t
+count_bits(uint64_t mask)
+{
+  uint32_t count = 0;
+  for (; mask; mask &= mask - 1) count += 1;
+  return count;
+}
+
+static uint32_t
+lowest_bit(uint64_t mask)
+{
+  assert(mask != 0);
+  uint32_t index = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    index += 1;
+  }
+  return index;
+}
+
+bool
+cpu_get_topology(CpuTopology *topo)
+{
+  assert(topo);
+  *topo = (CpuTopology){0};
+
+  DWORD size = 0;
+  GetLogicalProcessorInformationEx(RelationAll, NULL, &size);
+  if (size == 0) {
+    fallback_topology(topo, GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+    return false;
+  }
+
+  uint8_t *buffer = M_ALLOC(size);
+  if (!GetLogicalProcessorInformationEx(RelationAll,
+    (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)buffer, &size))
+  {
+    M_FREE(buffer);
+    fallback_topology(topo, GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+    return false;
+  }
+
+  // Caches are reported for every core, keep them with their affinity and
+  // pick the ones of the fastest core once cores are sorted.
+  CpuCacheInfo *caches = NULL;
+
+  for (DWORD offset = 0; offset < size;) {
+    const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *info =
+      (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buffer + offset);
+    offset += info->Size;
+
+    if (info->Relationship == RelationProcessorCore) {
+      const PROCESSOR_RELATIONSHIP *pr = &info->Processor;
+      const GROUP_AFFINITY *ga = &pr->GroupMask[0];
+      if (topo->num_cores == CPU_MAX_CORES || ga->Mask == 0) continue;
+
+      topo->cores[topo->num_cores++] = (CpuCore){
+        .first_logical = ga->Group * 64 + lowest_bit(ga->Mask),
+        .num_logical = count_bits(ga->Mask),
+        .efficiency_class = pr->EfficiencyClass,
+      };
+      topo->num_logical += count_bits(ga->Mask);
+    } else if (info->Relationship == RelationCache) {
+      const CACHE_RELATIONSHIP *cr = &info->Cache;
+      if (cr->Type == CacheTrace) continue;
+
+      CpuCacheType type = CpuCacheType_Unified;
+      if (cr->Type == CacheInstruction) type = CpuCacheType_Instruction;
+      else if (cr->Type == CacheData) type = CpuCacheType_Data;
+
+      arrpush(caches, ((CpuCacheInfo){
+        .cache = {
+          .level = cr->Level,
+          .type = type,
+          .size = cr->CacheSize,
+          .line_size = cr->LineSize,
+          .num_shared_logical = count_bits(cr->GroupMask.Mask),
+        },
+        .affinity = cr->GroupMask,
+      }));
+    }
+  }
+  M_FREE(buffer);
+
+  if (topo->num_cores == 0) {
+    arrfree(caches);
+    fallback_topology(topo, GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+    return false;
+  }
+  finish_topology(topo);
+
+  uint32_t group = topo->cores[0].first_logical / 64;
+  uint64_t bit = 1ull << (topo->cores[0].first_logical % 64);
+  for (size_t i = 0; i < arrlenu(caches); ++i) {
+    if (topo->num_caches == CPU_MAX_CACHES) break;
+    if (caches[i].affinity.Group == group && (caches[i].affinity.Mask & bit))
+      topo->caches[topo->num_caches++] = caches[i].cache;
+  }
+  arrfree(caches);
+  return true;
+}
+
+bool
+cpu_pin_current_thread(uint32_t logical)
+{
+  GROUP_AFFINITY affinity = {
+    .Mask = (KAFFINITY)1 << (logical % 64),
+    .Group = (WORD)(logical / 64),
+  };
+  if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL)) {
+    LOG("[cpu] Failed to pin thread to logical processor %u.", logical);
+    return false;
+  }
+  return true;
+}
+
+#else // Linux
+
+static bool
+read_sysfs(const char *path, char *text, size_t text_size)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return false;
+
+  size_t len = fread(text, 1, text_size - 1, file);
+  fclose(file);
+
+  while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == ' ')) len -= 1;
+  text[len] = '\0';
+  return len > 0;
+}
+
+// Parses a sysfs cpu list ("0-3,8,10-11"), returns the number of cpus.
+static uint32_t
+parse_cpu_list(const char *list, uint32_t *cpus, uint32_t max_cpus)
+{
+  uint32_t count = 0;
+  const char *it = list;
+
+  while (*it) {
+    char *end;
+    uint32_t first = (uint32_t)strtoul(it, &end, 10);
+    uint32_t last = first;
+    if (end == it) break;
+    if (*end == '-') {
+      it = end + 1;
+      last = (uint32_t)strtoul(it, &end, 10);
+    }
+    for (uint32_t cpu = first; cpu <= last && count < max_cpus; ++cpu) {
+      cpus[count++] = cpu;
+    }
+    if (*end != ',') break;
+    it = end + 1;
+  }
+  return count;
+}
+
+static bool
+cpu_list_contains(const char *list, uint32_t cpu)
+{
+  uint32_t cpus[CPU_MAX_CORES];
+  uint32_t num_cpus = parse_cpu_list(list, cpus, _countof(cpus));
+  for (uint32_t i = 0; i < num_cpus; ++i) {
+    if (cpus[i] == cpu) return true;
+  }
+  return false;
+}
+
+static uint32_t
+parse_cache_size(const char *text)
+{
+  char *end;
+  uint32_t size = (uint32_t)strtoul(text, &end, 10);
+  if (*end == 'K') size *= 1024;
+  else if (*end == 'M') size *= 1024 * 1024;
+  return size;
+}
+
+bool
+cpu_get_topology(CpuTopology *topo)
+{
+  assert(topo);
+  *topo = (CpuTopology){0};
+
+  char text[1024];
+  uint32_t online[CPU_MAX_CORES];
+  uint32_t num_online = 0;
+  if (read_sysfs("/sys/devices/system/cpu/online", text, sizeof(text)))
+    num_online = parse_cpu_list(text, online, _countof(online));
+
+  if (num_online == 0) {
+    fallback_topology(topo, (uint32_t)sysconf(_SC_NPROCESSORS_ONLN));
+    return false;
+  }
+
+  // Intel hybrid CPUs list E-cores here, ARM big.LITTLE reports per-cpu
+  // capacity (1024 for the fastest cores) instead.
+  char atom_cpus[1024];
+  bool has_atom = read_sysfs("/sys/devices/cpu_atom/cpus", atom_cpus,
+    sizeof(atom_cpus));
+
+  for (uint32_t i = 0; i < num_online; ++i) {
+    uint32_t cpu = online[i];
+    char path[256];
+    uint32_t siblings[CPU_MAX_CORES];
+    topo->num_logical += 1;
+
+    snprintf(path, sizeof(path),
+      "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+    if (!read_sysfs(path, text, sizeof(text)))
+      snprintf(text, sizeof(text), "%u", cpu);
+
+    // Core is recorded by its first sibling only.
+    uint32_t num_siblings = parse_cpu_list(text, siblings, _countof(siblings));
+    if (num_siblings == 0 || siblings[0] != cpu) continue;
+    if (topo->num_cores == CPU_MAX_CORES) continue;
+
+    uint32_t efficiency_class = 0;
+    if (has_atom) {
+      efficiency_class = cpu_list_contains(atom_cpus, cpu) ? 0 : 1;
+    } else {
+      char capacity[32];
+      snprintf(path, sizeof(path),
+        "/sys/devices/system/cpu/cpu%u/cpu_capacity", cpu);
+      if (read_sysfs(path, capacity, sizeof(capacity)))
+        efficiency_class = (uint32_t)strtoul(capacity, NULL, 10);
+    }
+
+    topo->cores[topo->num_cores++] = (CpuCore){
+      .first_logical = cpu,
+      .num_logical = num_siblings,
+      .efficiency_class = efficiency_class,
+    };
+  }
+
+  if (topo->num_cores == 0) {
+    fallback_topology(topo, topo->num_logical);
+    return false;
+  }
+  finish_topology(topo);
+
+  for (uint32_t i = 0; i < CPU_MAX_CACHES; ++i) {
+    char path[256];
+    char dir[128];
+    snprintf(dir, sizeof(dir), "/sys/devices/system/cpu/cpu%u/cache/index%u",
+      topo->cores[0].first_logical, i);
+
+    snprintf(path, sizeof(path), "%s/level", dir);
+    if (!read_sysfs(path, text, sizeof(text))) break;
+
+    CpuCache *cache = &topo->caches[topo->num_caches++];
+    cache->level = (uint32_t)strtoul(text, NULL, 10);
+
+    snprintf(path, sizeof(path), "%s/type", dir);
+    cache->type = CpuCacheType_Unified;
+    if (read_sysfs(path, text, sizeof(text))) {
+      if (strcmp(text, "Data") == 0) cache->type = CpuCacheType_Data;
+      else if (strcmp(text, "Instruction") == 0)
+        cache->type = CpuCacheType_Instruction;
+    }
+
+    snprintf(path, sizeof(path), "%s/size", dir);
+    if (read_sysfs(path, text, sizeof(text)))
+      cache->size = parse_cache_size(text);
+
+    snprintf(path, sizeof(path), "%s/coherency_line_size", dir);
+    if (read_sysfs(path, text, sizeof(text)))
+      cache->line_size = (uint32_t)strtoul(text, NULL, 10);
+
+    snprintf(path, sizeof(path), "%s/shared_cpu_list", dir);
+    if (read_sysfs(path, text, sizeof(text))) {
+      uint32_t shared[CPU_MAX_CORES];
+      cache->num_shared_logical = parse_cpu_list(text, shared,
+        _countof(shared));
+    }
+  }
+  return true;
+}
+
+bool
+cpu_pin_current_thread(uint32_t logical)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(logical, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    LOG("[cpu] Failed to pin thread to logical processor %u.", logical);
+    return false;
+  }
+  return true;
+}
+
+#endif
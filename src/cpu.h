@@ -0,0 +1,51 @@
+#pragma once
+
+#define CPU_MAX_CORES 256
+#define CPU_MAX_CACHES 8
+
+typedef enum CpuCacheType
+{
+  CpuCacheType_Unified,
+  CpuCacheType_Instruction,
+  CpuCacheType_Data,
+} CpuCacheType;
+
+typedef struct CpuCache
+{
+  uint32_t level;
+  CpuCacheType type;
+  uint32_t size; // bytes
+  uint32_t line_size;
+  uint32_t num_shared_logical; // logical processors sharing the cache
+} CpuCache;
+
+typedef struct CpuCore
+{
+  uint32_t first_logical; // group * 64 + index on Windows
+  uint32_t num_logical; // > 1 with SMT
+  uint32_t efficiency_class; // higher is faster, only compared between cores
+} CpuCore;
+
+typedef struct CpuTopology
+{
+  uint32_t num_logical;
+  uint32_t num_cores;
+  uint32_t num_performance_cores; // cores of the highest efficiency class
+  bool is_hybrid;
+  bool has_smt;
+
+  // Sorted by efficiency class (fastest first), then by logical processor.
+  CpuCore cores[CPU_MAX_CORES];
+
+  // Caches seen by `cores[0]`.
+  uint32_t num_caches;
+  CpuCache caches[CPU_MAX_CACHES];
+} CpuTopology;
+
+/// Probes physical cores, SMT siblings, core types (P/E cores) and caches.
+/// When the OS query fails every logical processor is reported as a core and
+/// false is returned.
+bool cpu_get_topology(CpuTopology *topo);
+
+/// Pins the calling thread to logical processor `logical`.
+bool cpu_pin_current_thread(uint32_t logical);
@@ -66,6 +66,17 @@ B2_API int b2GetByteCount( void );
 /// @param assertFcn a non-null assert callback
 B2_API void b2SetAssertFcn( b2AssertFcn* assertFcn );
 
+/// Prototype for the start of a profiler zone on the calling thread. Zones nest and
+/// `name` is a string literal, e.g. "Collide Task" or a solver stage.
+typedef void b2TraceBeginFcn( const char* name );
+
+/// Prototype for the end of the innermost profiler zone of the calling thread.
+typedef void b2TraceEndFcn( void );
+
+/// Receive the profiler zones of tasks and step stages, e.g. for a timeline. Called from every
+/// worker, so both must be thread-safe. Pass NULL to stop. Ignored when built with Tracy.
+B2_API void b2SetTraceFcns( b2TraceBeginFcn* beginFcn, b2TraceEndFcn* endFcn );
+
 /// Version numbering scheme.
 /// See https://semver.org/
 typedef struct b2Version
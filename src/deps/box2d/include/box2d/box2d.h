@@ -111,6 +111,10 @@ B2_API void b2World_EnableContinuous( b2WorldId worldId, bool flag );
 /// Is continuous collision enabled?
 B2_API bool b2World_IsContinuousEnabled( b2WorldId worldId );
 
+/// Enable/disable the per-step state checksum
+/// @see b2World_GetChecksum
+B2_API void b2World_EnableChecksum( b2WorldId worldId, bool flag );
+
 /// Adjust the restitution threshold. It is recommended not to make this value very small
 /// because it will prevent bodies from sleeping. Typically in meters per second.
 /// @see b2WorldDef
@@ -177,9 +181,33 @@ B2_API bool b2World_IsWarmStartingEnabled( b2WorldId worldId );
 /// Get the current world performance profile
 B2_API b2Profile b2World_GetProfile( b2WorldId worldId );
 
+/// Get the checksum of the last step, zero when checksums are disabled or no body is awake. It covers the
+/// transform and velocity of every awake body and the impulses of every solved contact, taken after the
+/// solver and before continuous collision. Compare it between machines to detect a desync.
+/// The simulation and the checksum are bit-identical for any worker count and any contact solver SIMD
+/// type of the same build. They are not guaranteed to match between compilers, compiler flags or CPU
+/// families, which may differ in floating point contraction and rounding.
+B2_API uint64_t b2World_GetChecksum( b2WorldId worldId );
+
 /// Get world counters and sizes
 B2_API b2Counters b2World_GetCounters( b2WorldId worldId );
 
+/// Get the instruction set used by the contact solver of this world
+B2_API b2SIMDType b2World_GetSIMDType( b2WorldId worldId );
+
+/// Get the number of bytes b2World_SaveState needs for the current state of the world
+B2_API int b2World_GetStateSize( b2WorldId worldId );
+
+/// Copy the simulation state (bodies, shapes, joints, contacts, solver sets, constraint graph, broad-phase trees,
+/// id pools and the events of the last step) into `buffer` for rollback. Returns the number of bytes written, or
+/// zero if `capacity` is too small. The state is raw memory of this world and only valid for this world and build.
+B2_API int b2World_SaveState( b2WorldId worldId, void* buffer, int capacity );
+
+/// Restore a state written by b2World_SaveState on this world. Existing allocations are reused and only grown
+/// when the saved state is larger. Ids created after the save become invalid and ids destroyed after the save
+/// become valid again. Returns false if the buffer is not a state of this world.
+B2_API bool b2World_RestoreState( b2WorldId worldId, const void* buffer, int size );
+
 /// Dump memory stats to box2d_memory.txt
 B2_API void b2World_DumpMemoryStats( b2WorldId worldId );
 
@@ -864,6 +892,12 @@ B2_API float b2MouseJoint_GetMaxForce( b2JointId jointId );
 /// @see b2PrismaticJointDef for details
 B2_API b2JointId b2CreatePrismaticJoint( b2WorldId worldId, const b2PrismaticJointDef* def );
 
+/// Get the prismatic joint translation axis in the local frame of body A, normalized
+B2_API b2Vec2 b2PrismaticJoint_GetLocalAxisA( b2JointId jointId );
+
+/// Get the prismatic joint reference angle in radians
+B2_API float b2PrismaticJoint_GetReferenceAngle( b2JointId jointId );
+
 /// Enable/disable the joint spring.
 B2_API void b2PrismaticJoint_EnableSpring( b2JointId jointId, bool enableSpring );
 
@@ -935,6 +969,9 @@ B2_API float b2PrismaticJoint_GetMotorForce( b2JointId jointId );
 /// @see b2RevoluteJointDef for details
 B2_API b2JointId b2CreateRevoluteJoint( b2WorldId worldId, const b2RevoluteJointDef* def );
 
+/// Get the revolute joint reference angle in radians
+B2_API float b2RevoluteJoint_GetReferenceAngle( b2JointId jointId );
+
 /// Enable/disable the revolute joint spring
 B2_API void b2RevoluteJoint_EnableSpring( b2JointId jointId, bool enableSpring );
 
@@ -1056,6 +1093,9 @@ B2_API float b2WeldJoint_GetAngularDampingRatio( b2JointId jointId );
 /// @see b2WheelJointDef for details
 B2_API b2JointId b2CreateWheelJoint( b2WorldId worldId, const b2WheelJointDef* def );
 
+/// Get the wheel joint suspension axis in the local frame of body A, normalized
+B2_API b2Vec2 b2WheelJoint_GetLocalAxisA( b2JointId jointId );
+
 /// Enable/disable the wheel joint spring
 B2_API void b2WheelJoint_EnableSpring( b2JointId jointId, bool enableSpring );
 
@@ -644,6 +644,9 @@ typedef struct b2TreeNode
 	char pad[5];
 } b2TreeNode;
 
+/// Four-wide tree node used by queries. This should be considered private data.
+typedef struct b2WideTreeNode b2WideTreeNode;
+
 /// The dynamic tree structure. This should be considered private data.
 /// It is placed here for performance reasons.
 typedef struct b2DynamicTree
@@ -669,6 +672,9 @@ typedef struct b2DynamicTree
 	/// Leaf indices for rebuild
 	int32_t* leafIndices;
 
+	/// Internal node indices for rebuild, in build order
+	int32_t* rebuildNodes;
+
 	/// Leaf bounding boxes for rebuild
 	b2AABB* leafBoxes;
 
@@ -680,6 +686,21 @@ typedef struct b2DynamicTree
 
 	/// Allocated space for rebuilding
 	int32_t rebuildCapacity;
+
+	/// Four-wide copy of the tree for queries, see b2DynamicTree_BuildWide
+	b2WideTreeNode* wideNodes;
+
+	/// The number of wide nodes, zero when the wide tree does not match the tree
+	int32_t wideNodeCount;
+
+	/// The allocated wide node space
+	int32_t wideNodeCapacity;
+
+	/// Wide child slot of every node (4 * wide node + child), used to keep enlarged boxes in sync
+	int32_t* wideSlots;
+
+	/// Allocated space for wide slots
+	int32_t wideSlotCapacity;
 } b2DynamicTree;
 
 /// Constructing the tree initializes the node pool.
@@ -771,6 +792,11 @@ B2_API int b2DynamicTree_GetProxyCount( const b2DynamicTree* tree );
 /// Rebuild the tree while retaining subtrees that haven't changed. Returns the number of boxes sorted.
 B2_API int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild );
 
+/// Build a four-wide copy of the tree that queries, ray casts and shape casts use to test four child boxes at
+/// once. The copy follows enlarged proxies and is dropped when proxies are created, destroyed or moved. Results
+/// and their order are the same as for the binary tree.
+B2_API void b2DynamicTree_BuildWide( b2DynamicTree* tree );
+
 /// Shift the world origin. Useful for large worlds.
 /// The shift formula is: position -= newOrigin
 /// @param tree the tree to shift
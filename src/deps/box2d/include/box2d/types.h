@@ -42,6 +42,7 @@ typedef void b2TaskCallback( int32_t startIndex, int32_t endIndex, uint32_t work
 /// In general the range [startIndex, endIndex) send to b2TaskCallback should obey:
 /// endIndex - startIndex >= minRange
 /// The exception of course is when itemCount < minRange.
+/// Tasks may be enqueued and finished from inside a Box2D task, the broad-phase tree rebuild does this.
 /// @ingroup world
 typedef void* b2EnqueueTaskCallback( b2TaskCallback* task, int32_t itemCount, int32_t minRange, void* taskContext,
 									 void* userContext );
@@ -71,6 +72,29 @@ typedef enum b2MixingRule
 	b2_mixMaximum
 } b2MixingRule;
 
+/// Instruction set used by the contact solver. Box2D is built with all of them that apply to the
+/// target CPU family and picks one at runtime.
+typedef enum b2SIMDType
+{
+	/// The widest instruction set supported by the CPU
+	b2_simdDefault,
+	b2_simdNone,
+	b2_simdSSE2,
+	b2_simdNEON,
+	b2_simdAVX2,
+	b2_simdAVX512
+} b2SIMDType;
+
+/// Broad-phase structure for dynamic shapes. Static and kinematic shapes are always in a tree.
+typedef enum b2BroadPhaseType
+{
+	/// Dynamic AABB tree, works for any mix of shape sizes
+	b2_broadPhaseTree,
+
+	/// Hashed uniform grid, faster when most dynamic shapes are about the size of a grid cell
+	b2_broadPhaseGrid
+} b2BroadPhaseType;
+
 /// World definition used to create a simulation world.
 /// Must be initialized using b2DefaultWorldDef().
 /// @ingroup world
@@ -116,11 +140,34 @@ typedef struct b2WorldDef
 	/// Enable continuous collision
 	bool enableContinuous;
 
+	/// Compute a checksum of the awake state every step, see b2World_GetChecksum
+	bool enableChecksum;
+
+	/// Keep four-wide copies of the broad-phase trees for faster pair finding, queries and ray casts.
+	/// Results are the same either way, see b2DynamicTree_BuildWide.
+	bool enableWideTrees;
+
+	/// Broad-phase structure for dynamic shapes. Default is b2_broadPhaseTree.
+	b2BroadPhaseType broadPhaseType;
+
+	/// Cell size of the b2_broadPhaseGrid. Usually meters. Best when close to the typical shape size,
+	/// shapes spanning more than 16 cells are tested by every query.
+	float gridCellSize;
+
+	/// Contact solver instruction set, mostly for benchmarking. Falls back to the default when the
+	/// CPU doesn't support it.
+	b2SIMDType simdType;
+
 	/// Number of workers to use with the provided task system. Box2D performs best when using only
 	/// performance cores and accessing a single L2 cache. Efficiency cores and hyper-threading provide
 	/// little benefit and may even harm performance.
 	int32_t workerCount;
 
+	/// Number of workers running the constraint solver stages, 0 uses workerCount. Solver workers spin
+	/// while waiting on each other, so worlds stepped concurrently on a shared task system should use 1
+	/// and rely on the other parallel-for tasks.
+	int32_t solverWorkerCount;
+
 	/// Function to spawn tasks
 	b2EnqueueTaskCallback* enqueueTask;
 
@@ -461,11 +508,21 @@ typedef struct b2Counters
 	int32_t jointCount;
 	int32_t islandCount;
 	int32_t stackUsed;
+
+	/// Scratch bytes the workers allocated in the last step and the total capacity of the worker arenas.
+	/// The arenas grow to the high water mark when the usage exceeds the capacity.
+	int32_t arenaUsed;
+	int32_t arenaCapacity;
+
 	int32_t staticTreeHeight;
 	int32_t treeHeight;
 	int32_t byteCount;
 	int32_t taskCount;
-	int32_t colorCounts[12];
+	int32_t colorCounts[24];
+
+	/// Constraints that did not fit the graph colors in the last step. These are solved on one thread.
+	int32_t overflowContactCount;
+	int32_t overflowJointCount;
 } b2Counters;
 //! @endcond
 
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "arena_allocator.h"
+
+#include "core.h"
+
+#include <stddef.h>
+
+// Header of a heap block, the item follows aligned to B2_ALIGNMENT
+typedef struct b2ArenaBlock
+{
+	b2ArenaBlock* next;
+	int size;
+} b2ArenaBlock;
+
+#define b2_arenaBlockHeaderSize ( ( ( (int)sizeof( b2ArenaBlock ) - 1 ) | ( B2_ALIGNMENT - 1 ) ) + 1 )
+
+b2ArenaAllocator b2CreateArenaAllocator( int capacity )
+{
+	B2_ASSERT( capacity >= 0 );
+	b2ArenaAllocator arena = { 0 };
+	arena.capacity = capacity;
+	arena.data = capacity > 0 ? b2Alloc( capacity ) : NULL;
+	arena.index = 0;
+	arena.allocation = 0;
+	arena.blocks = NULL;
+	return arena;
+}
+
+static void b2FreeArenaBlocks( b2ArenaAllocator* arena )
+{
+	b2ArenaBlock* block = arena->blocks;
+	while ( block != NULL )
+	{
+		b2ArenaBlock* next = block->next;
+		b2Free( block, block->size );
+		block = next;
+	}
+	arena->blocks = NULL;
+}
+
+void b2DestroyArenaAllocator( b2ArenaAllocator* arena )
+{
+	b2FreeArenaBlocks( arena );
+	if ( arena->data != NULL )
+	{
+		b2Free( arena->data, arena->capacity );
+	}
+	*arena = ( b2ArenaAllocator ){ 0 };
+}
+
+void* b2AllocateArenaItem( b2ArenaAllocator* arena, int size )
+{
+	// ensure allocation is aligned to support wide SIMD loads
+	int alignedSize = ( ( size - 1 ) | ( B2_ALIGNMENT - 1 ) ) + 1;
+	arena->allocation += alignedSize;
+
+	if ( arena->index + alignedSize > arena->capacity )
+	{
+		// fall back to the heap until the next reset
+		int blockSize = b2_arenaBlockHeaderSize + alignedSize;
+		b2ArenaBlock* block = b2Alloc( blockSize );
+		block->next = arena->blocks;
+		block->size = blockSize;
+		arena->blocks = block;
+
+		char* data = (char*)block + b2_arenaBlockHeaderSize;
+		B2_ASSERT( ( (uintptr_t)data & ( B2_ALIGNMENT - 1 ) ) == 0 );
+		return data;
+	}
+
+	char* data = arena->data + arena->index;
+	arena->index += alignedSize;
+
+	B2_ASSERT( ( (uintptr_t)data & ( B2_ALIGNMENT - 1 ) ) == 0 );
+	return data;
+}
+
+void b2ResetArena( b2ArenaAllocator* arena )
+{
+	if ( arena->blocks != NULL )
+	{
+		b2FreeArenaBlocks( arena );
+
+		if ( arena->allocation > arena->capacity )
+		{
+			if ( arena->data != NULL )
+			{
+				b2Free( arena->data, arena->capacity );
+			}
+
+			arena->capacity = arena->allocation + arena->allocation / 2;
+			arena->data = b2Alloc( arena->capacity );
+		}
+	}
+
+	arena->index = 0;
+	arena->allocation = 0;
+}
+
+int b2GetArenaCapacity( b2ArenaAllocator* arena )
+{
+	return arena->capacity;
+}
+
+int b2GetArenaAllocation( b2ArenaAllocator* arena )
+{
+	return arena->allocation;
+}
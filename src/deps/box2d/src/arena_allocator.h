@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+typedef struct b2ArenaBlock b2ArenaBlock;
+
+// Bump allocator for per worker scratch memory. Items are not freed individually, instead the whole
+// arena is reset at the start of every step. Unlike b2StackAllocator this doesn't require nesting, so
+// tasks can allocate without locks as long as each worker only uses its own arena.
+// When the capacity is exceeded the arena falls back to the heap until the next reset, which then
+// grows the arena to the high water mark.
+typedef struct b2ArenaAllocator
+{
+	char* data;
+	int capacity;
+	int index;
+
+	// Bytes allocated since the last reset, including heap blocks
+	int allocation;
+
+	// Heap blocks allocated since the last reset
+	b2ArenaBlock* blocks;
+} b2ArenaAllocator;
+
+b2ArenaAllocator b2CreateArenaAllocator( int capacity );
+void b2DestroyArenaAllocator( b2ArenaAllocator* arena );
+
+void* b2AllocateArenaItem( b2ArenaAllocator* arena, int size );
+
+// Release all items and grow the arena if it ran out of space
+void b2ResetArena( b2ArenaAllocator* arena );
+
+int b2GetArenaCapacity( b2ArenaAllocator* arena );
+int b2GetArenaAllocation( b2ArenaAllocator* arena );
@@ -171,4 +171,5 @@ B2_ARRAY_DECLARE( b2SensorBeginTouchEvent, b2SensorBeginTouchEvent );
 B2_ARRAY_DECLARE( b2SensorEndTouchEvent, b2SensorEndTouchEvent );
 B2_ARRAY_DECLARE( b2Shape, b2Shape );
 B2_ARRAY_DECLARE( b2SolverSet, b2SolverSet );
+B2_ARRAY_DECLARE( b2StateCopy, b2StateCopy );
 B2_ARRAY_DECLARE( b2TaskContext, b2TaskContext );
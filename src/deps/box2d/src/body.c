@@ -1377,7 +1377,7 @@ void b2Body_SetAwake( b2BodyId bodyId, bool awake )
 		if ( island->constraintRemoveCount > 0 )
 		{
 			// Must split the island before sleeping. This is expensive.
-			b2SplitIsland( world, body->islandId );
+			b2SplitIsland( world, body->islandId, &world->taskContexts.data[0].arena );
 		}
 
 		b2TrySleepIsland( world, body->islandId );
@@ -8,10 +8,12 @@
 #include "broad_phase.h"
 
 #include "aabb.h"
+#include "arena_allocator.h"
 #include "array.h"
 #include "body.h"
 #include "contact.h"
 #include "core.h"
+#include "dynamic_tree.h"
 #include "shape.h"
 #include "stack_allocator.h"
 #include "world.h"
@@ -24,7 +26,7 @@
 
 // static FILE* s_file = NULL;
 
-void b2CreateBroadPhase( b2BroadPhase* bp )
+void b2CreateBroadPhase( b2BroadPhase* bp, const b2WorldDef* def )
 {
 	_Static_assert( b2_bodyTypeCount == 3, "must be three body types" );
 
@@ -39,14 +41,22 @@ void b2CreateBroadPhase( b2BroadPhase* bp )
 	bp->moveArray = b2IntArray_Create( 16 );
 	bp->moveResults = NULL;
 	bp->movePairs = NULL;
+	bp->newContactIds = NULL;
 	bp->movePairCapacity = 0;
 	bp->movePairIndex = 0;
 	bp->pairSet = b2CreateSet( 32 );
+	bp->enableWideTrees = def->enableWideTrees;
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
 		bp->trees[i] = b2DynamicTree_Create();
 	}
+
+	bp->useDynamicGrid = def->broadPhaseType == b2_broadPhaseGrid;
+	if ( bp->useDynamicGrid )
+	{
+		bp->dynamicGrid = b2ProxyGrid_Create( def->gridCellSize );
+	}
 }
 
 void b2DestroyBroadPhase( b2BroadPhase* bp )
@@ -56,6 +66,11 @@ void b2DestroyBroadPhase( b2BroadPhase* bp )
 		b2DynamicTree_Destroy( bp->trees + i );
 	}
 
+	if ( bp->useDynamicGrid )
+	{
+		b2ProxyGrid_Destroy( &bp->dynamicGrid );
+	}
+
 	b2DestroySet( &bp->moveSet );
 	b2IntArray_Destroy( &bp->moveArray );
 	b2DestroySet( &bp->pairSet );
@@ -69,6 +84,31 @@ void b2DestroyBroadPhase( b2BroadPhase* bp )
 	// }
 }
 
+static inline bool b2IsGridProxy( const b2BroadPhase* bp, b2BodyType proxyType )
+{
+	return proxyType == b2_dynamicBody && bp->useDynamicGrid;
+}
+
+static inline b2AABB b2GetProxyAABB( const b2BroadPhase* bp, b2BodyType proxyType, int proxyId )
+{
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		return b2ProxyGrid_GetAABB( &bp->dynamicGrid, proxyId );
+	}
+
+	return b2DynamicTree_GetAABB( bp->trees + proxyType, proxyId );
+}
+
+static inline int b2GetProxyUserData( const b2BroadPhase* bp, b2BodyType proxyType, int proxyId )
+{
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		return b2ProxyGrid_GetUserData( &bp->dynamicGrid, proxyId );
+	}
+
+	return b2DynamicTree_GetUserData( bp->trees + proxyType, proxyId );
+}
+
 static inline void b2UnBufferMove( b2BroadPhase* bp, int proxyKey )
 {
 	bool found = b2RemoveKey( &bp->moveSet, proxyKey + 1 );
@@ -93,7 +133,16 @@ int b2BroadPhase_CreateProxy( b2BroadPhase* bp, b2BodyType proxyType, b2AABB aab
 							  bool forcePairCreation )
 {
 	B2_ASSERT( 0 <= proxyType && proxyType < b2_bodyTypeCount );
-	int proxyId = b2DynamicTree_CreateProxy( bp->trees + proxyType, aabb, categoryBits, shapeIndex );
+	int proxyId;
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		proxyId = b2ProxyGrid_CreateProxy( &bp->dynamicGrid, aabb, categoryBits, shapeIndex );
+	}
+	else
+	{
+		proxyId = b2DynamicTree_CreateProxy( bp->trees + proxyType, aabb, categoryBits, shapeIndex );
+	}
+
 	int proxyKey = B2_PROXY_KEY( proxyId, proxyType );
 	if ( proxyType != b2_staticBody || forcePairCreation )
 	{
@@ -113,7 +162,14 @@ void b2BroadPhase_DestroyProxy( b2BroadPhase* bp, int proxyKey )
 	int proxyId = B2_PROXY_ID( proxyKey );
 
 	B2_ASSERT( 0 <= proxyType && proxyType <= b2_bodyTypeCount );
-	b2DynamicTree_DestroyProxy( bp->trees + proxyType, proxyId );
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		b2ProxyGrid_DestroyProxy( &bp->dynamicGrid, proxyId );
+	}
+	else
+	{
+		b2DynamicTree_DestroyProxy( bp->trees + proxyType, proxyId );
+	}
 }
 
 void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
@@ -121,7 +177,15 @@ void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
 	b2BodyType proxyType = B2_PROXY_TYPE( proxyKey );
 	int proxyId = B2_PROXY_ID( proxyKey );
 
-	b2DynamicTree_MoveProxy( bp->trees + proxyType, proxyId, aabb );
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		b2ProxyGrid_MoveProxy( &bp->dynamicGrid, proxyId, aabb );
+	}
+	else
+	{
+		b2DynamicTree_MoveProxy( bp->trees + proxyType, proxyId, aabb );
+	}
+
 	b2BufferMove( bp, proxyKey );
 }
 
@@ -133,16 +197,88 @@ void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
 
 	B2_ASSERT( typeIndex != b2_staticBody );
 
-	b2DynamicTree_EnlargeProxy( bp->trees + typeIndex, proxyId, aabb );
+	if ( b2IsGridProxy( bp, typeIndex ) )
+	{
+		b2ProxyGrid_MoveProxy( &bp->dynamicGrid, proxyId, aabb );
+	}
+	else
+	{
+		b2DynamicTree_EnlargeProxy( bp->trees + typeIndex, proxyId, aabb );
+	}
+
 	b2BufferMove( bp, proxyKey );
 }
 
+void b2BroadPhase_EnlargeMovedProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
+{
+	B2_ASSERT( B2_PROXY_TYPE( proxyKey ) == b2_dynamicBody );
+	B2_ASSERT( b2ContainsKey( &bp->moveSet, proxyKey + 1 ) );
+	int proxyId = B2_PROXY_ID( proxyKey );
+
+	if ( bp->useDynamicGrid )
+	{
+		b2ProxyGrid_MoveProxy( &bp->dynamicGrid, proxyId, aabb );
+	}
+	else
+	{
+		b2DynamicTree_EnlargeProxy( bp->trees + b2_dynamicBody, proxyId, aabb );
+	}
+}
+
+void b2BroadPhase_Query( const b2BroadPhase* bp, b2BodyType proxyType, b2AABB aabb, uint64_t maskBits,
+						 b2TreeQueryCallbackFcn* callback, void* context )
+{
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		b2ProxyGrid_Query( &bp->dynamicGrid, aabb, maskBits, callback, context );
+	}
+	else
+	{
+		b2DynamicTree_Query( bp->trees + proxyType, aabb, maskBits, callback, context );
+	}
+}
+
+void b2BroadPhase_RayCast( const b2BroadPhase* bp, b2BodyType proxyType, const b2RayCastInput* input, uint64_t maskBits,
+						   b2TreeRayCastCallbackFcn* callback, void* context )
+{
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		b2ProxyGrid_RayCast( &bp->dynamicGrid, input, maskBits, callback, context );
+	}
+	else
+	{
+		b2DynamicTree_RayCast( bp->trees + proxyType, input, maskBits, callback, context );
+	}
+}
+
+void b2BroadPhase_ShapeCast( const b2BroadPhase* bp, b2BodyType proxyType, const b2ShapeCastInput* input,
+							 uint64_t maskBits, b2TreeShapeCastCallbackFcn* callback, void* context )
+{
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		b2ProxyGrid_ShapeCast( &bp->dynamicGrid, input, maskBits, callback, context );
+	}
+	else
+	{
+		b2DynamicTree_ShapeCast( bp->trees + proxyType, input, maskBits, callback, context );
+	}
+}
+
+int b2BroadPhase_GetByteCount( const b2BroadPhase* bp, b2BodyType proxyType )
+{
+	if ( b2IsGridProxy( bp, proxyType ) )
+	{
+		return b2ProxyGrid_GetByteCount( &bp->dynamicGrid );
+	}
+
+	return b2DynamicTree_GetByteCount( bp->trees + proxyType );
+}
+
 typedef struct b2MovePair
 {
 	int shapeIndexA;
 	int shapeIndexB;
 	b2MovePair* next;
-	bool heap;
 } b2MovePair;
 
 typedef struct b2MoveResult
@@ -154,6 +290,10 @@ typedef struct b2QueryPairContext
 {
 	b2World* world;
 	b2MoveResult* moveResult;
+
+	// Holds the pairs that don't fit in b2BroadPhase::movePairs
+	b2ArenaAllocator* arena;
+
 	b2BodyType queryTreeType;
 	int queryProxyKey;
 	int queryShapeIndex;
@@ -228,6 +368,12 @@ static bool b2PairQueryCallback( int proxyId, int shapeId, void* context )
 		return true;
 	}
 
+	// For example, no segment vs segment collision
+	if ( b2HasManifoldFunction( shapeA->type, shapeB->type ) == false )
+	{
+		return true;
+	}
+
 	// Does a joint override collision?
 	b2Body* bodyA = b2BodyArray_Get( &world->bodies, bodyIdA );
 	b2Body* bodyB = b2BodyArray_Get( &world->bodies, bodyIdB );
@@ -256,12 +402,10 @@ static bool b2PairQueryCallback( int proxyId, int shapeId, void* context )
 	if ( pairIndex < bp->movePairCapacity )
 	{
 		pair = bp->movePairs + pairIndex;
-		pair->heap = false;
 	}
 	else
 	{
-		pair = b2Alloc( sizeof( b2MovePair ) );
-		pair->heap = true;
+		pair = b2AllocateArenaItem( queryContext->arena, sizeof( b2MovePair ) );
 	}
 
 	pair->shapeIndexA = shapeIdA;
@@ -277,13 +421,12 @@ void b2FindPairsTask( int startIndex, int endIndex, uint32_t threadIndex, void*
 {
 	b2TracyCZoneNC( pair_task, "Pair Task", b2_colorAquamarine, true );
 
-	B2_MAYBE_UNUSED( threadIndex );
-
 	b2World* world = context;
 	b2BroadPhase* bp = &world->broadPhase;
 
 	b2QueryPairContext queryContext;
 	queryContext.world = world;
+	queryContext.arena = &world->taskContexts.data[threadIndex].arena;
 
 	for ( int i = startIndex; i < endIndex; ++i )
 	{
@@ -303,12 +446,10 @@ void b2FindPairsTask( int startIndex, int endIndex, uint32_t threadIndex, void*
 		int proxyId = B2_PROXY_ID( proxyKey );
 		queryContext.queryProxyKey = proxyKey;
 
-		const b2DynamicTree* baseTree = bp->trees + proxyType;
-
 		// We have to query the tree with the fat AABB so that
 		// we don't fail to create a contact that may touch later.
-		b2AABB fatAABB = b2DynamicTree_GetAABB( baseTree, proxyId );
-		queryContext.queryShapeIndex = b2DynamicTree_GetUserData( baseTree, proxyId );
+		b2AABB fatAABB = b2GetProxyAABB( bp, proxyType, proxyId );
+		queryContext.queryShapeIndex = b2GetProxyUserData( bp, proxyType, proxyId );
 
 		// Query trees. Only dynamic proxies collide with kinematic and static proxies.
 		// Using b2_defaultMaskBits so that b2Filter::groupIndex works.
@@ -325,16 +466,75 @@ void b2FindPairsTask( int startIndex, int endIndex, uint32_t threadIndex, void*
 		// All proxies collide with dynamic proxies
 		// Using b2_defaultMaskBits so that b2Filter::groupIndex works.
 		queryContext.queryTreeType = b2_dynamicBody;
-		b2DynamicTree_Query( bp->trees + b2_dynamicBody, fatAABB, b2_defaultMaskBits, b2PairQueryCallback, &queryContext );
+		b2BroadPhase_Query( bp, b2_dynamicBody, fatAABB, b2_defaultMaskBits, b2PairQueryCallback, &queryContext );
 	}
 
 	b2TracyCZoneEnd( pair_task );
 }
 
+// Adds the new pairs to the pair set. Every pair is found once, see b2PairQueryCallback, so
+// no key is added twice.
+static void b2InsertPairsTask( int startIndex, int endIndex, uint32_t threadIndex, void* context )
+{
+	b2TracyCZoneNC( insert_pairs, "Insert Pairs", b2_colorAquamarine, true );
+
+	B2_MAYBE_UNUSED( threadIndex );
+
+	b2World* world = context;
+	b2BroadPhase* bp = &world->broadPhase;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2MovePair* pair = bp->moveResults[i].pairList;
+		while ( pair != NULL )
+		{
+			uint64_t pairKey = B2_SHAPE_PAIR_KEY( pair->shapeIndexA, pair->shapeIndexB );
+			b2AddNewKeyConcurrent( &bp->pairSet, pairKey );
+			pair = pair->next;
+		}
+	}
+
+	b2TracyCZoneEnd( insert_pairs );
+}
+
+static void b2InitializeContactsTask( int startIndex, int endIndex, uint32_t threadIndex, void* context )
+{
+	b2TracyCZoneNC( initialize_contacts, "Initialize Contacts", b2_colorGold, true );
+
+	B2_MAYBE_UNUSED( threadIndex );
+
+	b2World* world = context;
+	const int* contactIds = world->broadPhase.newContactIds;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2InitializeContact( world, contactIds[i] );
+	}
+
+	b2TracyCZoneEnd( initialize_contacts );
+}
+
 void b2UpdateBroadPhasePairs( b2World* world )
 {
 	b2BroadPhase* bp = &world->broadPhase;
 
+	// The rebuild keeps the dynamic and kinematic wide trees current. This catches trees changed by the user, such as
+	// the static tree after bodies are created.
+	if ( bp->enableWideTrees )
+	{
+		for ( int i = 0; i < b2_bodyTypeCount; ++i )
+		{
+			b2DynamicTree* tree = bp->trees + i;
+			if ( tree->wideNodeCount == 0 && tree->proxyCount > 0 )
+			{
+				b2DynamicTree_BuildWide( tree );
+			}
+		}
+	}
+
+	// Catches grid proxies moved by the user
+	b2BroadPhase_RebuildGrid( bp );
+
 	int moveCount = bp->moveArray.count;
 	B2_ASSERT( moveCount == (int)bp->moveSet.count );
 
@@ -366,8 +566,28 @@ void b2UpdateBroadPhasePairs( b2World* world )
 		world->taskCount += 1;
 	}
 
+	// Insert the new pairs into the pair set in parallel. Which thread claims a slot depends on
+	// timing, but lookups and removals don't depend on the slot a key ends up in.
+	int pairCount = atomic_load( &bp->movePairIndex );
+	if ( pairCount > 0 )
+	{
+		b2ReserveSet( &bp->pairSet, bp->pairSet.count + pairCount );
+
+		void* userInsertTask = world->enqueueTaskFcn( &b2InsertPairsTask, moveCount, minRange, world, world->userTaskContext );
+		if ( userInsertTask != NULL )
+		{
+			world->finishTaskFcn( userInsertTask, world->userTaskContext );
+			world->taskCount += 1;
+		}
+
+		bp->pairSet.count += pairCount;
+	}
+
 	b2TracyCZoneNC( create_contacts, "Create Contacts", b2_colorGold, true );
 
+	bp->newContactIds = b2AllocateStackItem( alloc, pairCount * sizeof( int ), "new contacts" );
+	int newContactCount = 0;
+
 	// Single-threaded work
 	// - Clear move flags
 	// - Create contacts in deterministic order
@@ -388,18 +608,9 @@ void b2UpdateBroadPhasePairs( b2World* world )
 			b2Shape* shapeA = b2ShapeArray_Get( &world->shapes, shapeIdA );
 			b2Shape* shapeB = b2ShapeArray_Get( &world->shapes, shapeIdB );
 
-			b2CreateContact( world, shapeA, shapeB );
+			bp->newContactIds[newContactCount++] = b2CreateContact( world, shapeA, shapeB );
 
-			if ( pair->heap )
-			{
-				b2MovePair* temp = pair;
-				pair = pair->next;
-				b2Free( temp, sizeof( b2MovePair ) );
-			}
-			else
-			{
-				pair = pair->next;
-			}
+			pair = pair->next;
 		}
 
 		// if (s_file != NULL)
@@ -413,10 +624,24 @@ void b2UpdateBroadPhasePairs( b2World* world )
 	//	fprintf(s_file, "count = %d\n\n", pairCount);
 	// }
 
+	B2_ASSERT( newContactCount == pairCount );
+	if ( newContactCount > 0 )
+	{
+		void* userInitializeTask =
+			world->enqueueTaskFcn( &b2InitializeContactsTask, newContactCount, minRange, world, world->userTaskContext );
+		if ( userInitializeTask != NULL )
+		{
+			world->finishTaskFcn( userInitializeTask, world->userTaskContext );
+			world->taskCount += 1;
+		}
+	}
+
 	// Reset move buffer
 	b2IntArray_Clear( &bp->moveArray );
 	b2ClearSet( &bp->moveSet );
 
+	b2FreeStackItem( alloc, bp->newContactIds );
+	bp->newContactIds = NULL;
 	b2FreeStackItem( alloc, bp->movePairs );
 	bp->movePairs = NULL;
 	b2FreeStackItem( alloc, bp->moveResults );
@@ -436,15 +661,29 @@ bool b2BroadPhase_TestOverlap( const b2BroadPhase* bp, int proxyKeyA, int proxyK
 	int typeIndexB = B2_PROXY_TYPE( proxyKeyB );
 	int proxyIdB = B2_PROXY_ID( proxyKeyB );
 
-	b2AABB aabbA = b2DynamicTree_GetAABB( bp->trees + typeIndexA, proxyIdA );
-	b2AABB aabbB = b2DynamicTree_GetAABB( bp->trees + typeIndexB, proxyIdB );
+	b2AABB aabbA = b2GetProxyAABB( bp, typeIndexA, proxyIdA );
+	b2AABB aabbB = b2GetProxyAABB( bp, typeIndexB, proxyIdB );
 	return b2AABB_Overlaps( aabbA, aabbB );
 }
 
-void b2BroadPhase_RebuildTrees( b2BroadPhase* bp )
+void b2BroadPhase_RebuildTrees( b2BroadPhase* bp, b2World* world )
 {
-	b2DynamicTree_Rebuild( bp->trees + b2_dynamicBody, false );
-	b2DynamicTree_Rebuild( bp->trees + b2_kinematicBody, false );
+	b2DynamicTree_RebuildParallel( bp->trees + b2_dynamicBody, false, world );
+	b2DynamicTree_RebuildParallel( bp->trees + b2_kinematicBody, false, world );
+
+	if ( bp->enableWideTrees )
+	{
+		b2DynamicTree_BuildWide( bp->trees + b2_dynamicBody );
+		b2DynamicTree_BuildWide( bp->trees + b2_kinematicBody );
+	}
+}
+
+void b2BroadPhase_RebuildGrid( b2BroadPhase* bp )
+{
+	if ( bp->useDynamicGrid )
+	{
+		b2ProxyGrid_Rebuild( &bp->dynamicGrid );
+	}
 }
 
 int b2BroadPhase_GetShapeIndex( b2BroadPhase* bp, int proxyKey )
@@ -452,7 +691,7 @@ int b2BroadPhase_GetShapeIndex( b2BroadPhase* bp, int proxyKey )
 	int typeIndex = B2_PROXY_TYPE( proxyKey );
 	int proxyId = B2_PROXY_ID( proxyKey );
 
-	return b2DynamicTree_GetUserData( bp->trees + typeIndex, proxyId );
+	return b2GetProxyUserData( bp, typeIndex, proxyId );
 }
 
 void b2ValidateBroadphase( const b2BroadPhase* bp )
@@ -460,6 +699,11 @@ void b2ValidateBroadphase( const b2BroadPhase* bp )
 	b2DynamicTree_Validate( bp->trees + b2_dynamicBody );
 	b2DynamicTree_Validate( bp->trees + b2_kinematicBody );
 
+	if ( bp->useDynamicGrid )
+	{
+		b2ProxyGrid_Validate( &bp->dynamicGrid );
+	}
+
 	// TODO_ERIN validate every shape AABB is contained in tree AABB
 }
 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "array.h"
+#include "proxy_grid.h"
 #include "table.h"
 
 #include "box2d/collision.h"
@@ -44,13 +45,24 @@ typedef struct b2BroadPhase
 	int movePairCapacity;
 	_Atomic int movePairIndex;
 
+	// Contacts created from the move results, finished in parallel by b2InitializeContact
+	int* newContactIds;
+
 	// Tracks shape pairs that have a b2Contact
 	// todo pairSet can grow quite large on the first time step and remain large
 	b2HashSet pairSet;
 
+	// Keep four-wide copies of the trees for faster queries, see b2DynamicTree_BuildWide
+	bool enableWideTrees;
+
+	// Dynamic proxies live in this grid instead of the dynamic tree, see b2BroadPhaseType. The proxy ids
+	// come from the grid and are used the same way.
+	b2ProxyGrid dynamicGrid;
+	bool useDynamicGrid;
+
 } b2BroadPhase;
 
-void b2CreateBroadPhase( b2BroadPhase* bp );
+void b2CreateBroadPhase( b2BroadPhase* bp, const b2WorldDef* def );
 void b2DestroyBroadPhase( b2BroadPhase* bp );
 
 int b2BroadPhase_CreateProxy( b2BroadPhase* bp, b2BodyType proxyType, b2AABB aabb, uint64_t categoryBits, int shapeIndex,
@@ -60,10 +72,27 @@ void b2BroadPhase_DestroyProxy( b2BroadPhase* bp, int proxyKey );
 void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
 void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
 
-void b2BroadPhase_RebuildTrees( b2BroadPhase* bp );
+// Enlarge a dynamic proxy that is already in the move buffer
+void b2BroadPhase_EnlargeMovedProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
+
+void b2BroadPhase_RebuildTrees( b2BroadPhase* bp, b2World* world );
+
+// Bins the dynamic proxies that moved to other cells, if the grid is used. This also makes the query order
+// independent of the order of the moves.
+void b2BroadPhase_RebuildGrid( b2BroadPhase* bp );
 
 int b2BroadPhase_GetShapeIndex( b2BroadPhase* bp, int proxyKey );
 
+// Queries and casts of the proxies of one body type, whether they are in a tree or the grid
+void b2BroadPhase_Query( const b2BroadPhase* bp, b2BodyType proxyType, b2AABB aabb, uint64_t maskBits,
+						 b2TreeQueryCallbackFcn* callback, void* context );
+void b2BroadPhase_RayCast( const b2BroadPhase* bp, b2BodyType proxyType, const b2RayCastInput* input, uint64_t maskBits,
+						   b2TreeRayCastCallbackFcn* callback, void* context );
+void b2BroadPhase_ShapeCast( const b2BroadPhase* bp, b2BodyType proxyType, const b2ShapeCastInput* input,
+							 uint64_t maskBits, b2TreeShapeCastCallbackFcn* callback, void* context );
+
+int b2BroadPhase_GetByteCount( const b2BroadPhase* bp, b2BodyType proxyType );
+
 void b2UpdateBroadPhasePairs( b2World* world );
 bool b2BroadPhase_TestOverlap( const b2BroadPhase* bp, int proxyKeyA, int proxyKeyB );
 
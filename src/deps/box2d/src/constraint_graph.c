@@ -25,7 +25,8 @@
 // This is used for debugging by making all constraints be assigned to overflow.
 #define B2_FORCE_OVERFLOW 0
 
-_Static_assert( b2_graphColorCount == 12, "graph color count assumed to be 12" );
+_Static_assert( b2_graphColorCount == 24, "graph color count assumed to be 24" );
+_Static_assert( b2_dynamicColorCount < b2_overflowIndex, "no colors left for static constraints" );
 
 void b2CreateGraph( b2ConstraintGraph* graph, int bodyCapacity )
 {
@@ -85,7 +86,7 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 #if B2_FORCE_OVERFLOW == 0
 	if ( staticA == false && staticB == false )
 	{
-		for ( int i = 0; i < b2_overflowIndex; ++i )
+		for ( int i = 0; i < b2_dynamicColorCount; ++i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdA ) || b2GetBit( &color->bodySet, bodyIdB ) )
@@ -218,7 +219,7 @@ static int b2AssignJointColor( b2ConstraintGraph* graph, int bodyIdA, int bodyId
 #if B2_FORCE_OVERFLOW == 0
 	if ( staticA == false && staticB == false )
 	{
-		for ( int i = 0; i < b2_overflowIndex; ++i )
+		for ( int i = 0; i < b2_dynamicColorCount; ++i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdA ) || b2GetBit( &color->bodySet, bodyIdB ) )
@@ -20,6 +20,10 @@ typedef struct b2World b2World;
 // is touching many other bodies.
 #define b2_overflowIndex b2_graphColorCount - 1
 
+// Constraints between two dynamic bodies use the lower colors. The top colors are kept for constraints with a
+// static body, so a body touching many dynamic bodies still has colors left for its ground contacts.
+#define b2_dynamicColorCount ( b2_graphColorCount - 4 )
+
 typedef struct b2GraphColor
 {
 	// This bitset is indexed by bodyId so this is over-sized to encompass static bodies
@@ -196,25 +196,25 @@ void b2InitializeContactRegisters( void )
 	}
 }
 
-void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
+bool b2HasManifoldFunction( b2ShapeType shapeTypeA, b2ShapeType shapeTypeB )
+{
+	B2_ASSERT( 0 <= shapeTypeA && shapeTypeA < b2_shapeTypeCount );
+	B2_ASSERT( 0 <= shapeTypeB && shapeTypeB < b2_shapeTypeCount );
+	return s_registers[shapeTypeA][shapeTypeB].fcn != NULL;
+}
+
+int b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 {
 	b2ShapeType type1 = shapeA->type;
 	b2ShapeType type2 = shapeB->type;
 
-	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
-	B2_ASSERT( 0 <= type2 && type2 < b2_shapeTypeCount );
-
-	if ( s_registers[type1][type2].fcn == NULL )
-	{
-		// For example, no segment vs segment collision
-		return;
-	}
+	// For example, no segment vs segment collision
+	B2_ASSERT( b2HasManifoldFunction( type1, type2 ) );
 
 	if ( s_registers[type1][type2].primary == false )
 	{
 		// flip order
-		b2CreateContact( world, shapeB, shapeA );
-		return;
+		return b2CreateContact( world, shapeB, shapeA );
 	}
 
 	b2Body* bodyA = b2BodyArray_Get( &world->bodies, shapeA->bodyId );
@@ -259,22 +259,6 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 	contact->shapeIdA = shapeIdA;
 	contact->shapeIdB = shapeIdB;
 	contact->isMarked = false;
-	contact->flags = 0;
-
-	if ( shapeA->isSensor || shapeB->isSensor )
-	{
-		contact->flags |= b2_contactSensorFlag;
-	}
-
-	if ( shapeA->enableSensorEvents || shapeB->enableSensorEvents )
-	{
-		contact->flags |= b2_contactEnableSensorEvents;
-	}
-
-	if ( shapeA->enableContactEvents || shapeB->enableContactEvents )
-	{
-		contact->flags |= b2_contactEnableContactEvents;
-	}
 
 	// Connect to body A
 	{
@@ -310,15 +294,41 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 		bodyB->contactCount += 1;
 	}
 
-	// Add to pair set for fast lookup
-	uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeIdA, shapeIdB );
-	b2AddKey( &world->broadPhase.pairSet, pairKey );
-
 	// Contacts are created as non-touching. Later if they are found to be touching
 	// they will link islands and be moved into the constraint graph.
 	b2ContactSim* contactSim = b2ContactSimArray_Add( &set->contactSims );
 	contactSim->contactId = contactId;
 
+	return contactId;
+}
+
+void b2InitializeContact( b2World* world, int contactId )
+{
+	b2Contact* contact = b2ContactArray_Get( &world->contacts, contactId );
+	b2Shape* shapeA = b2ShapeArray_Get( &world->shapes, contact->shapeIdA );
+	b2Shape* shapeB = b2ShapeArray_Get( &world->shapes, contact->shapeIdB );
+
+	contact->flags = 0;
+
+	if ( shapeA->isSensor || shapeB->isSensor )
+	{
+		contact->flags |= b2_contactSensorFlag;
+	}
+
+	if ( shapeA->enableSensorEvents || shapeB->enableSensorEvents )
+	{
+		contact->flags |= b2_contactEnableSensorEvents;
+	}
+
+	if ( shapeA->enableContactEvents || shapeB->enableContactEvents )
+	{
+		contact->flags |= b2_contactEnableContactEvents;
+	}
+
+	b2SolverSet* set = b2SolverSetArray_Get( &world->solverSets, contact->setIndex );
+	b2ContactSim* contactSim = b2ContactSimArray_Get( &set->contactSims, contact->localIndex );
+	B2_ASSERT( contactSim->contactId == contactId );
+
 #if B2_VALIDATE
 	contactSim->bodyIdA = shapeA->bodyId;
 	contactSim->bodyIdB = shapeB->bodyId;
@@ -330,8 +340,8 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 	contactSim->invIA = 0.0f;
 	contactSim->invMassB = 0.0f;
 	contactSim->invIB = 0.0f;
-	contactSim->shapeIdA = shapeIdA;
-	contactSim->shapeIdB = shapeIdB;
+	contactSim->shapeIdA = shapeA->id;
+	contactSim->shapeIdB = shapeB->id;
 	contactSim->cache = b2_emptyDistanceCache;
 	contactSim->manifold = ( b2Manifold ){ 0 };
 	contactSim->friction = b2MixFloats( shapeA->friction, shapeB->friction, world->frictionMixingRule );
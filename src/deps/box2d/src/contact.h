@@ -143,7 +143,15 @@ typedef struct b2ContactSim
 
 void b2InitializeContactRegisters( void );
 
-void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB );
+// False for shape types that never collide, such as two segments
+bool b2HasManifoldFunction( b2ShapeType shapeTypeA, b2ShapeType shapeTypeB );
+
+// Creating a contact has two parts. b2CreateContact allocates the contact and links it to the bodies,
+// this must happen in a deterministic order on one thread. b2InitializeContact fills in the flags and
+// the contact sim from the shapes and may run in parallel for different contacts. The caller is
+// responsible for adding the shape pair to b2BroadPhase::pairSet.
+int b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB );
+void b2InitializeContact( b2World* world, int contactId );
 void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies );
 
 b2ContactSim* b2GetContactSim( b2World* world, b2Contact* contact );
@@ -5,6 +5,8 @@
 
 #include "solver.h"
 
+#include "box2d/types.h"
+
 typedef struct b2ContactSim b2ContactSim;
 
 typedef struct b2ContactConstraintPoint
@@ -33,8 +35,6 @@ typedef struct b2ContactConstraint
 	int pointCount;
 } b2ContactConstraint;
 
-int b2GetContactConstraintSIMDByteCount( void );
-
 // Overflow contacts don't fit into the constraint graph coloring
 void b2PrepareOverflowContacts( b2StepContext* context );
 void b2WarmStartOverflowContacts( b2StepContext* context );
@@ -42,9 +42,26 @@ void b2SolveOverflowContacts( b2StepContext* context, bool useBias );
 void b2ApplyOverflowRestitution( b2StepContext* context );
 void b2StoreOverflowImpulses( b2StepContext* context );
 
-// Contacts that live within the constraint graph coloring
-void b2PrepareContactsTask( int startIndex, int endIndex, b2StepContext* context );
-void b2WarmStartContactsTask( int startIndex, int endIndex, b2StepContext* context, int colorIndex );
-void b2SolveContactsTask( int startIndex, int endIndex, b2StepContext* context, int colorIndex, bool useBias );
-void b2ApplyRestitutionTask( int startIndex, int endIndex, b2StepContext* context, int colorIndex );
-void b2StoreImpulsesTask( int startIndex, int endIndex, b2StepContext* context );
+// Contacts that live within the constraint graph coloring are solved `width` at a time. This solver is
+// compiled for several instruction sets (see contact_solver_wide.h), each world uses one of them.
+typedef struct b2ContactSolverSIMD
+{
+	b2SIMDType type;
+	int width;
+	int constraintByteCount;
+	void ( *prepareContacts )( int startIndex, int endIndex, b2StepContext* context );
+	void ( *warmStartContacts )( int startIndex, int endIndex, b2StepContext* context, int colorIndex );
+	void ( *solveContacts )( int startIndex, int endIndex, b2StepContext* context, int colorIndex, bool useBias );
+	void ( *applyRestitution )( int startIndex, int endIndex, b2StepContext* context, int colorIndex );
+	void ( *storeImpulses )( int startIndex, int endIndex, b2StepContext* context );
+} b2ContactSolverSIMD;
+
+extern const b2ContactSolverSIMD b2_contactSolverScalar;
+extern const b2ContactSolverSIMD b2_contactSolverSSE2;
+extern const b2ContactSolverSIMD b2_contactSolverAVX2;
+extern const b2ContactSolverSIMD b2_contactSolverAVX512;
+extern const b2ContactSolverSIMD b2_contactSolverNEON;
+
+// Returns the solver for `type`, b2_simdDefault or a type the CPU doesn't support selects the widest
+// supported one.
+const b2ContactSolverSIMD* b2GetContactSolverSIMD( b2SIMDType type );
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Compiled for AVX2 regardless of the flags of the rest of the library, only called when cpuid reports
+// support. FMA is left off so results match the other variants bit for bit.
+
+#include "core.h"
+
+#if defined( B2_SIMD_HAS_AVX2 )
+
+#if defined( B2_COMPILER_CLANG )
+	#pragma clang attribute push( __attribute__( ( target( "avx2" ) ) ), apply_to = function )
+#elif defined( B2_COMPILER_GCC )
+	#pragma GCC target( "avx2" )
+#endif
+
+#define B2_SIMD_AVX2
+#define B2_SIMD_WIDTH 8
+#define B2_SIMD_TYPE b2_simdAVX2
+#define B2_SIMD_SOLVER b2_contactSolverAVX2
+
+#include "contact_solver_wide.h"
+
+#if defined( B2_COMPILER_CLANG )
+	#pragma clang attribute pop
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Compiled for AVX-512F regardless of the flags of the rest of the library, only called when cpuid
+// reports support. AVX-512F implies FMA, contraction is disabled so results match the other variants
+// bit for bit.
+
+#include "core.h"
+
+#if defined( B2_SIMD_HAS_AVX512 )
+
+#if defined( B2_COMPILER_CLANG )
+	#pragma clang attribute push( __attribute__( ( target( "avx512f" ) ) ), apply_to = function )
+	#pragma clang fp contract( off )
+#elif defined( B2_COMPILER_GCC )
+	#pragma GCC target( "avx512f" )
+	#pragma GCC optimize( "fp-contract=off" )
+#endif
+
+#define B2_SIMD_AVX512
+#define B2_SIMD_WIDTH 16
+#define B2_SIMD_TYPE b2_simdAVX512
+#define B2_SIMD_SOLVER b2_contactSolverAVX512
+
+#include "contact_solver_wide.h"
+
+#if defined( B2_COMPILER_CLANG )
+	#pragma clang attribute pop
+#endif
+
+#endif
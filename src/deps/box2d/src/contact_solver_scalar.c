@@ -0,0 +1,13 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Portable contact solver, used when SIMD is disabled or requested off.
+
+#include "core.h"
+
+#define B2_SIMD_NONE
+#define B2_SIMD_WIDTH 4
+#define B2_SIMD_TYPE b2_simdNone
+#define B2_SIMD_SOLVER b2_contactSolverScalar
+
+#include "contact_solver_wide.h"
@@ -0,0 +1,15 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "core.h"
+
+#if defined( B2_SIMD_HAS_SSE2 )
+
+#define B2_SIMD_SSE2
+#define B2_SIMD_WIDTH 4
+#define B2_SIMD_TYPE b2_simdSSE2
+#define B2_SIMD_SOLVER b2_contactSolverSSE2
+
+#include "contact_solver_wide.h"
+
+#endif
@@ -61,6 +61,16 @@ void b2SetAssertFcn( b2AssertFcn* assertFcn )
 	b2AssertHandler = assertFcn;
 }
 
+b2TraceBeginFcn* b2TraceBeginHandler = NULL;
+b2TraceEndFcn* b2TraceEndHandler = NULL;
+
+void b2SetTraceFcns( b2TraceBeginFcn* beginFcn, b2TraceEndFcn* endFcn )
+{
+	B2_ASSERT( ( beginFcn == NULL ) == ( endFcn == NULL ) );
+	b2TraceBeginHandler = beginFcn;
+	b2TraceEndHandler = endFcn;
+}
+
 b2Version b2GetVersion( void )
 {
 	return ( b2Version ){ 3, 1, 0 };
@@ -77,9 +87,6 @@ void b2SetAllocator( b2AllocFcn* allocFcn, b2FreeFcn* freeFcn )
 	b2_freeFcn = freeFcn;
 }
 
-// Use 32 byte alignment for everything. Works with 256bit SIMD.
-#define B2_ALIGNMENT 32
-
 void* b2Alloc( int size )
 {
 	if (size == 0)
@@ -90,38 +97,38 @@ void* b2Alloc( int size )
 	// This could cause some sharing issues, however Box2D rarely calls b2Alloc.
 	atomic_fetch_add_explicit( &b2_byteCount, size, memory_order_relaxed );
 
-	// Allocation must be a multiple of 32 or risk a seg fault
+	// Allocation must be a multiple of the alignment or risk a seg fault
 	// https://en.cppreference.com/w/c/memory/aligned_alloc
-	int size32 = ( ( size - 1 ) | 0x1F ) + 1;
+	int alignedSize = ( ( size - 1 ) | ( B2_ALIGNMENT - 1 ) ) + 1;
 
 	if ( b2_allocFcn != NULL )
 	{
-		void* ptr = b2_allocFcn( size32, B2_ALIGNMENT );
+		void* ptr = b2_allocFcn( alignedSize, B2_ALIGNMENT );
 		b2TracyCAlloc( ptr, size );
 
 		B2_ASSERT( ptr != NULL );
-		B2_ASSERT( ( (uintptr_t)ptr & 0x1F ) == 0 );
+		B2_ASSERT( ( (uintptr_t)ptr & ( B2_ALIGNMENT - 1 ) ) == 0 );
 
 		return ptr;
 	}
 
 #ifdef B2_PLATFORM_WINDOWS
-	void* ptr = _aligned_malloc( size32, B2_ALIGNMENT );
+	void* ptr = _aligned_malloc( alignedSize, B2_ALIGNMENT );
 #elif defined( B2_PLATFORM_ANDROID )
 	void* ptr = NULL;
-	if ( posix_memalign( &ptr, B2_ALIGNMENT, size32 ) != 0 )
+	if ( posix_memalign( &ptr, B2_ALIGNMENT, alignedSize ) != 0 )
 	{
 		// allocation failed, exit the application
 		exit( EXIT_FAILURE );
 	}
 #else
-	void* ptr = aligned_alloc( B2_ALIGNMENT, size32 );
+	void* ptr = aligned_alloc( B2_ALIGNMENT, alignedSize );
 #endif
 
 	b2TracyCAlloc( ptr, size );
 
 	B2_ASSERT( ptr != NULL );
-	B2_ASSERT( ( (uintptr_t)ptr & 0x1F ) == 0 );
+	B2_ASSERT( ( (uintptr_t)ptr & ( B2_ALIGNMENT - 1 ) ) == 0 );
 
 	return ptr;
 }
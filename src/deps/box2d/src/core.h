@@ -5,6 +5,8 @@
 
 #include "box2d/base.h"
 
+#include <stddef.h>
+
 // clang-format off
 
 #define B2_NULL_INDEX ( -1 )
@@ -55,30 +57,25 @@
 	#define B2_CPU_UNKNOWN
 #endif
 
-// Define SIMD
+// Define SIMD variants of the contact solver compiled into the library. The variant used by a world is
+// picked at runtime from the CPU features, see b2GetCPUSIMDType.
 #if defined( BOX2D_ENABLE_SIMD )
 	#if defined( B2_CPU_X86_X64 )
-		#if defined( BOX2D_AVX2 )
-			#define B2_SIMD_AVX2
-			#define B2_SIMD_WIDTH 8
-		#else
-			#define B2_SIMD_SSE2
-			#define B2_SIMD_WIDTH 4
-		#endif
+		#define B2_SIMD_HAS_SSE2
+		#define B2_SIMD_HAS_AVX2
+		#define B2_SIMD_HAS_AVX512
 	#elif defined( B2_CPU_ARM )
-		#define B2_SIMD_NEON
-		#define B2_SIMD_WIDTH 4
+		#define B2_SIMD_HAS_NEON
 	#elif defined( B2_CPU_WASM )
-		#define B2_CPU_WASM
-		#define B2_SIMD_SSE2
-		#define B2_SIMD_WIDTH 4
-	#else
-		#define B2_SIMD_NONE
-		#define B2_SIMD_WIDTH 4
+		#define B2_SIMD_HAS_SSE2
 	#endif
+#endif
+
+// Allocation alignment, wide constraints are accessed with aligned SIMD loads
+#if defined( B2_SIMD_HAS_AVX512 )
+	#define B2_ALIGNMENT 64
 #else
-	#define B2_SIMD_NONE
-	#define B2_SIMD_WIDTH 4
+	#define B2_ALIGNMENT 32
 #endif
 
 // Define compiler
@@ -123,8 +120,8 @@
 	#define b2TracyCZoneEnd( ctx ) TracyCZoneEnd( ctx )
 #else
 	#define b2TracyCZoneC( ctx, color, active )
-	#define b2TracyCZoneNC( ctx, name, color, active )
-	#define b2TracyCZoneEnd( ctx )
+	#define b2TracyCZoneNC( ctx, name, color, active ) b2TraceBegin( name )
+	#define b2TracyCZoneEnd( ctx ) b2TraceEnd()
 #endif
 
 // clang-format on
@@ -140,7 +137,8 @@ extern float b2_lengthUnitsPerMeter;
 
 // Maximum number of colors in the constraint graph. Constraints that cannot
 // find a color are added to the overflow set which are solved single-threaded.
-#define b2_graphColorCount 12
+// Only colors that hold constraints are solved, so unused colors cost nothing.
+#define b2_graphColorCount 24
 
 // A small length used as a collision and constraint tolerance. Usually it is
 // chosen to be numerically significant, but visually insignificant. In meters.
@@ -181,3 +179,23 @@ extern float b2_lengthUnitsPerMeter;
 void* b2Alloc( int size );
 void b2Free( void* mem, int size );
 void* b2GrowAlloc( void* oldMem, int oldSize, int newSize );
+
+extern b2TraceBeginFcn* b2TraceBeginHandler;
+extern b2TraceEndFcn* b2TraceEndHandler;
+
+// Profiler zones, see b2SetTraceFcns. Tracy zones use these when Tracy is off.
+static inline void b2TraceBegin( const char* name )
+{
+	if ( b2TraceBeginHandler != NULL )
+	{
+		b2TraceBeginHandler( name );
+	}
+}
+
+static inline void b2TraceEnd( void )
+{
+	if ( b2TraceEndHandler != NULL )
+	{
+		b2TraceEndHandler();
+	}
+}
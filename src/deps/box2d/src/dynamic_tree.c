@@ -1,8 +1,11 @@
 // SPDX-FileCopyrightText: 2023 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "dynamic_tree.h"
+
 #include "aabb.h"
 #include "core.h"
+#include "world.h"
 
 #include "box2d/collision.h"
 #include "box2d/math_functions.h"
@@ -10,8 +13,19 @@
 #include <float.h>
 #include <string.h>
 
+#if defined( B2_SIMD_HAS_SSE2 )
+	#include <emmintrin.h>
+#elif defined( B2_SIMD_HAS_NEON )
+	#include <arm_neon.h>
+#endif
+
 #define b2_treeStackSize 1024
 
+// Rebuilds with fewer leaves than twice this are serial, subtrees with fewer leaves are not split into tasks
+#define b2_treeBuildTaskMinLeafCount 1024
+
+#define b2_maxTreeBuildTasks 128
+
 // TODO_ERIN
 // - try incrementally sorting internal nodes by height for better cache efficiency during depth first traversal.
 
@@ -29,6 +43,189 @@ static inline int16_t b2MaxInt16( int16_t a, int16_t b )
 	return a > b ? a : b;
 }
 
+// A wide node holds the boxes of up to four children in SoA form so a query can test them together. The wide
+// tree collapses the binary tree by opening the largest internal children of a node until it has four. Children
+// keep the left to right order of the binary tree, so a depth first traversal reports the same proxies in the same
+// order.
+typedef struct b2WideTreeNode
+{
+	float lowerX[4];
+	float lowerY[4];
+	float upperX[4];
+	float upperY[4];
+	uint64_t categoryBits[4];
+
+	// Wide node index of an internal child or ~proxyId of a leaf. Unused children have no category bits.
+	int32_t children[4];
+} b2WideTreeNode;
+
+typedef struct b2WideBuildItem
+{
+	int32_t nodeIndex;
+	int32_t wideIndex;
+} b2WideBuildItem;
+
+#if defined( B2_SIMD_HAS_SSE2 )
+
+typedef __m128 b2Float4;
+
+static inline b2Float4 b2Load4( const float* p )
+{
+	return _mm_load_ps( p );
+}
+
+static inline b2Float4 b2Splat4( float s )
+{
+	return _mm_set1_ps( s );
+}
+
+static inline b2Float4 b2Add4( b2Float4 a, b2Float4 b )
+{
+	return _mm_add_ps( a, b );
+}
+
+static inline b2Float4 b2Sub4( b2Float4 a, b2Float4 b )
+{
+	return _mm_sub_ps( a, b );
+}
+
+static inline b2Float4 b2Mul4( b2Float4 a, b2Float4 b )
+{
+	return _mm_mul_ps( a, b );
+}
+
+static inline b2Float4 b2Abs4( b2Float4 a )
+{
+	return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a );
+}
+
+// Bit i is set when a[i] > b[i]
+static inline int b2GreaterMask4( b2Float4 a, b2Float4 b )
+{
+	return _mm_movemask_ps( _mm_cmpgt_ps( a, b ) );
+}
+
+#elif defined( B2_SIMD_HAS_NEON )
+
+typedef float32x4_t b2Float4;
+
+static inline b2Float4 b2Load4( const float* p )
+{
+	return vld1q_f32( p );
+}
+
+static inline b2Float4 b2Splat4( float s )
+{
+	return vdupq_n_f32( s );
+}
+
+static inline b2Float4 b2Add4( b2Float4 a, b2Float4 b )
+{
+	return vaddq_f32( a, b );
+}
+
+static inline b2Float4 b2Sub4( b2Float4 a, b2Float4 b )
+{
+	return vsubq_f32( a, b );
+}
+
+static inline b2Float4 b2Mul4( b2Float4 a, b2Float4 b )
+{
+	return vmulq_f32( a, b );
+}
+
+static inline b2Float4 b2Abs4( b2Float4 a )
+{
+	return vabsq_f32( a );
+}
+
+static inline int b2GreaterMask4( b2Float4 a, b2Float4 b )
+{
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t bits = vandq_u32( vcgtq_f32( a, b ), vld1q_u32( laneBits ) );
+	return (int)( vgetq_lane_u32( bits, 0 ) | vgetq_lane_u32( bits, 1 ) | vgetq_lane_u32( bits, 2 ) |
+				  vgetq_lane_u32( bits, 3 ) );
+}
+
+#else
+
+typedef struct b2Float4
+{
+	float x[4];
+} b2Float4;
+
+static inline b2Float4 b2Load4( const float* p )
+{
+	return ( b2Float4 ){ { p[0], p[1], p[2], p[3] } };
+}
+
+static inline b2Float4 b2Splat4( float s )
+{
+	return ( b2Float4 ){ { s, s, s, s } };
+}
+
+static inline b2Float4 b2Add4( b2Float4 a, b2Float4 b )
+{
+	return ( b2Float4 ){ { a.x[0] + b.x[0], a.x[1] + b.x[1], a.x[2] + b.x[2], a.x[3] + b.x[3] } };
+}
+
+static inline b2Float4 b2Sub4( b2Float4 a, b2Float4 b )
+{
+	return ( b2Float4 ){ { a.x[0] - b.x[0], a.x[1] - b.x[1], a.x[2] - b.x[2], a.x[3] - b.x[3] } };
+}
+
+static inline b2Float4 b2Mul4( b2Float4 a, b2Float4 b )
+{
+	return ( b2Float4 ){ { a.x[0] * b.x[0], a.x[1] * b.x[1], a.x[2] * b.x[2], a.x[3] * b.x[3] } };
+}
+
+static inline b2Float4 b2Abs4( b2Float4 a )
+{
+	return ( b2Float4 ){ { b2AbsFloat( a.x[0] ), b2AbsFloat( a.x[1] ), b2AbsFloat( a.x[2] ), b2AbsFloat( a.x[3] ) } };
+}
+
+static inline int b2GreaterMask4( b2Float4 a, b2Float4 b )
+{
+	return ( a.x[0] > b.x[0] ? 1 : 0 ) | ( a.x[1] > b.x[1] ? 2 : 0 ) | ( a.x[2] > b.x[2] ? 4 : 0 ) |
+		   ( a.x[3] > b.x[3] ? 8 : 0 );
+}
+
+#endif
+
+// Bit i is set when child i of the wide node doesn't overlap the box, same as b2AABB_Overlaps
+static inline int b2WideSeparatedMask( const b2WideTreeNode* node, b2AABB aabb )
+{
+	b2Float4 zero = b2Splat4( 0.0f );
+	int mask = b2GreaterMask4( b2Sub4( b2Splat4( aabb.lowerBound.x ), b2Load4( node->upperX ) ), zero );
+	mask |= b2GreaterMask4( b2Sub4( b2Splat4( aabb.lowerBound.y ), b2Load4( node->upperY ) ), zero );
+	mask |= b2GreaterMask4( b2Sub4( b2Load4( node->lowerX ), b2Splat4( aabb.upperBound.x ) ), zero );
+	mask |= b2GreaterMask4( b2Sub4( b2Load4( node->lowerY ), b2Splat4( aabb.upperBound.y ) ), zero );
+	return mask;
+}
+
+// Bit i is set when child i of the wide node is separated from the segment line, same as the scalar ray cast test
+// with the node extents grown by extension
+static inline int b2WideSegmentSeparatedMask( const b2WideTreeNode* node, b2Vec2 p1, b2Vec2 v, b2Vec2 abs_v, b2Vec2 extension )
+{
+	b2Float4 half = b2Splat4( 0.5f );
+	b2Float4 lowerX = b2Load4( node->lowerX );
+	b2Float4 lowerY = b2Load4( node->lowerY );
+	b2Float4 upperX = b2Load4( node->upperX );
+	b2Float4 upperY = b2Load4( node->upperY );
+
+	b2Float4 cx = b2Mul4( half, b2Add4( lowerX, upperX ) );
+	b2Float4 cy = b2Mul4( half, b2Add4( lowerY, upperY ) );
+	b2Float4 hx = b2Mul4( half, b2Sub4( upperX, lowerX ) );
+	b2Float4 hy = b2Mul4( half, b2Sub4( upperY, lowerY ) );
+	hx = b2Add4( hx, b2Splat4( extension.x ) );
+	hy = b2Add4( hy, b2Splat4( extension.y ) );
+
+	b2Float4 term1 = b2Abs4( b2Add4( b2Mul4( b2Splat4( v.x ), b2Sub4( b2Splat4( p1.x ), cx ) ),
+									 b2Mul4( b2Splat4( v.y ), b2Sub4( b2Splat4( p1.y ), cy ) ) ) );
+	b2Float4 term2 = b2Add4( b2Mul4( b2Splat4( abs_v.x ), hx ), b2Mul4( b2Splat4( abs_v.y ), hy ) );
+	return b2GreaterMask4( term1, term2 );
+}
+
 b2DynamicTree b2DynamicTree_Create( void )
 {
 	_Static_assert( ( sizeof( b2TreeNode ) & 0xF ) == 0, "tree node size not a multiple of 16" );
@@ -54,11 +251,18 @@ b2DynamicTree b2DynamicTree_Create( void )
 	tree.proxyCount = 0;
 
 	tree.leafIndices = NULL;
+	tree.rebuildNodes = NULL;
 	tree.leafBoxes = NULL;
 	tree.leafCenters = NULL;
 	tree.binIndices = NULL;
 	tree.rebuildCapacity = 0;
 
+	tree.wideNodes = NULL;
+	tree.wideNodeCount = 0;
+	tree.wideNodeCapacity = 0;
+	tree.wideSlots = NULL;
+	tree.wideSlotCapacity = 0;
+
 	return tree;
 }
 
@@ -66,9 +270,12 @@ void b2DynamicTree_Destroy( b2DynamicTree* tree )
 {
 	b2Free( tree->nodes, tree->nodeCapacity * sizeof( b2TreeNode ) );
 	b2Free( tree->leafIndices, tree->rebuildCapacity * sizeof( int32_t ) );
+	b2Free( tree->rebuildNodes, tree->rebuildCapacity * sizeof( int32_t ) );
 	b2Free( tree->leafBoxes, tree->rebuildCapacity * sizeof( b2AABB ) );
 	b2Free( tree->leafCenters, tree->rebuildCapacity * sizeof( b2Vec2 ) );
 	b2Free( tree->binIndices, tree->rebuildCapacity * sizeof( int32_t ) );
+	b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2WideTreeNode ) );
+	b2Free( tree->wideSlots, tree->wideSlotCapacity * sizeof( int32_t ) );
 
 	memset( tree, 0, sizeof( b2DynamicTree ) );
 }
@@ -732,6 +939,8 @@ int32_t b2DynamicTree_CreateProxy( b2DynamicTree* tree, b2AABB aabb, uint64_t ca
 	B2_ASSERT( -b2_huge < aabb.upperBound.x && aabb.upperBound.x < b2_huge );
 	B2_ASSERT( -b2_huge < aabb.upperBound.y && aabb.upperBound.y < b2_huge );
 
+	tree->wideNodeCount = 0;
+
 	int32_t proxyId = b2AllocateNode( tree );
 	b2TreeNode* node = tree->nodes + proxyId;
 
@@ -753,6 +962,8 @@ void b2DynamicTree_DestroyProxy( b2DynamicTree* tree, int32_t proxyId )
 	B2_ASSERT( 0 <= proxyId && proxyId < tree->nodeCapacity );
 	B2_ASSERT( b2IsLeaf( tree->nodes + proxyId ) );
 
+	tree->wideNodeCount = 0;
+
 	b2RemoveLeaf( tree, proxyId );
 	b2FreeNode( tree, proxyId );
 
@@ -773,6 +984,8 @@ void b2DynamicTree_MoveProxy( b2DynamicTree* tree, int32_t proxyId, b2AABB aabb
 	B2_ASSERT( 0 <= proxyId && proxyId < tree->nodeCapacity );
 	B2_ASSERT( b2IsLeaf( tree->nodes + proxyId ) );
 
+	tree->wideNodeCount = 0;
+
 	b2RemoveLeaf( tree, proxyId );
 
 	tree->nodes[proxyId].aabb = aabb;
@@ -781,6 +994,24 @@ void b2DynamicTree_MoveProxy( b2DynamicTree* tree, int32_t proxyId, b2AABB aabb
 	b2InsertLeaf( tree, proxyId, shouldRotate );
 }
 
+// Copy the box of a node to its wide node slot, if it has one
+static void b2SetWideBox( b2DynamicTree* tree, int32_t nodeId )
+{
+	int32_t slot = tree->wideSlots[nodeId];
+	if ( slot == B2_NULL_INDEX )
+	{
+		return;
+	}
+
+	b2WideTreeNode* wide = tree->wideNodes + ( slot >> 2 );
+	int child = slot & 3;
+	b2AABB aabb = tree->nodes[nodeId].aabb;
+	wide->lowerX[child] = aabb.lowerBound.x;
+	wide->lowerY[child] = aabb.lowerBound.y;
+	wide->upperX[child] = aabb.upperBound.x;
+	wide->upperY[child] = aabb.upperBound.y;
+}
+
 void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int32_t proxyId, b2AABB aabb )
 {
 	b2TreeNode* nodes = tree->nodes;
@@ -796,11 +1027,22 @@ void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int32_t proxyId, b2AABB aa
 
 	nodes[proxyId].aabb = aabb;
 
+	// Keep the wide tree usable, it stores the boxes of the nodes that are wide node children
+	bool updateWide = tree->wideNodeCount > 0;
+	if ( updateWide )
+	{
+		b2SetWideBox( tree, proxyId );
+	}
+
 	int32_t parentIndex = nodes[proxyId].parent;
 	while ( parentIndex != B2_NULL_INDEX )
 	{
 		bool changed = b2EnlargeAABB( &nodes[parentIndex].aabb, aabb );
 		nodes[parentIndex].enlarged = true;
+		if ( changed && updateWide )
+		{
+			b2SetWideBox( tree, parentIndex );
+		}
 		parentIndex = nodes[parentIndex].parent;
 
 		if ( changed == false )
@@ -1022,6 +1264,8 @@ int32_t b2DynamicTree_GetMaxBalance( const b2DynamicTree* tree )
 
 void b2DynamicTree_RebuildBottomUp( b2DynamicTree* tree )
 {
+	tree->wideNodeCount = 0;
+
 	int32_t* nodes = b2Alloc( tree->nodeCount * sizeof( int32_t ) );
 	int32_t count = 0;
 
@@ -1098,6 +1342,8 @@ void b2DynamicTree_RebuildBottomUp( b2DynamicTree* tree )
 
 void b2DynamicTree_ShiftOrigin( b2DynamicTree* tree, b2Vec2 newOrigin )
 {
+	tree->wideNodeCount = 0;
+
 	// shift all AABBs
 	for ( int32_t i = 0; i < tree->nodeCapacity; ++i )
 	{
@@ -1112,14 +1358,66 @@ void b2DynamicTree_ShiftOrigin( b2DynamicTree* tree, b2Vec2 newOrigin )
 int b2DynamicTree_GetByteCount( const b2DynamicTree* tree )
 {
 	size_t size = sizeof( b2DynamicTree ) + sizeof( b2TreeNode ) * tree->nodeCapacity +
-				  tree->rebuildCapacity * ( sizeof( int32_t ) + sizeof( b2AABB ) + sizeof( b2Vec2 ) + sizeof( int32_t ) );
+				  tree->rebuildCapacity * ( 3 * sizeof( int32_t ) + sizeof( b2AABB ) + sizeof( b2Vec2 ) ) +
+				  sizeof( b2WideTreeNode ) * tree->wideNodeCapacity + sizeof( int32_t ) * tree->wideSlotCapacity;
 
 	return (int)size;
 }
 
+// Pushes the children of a wide node that are not culled. Pushing them in order means the last child is visited
+// first, the same as the binary traversal.
+static inline void b2PushWideChildren( const b2WideTreeNode* node, int culledMask, uint64_t maskBits, int32_t* stack,
+									   int32_t* stackCount )
+{
+	for ( int i = 0; i < 4; ++i )
+	{
+		if ( ( culledMask & ( 1 << i ) ) == 0 && ( node->categoryBits[i] & maskBits ) != 0 )
+		{
+			B2_ASSERT( *stackCount < b2_treeStackSize );
+			if ( *stackCount < b2_treeStackSize )
+			{
+				stack[( *stackCount )++] = node->children[i];
+			}
+		}
+	}
+}
+
+static void b2QueryWide( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
+						 void* context )
+{
+	int32_t stack[b2_treeStackSize];
+	int32_t stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while ( stackCount > 0 )
+	{
+		int32_t item = stack[--stackCount];
+		if ( item < 0 )
+		{
+			// Leaf, tested with its parent
+			int32_t proxyId = ~item;
+			bool proceed = callback( proxyId, tree->nodes[proxyId].userData, context );
+			if ( proceed == false )
+			{
+				return;
+			}
+			continue;
+		}
+
+		const b2WideTreeNode* node = tree->wideNodes + item;
+		b2PushWideChildren( node, b2WideSeparatedMask( node, aabb ), maskBits, stack, &stackCount );
+	}
+}
+
 void b2DynamicTree_Query( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
 						  void* context )
 {
+	if ( tree->wideNodeCount > 0 )
+	{
+		b2QueryWide( tree, aabb, maskBits, callback, context );
+		return;
+	}
+
 	int32_t stack[b2_treeStackSize];
 	int32_t stackCount = 0;
 	stack[stackCount++] = tree->root;
@@ -1180,11 +1478,59 @@ void b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInput* inp
 	// Build a bounding box for the segment.
 	b2AABB segmentAABB = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
 
+	b2RayCastInput subInput = *input;
+
 	int32_t stack[b2_treeStackSize];
 	int32_t stackCount = 0;
-	stack[stackCount++] = tree->root;
 
-	b2RayCastInput subInput = *input;
+	if ( tree->wideNodeCount > 0 )
+	{
+		stack[stackCount++] = 0;
+
+		while ( stackCount > 0 )
+		{
+			int32_t item = stack[--stackCount];
+			if ( item >= 0 )
+			{
+				const b2WideTreeNode* node = tree->wideNodes + item;
+				int culledMask = b2WideSeparatedMask( node, segmentAABB ) |
+								 b2WideSegmentSeparatedMask( node, p1, v, abs_v, b2Vec2_zero );
+				b2PushWideChildren( node, culledMask, maskBits, stack, &stackCount );
+				continue;
+			}
+
+			// The ray may have been clipped since the leaf was pushed
+			int32_t proxyId = ~item;
+			const b2TreeNode* node = tree->nodes + proxyId;
+			if ( b2AABB_Overlaps( node->aabb, segmentAABB ) == false )
+			{
+				continue;
+			}
+
+			subInput.maxFraction = maxFraction;
+
+			float value = callback( &subInput, proxyId, node->userData, context );
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if ( 0.0f < value && value < maxFraction )
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				p2 = b2MulAdd( p1, maxFraction, d );
+				segmentAABB.lowerBound = b2Min( p1, p2 );
+				segmentAABB.upperBound = b2Max( p1, p2 );
+			}
+		}
+
+		return;
+	}
+
+	stack[stackCount++] = tree->root;
 
 	while ( stackCount > 0 )
 	{
@@ -1291,6 +1637,54 @@ void b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCastInput*
 
 	int32_t stack[b2_treeStackSize];
 	int32_t stackCount = 0;
+
+	if ( tree->wideNodeCount > 0 )
+	{
+		stack[stackCount++] = 0;
+
+		while ( stackCount > 0 )
+		{
+			int32_t item = stack[--stackCount];
+			if ( item >= 0 )
+			{
+				const b2WideTreeNode* node = tree->wideNodes + item;
+				int culledMask = b2WideSeparatedMask( node, totalAABB ) |
+								 b2WideSegmentSeparatedMask( node, p1, v, abs_v, extension );
+				b2PushWideChildren( node, culledMask, maskBits, stack, &stackCount );
+				continue;
+			}
+
+			// The cast may have been clipped since the leaf was pushed
+			int32_t proxyId = ~item;
+			const b2TreeNode* node = tree->nodes + proxyId;
+			if ( b2AABB_Overlaps( node->aabb, totalAABB ) == false )
+			{
+				continue;
+			}
+
+			subInput.maxFraction = maxFraction;
+
+			float value = callback( &subInput, proxyId, node->userData, context );
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if ( 0.0f < value && value < maxFraction )
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				t = b2MulSV( maxFraction, input->translation );
+				totalAABB.lowerBound = b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) );
+				totalAABB.upperBound = b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) );
+			}
+		}
+
+		return;
+	}
+
 	stack[stackCount++] = tree->root;
 
 	while ( stackCount > 0 )
@@ -1652,38 +2046,38 @@ struct b2RebuildItem
 	int32_t endIndex;
 };
 
-// Returns root node index
-static int32_t b2BuildTree( b2DynamicTree* tree, int32_t leafCount )
+// Returns the split index of the leaves in [startIndex, startIndex + count)
+static int32_t b2PartitionLeaves( b2DynamicTree* tree, int32_t startIndex, int32_t count )
 {
-	b2TreeNode* nodes = tree->nodes;
-	int32_t* leafIndices = tree->leafIndices;
-
-	if ( leafCount == 1 )
-	{
-		nodes[leafIndices[0]].parent = B2_NULL_INDEX;
-		return leafIndices[0];
-	}
-
 #if B2_TREE_HEURISTIC == 0
-	b2Vec2* leafCenters = tree->leafCenters;
+	return startIndex + b2PartitionMid( tree->leafIndices + startIndex, tree->leafCenters + startIndex, count );
 #else
-	b2AABB* leafBoxes = tree->leafBoxes;
-	int32_t* binIndices = tree->binIndices;
+	return startIndex +
+		   b2PartitionSAH( tree->leafIndices + startIndex, tree->binIndices + startIndex, tree->leafBoxes + startIndex, count );
 #endif
+}
+
+// Builds the subtree of the leaves in [startIndex, endIndex), at least two. Internal nodes are taken from
+// rebuildNodes starting at firstNode in depth first order, the order a serial build allocates them in. So the tree
+// is the same no matter how subtrees are spread over tasks. Returns the subtree root node index.
+static int32_t b2BuildSubtree( b2DynamicTree* tree, int32_t startIndex, int32_t endIndex, int32_t firstNode )
+{
+	b2TreeNode* nodes = tree->nodes;
+	int32_t* leafIndices = tree->leafIndices;
+	const int32_t* rebuildNodes = tree->rebuildNodes;
+	int32_t nextNode = firstNode;
+
+	B2_ASSERT( endIndex - startIndex > 1 );
 
 	// todo large stack item
 	struct b2RebuildItem stack[b2_treeStackSize];
 	int32_t top = 0;
 
-	stack[0].nodeIndex = b2AllocateNode( tree );
+	stack[0].nodeIndex = rebuildNodes[nextNode++];
 	stack[0].childCount = -1;
-	stack[0].startIndex = 0;
-	stack[0].endIndex = leafCount;
-#if B2_TREE_HEURISTIC == 0
-	stack[0].splitIndex = b2PartitionMid( leafIndices, leafCenters, leafCount );
-#else
-	stack[0].splitIndex = b2PartitionSAH( leafIndices, binIndices, leafBoxes, leafCount );
-#endif
+	stack[0].startIndex = startIndex;
+	stack[0].endIndex = endIndex;
+	stack[0].splitIndex = b2PartitionLeaves( tree, startIndex, endIndex - startIndex );
 
 	while ( true )
 	{
@@ -1778,17 +2172,11 @@ static int32_t b2BuildTree( b2DynamicTree* tree, int32_t leafCount )
 
 				top += 1;
 				struct b2RebuildItem* newItem = stack + top;
-				newItem->nodeIndex = b2AllocateNode( tree );
+				newItem->nodeIndex = rebuildNodes[nextNode++];
 				newItem->childCount = -1;
 				newItem->startIndex = startIndex;
 				newItem->endIndex = endIndex;
-#if B2_TREE_HEURISTIC == 0
-				newItem->splitIndex = b2PartitionMid( leafIndices + startIndex, leafCenters + startIndex, count );
-#else
-				newItem->splitIndex =
-					b2PartitionSAH( leafIndices + startIndex, binIndices + startIndex, leafBoxes + startIndex, count );
-#endif
-				newItem->splitIndex += startIndex;
+				newItem->splitIndex = b2PartitionLeaves( tree, startIndex, count );
 			}
 		}
 	}
@@ -1808,9 +2196,143 @@ static int32_t b2BuildTree( b2DynamicTree* tree, int32_t leafCount )
 	return stack[0].nodeIndex;
 }
 
+// A subtree built by a task
+typedef struct b2TreeBuildTask
+{
+	int32_t startIndex;
+	int32_t endIndex;
+	int32_t firstNode;
+} b2TreeBuildTask;
+
+// The top of a tree that is built serially, with the subtrees below it built in parallel
+typedef struct b2TreeBuilder
+{
+	b2DynamicTree* tree;
+
+	// Subtrees with this many leaves or fewer are not split further
+	int32_t taskLeafCount;
+
+	b2TreeBuildTask tasks[b2_maxTreeBuildTasks];
+	int32_t taskCount;
+
+	// Internal nodes above the tasks in depth first order
+	int32_t topNodes[b2_maxTreeBuildTasks];
+	int32_t topNodeCount;
+} b2TreeBuilder;
+
+// Partitions the top of the tree and records the subtrees below it as tasks. Returns the node index of the
+// subtree root. Parents and bounds of the top nodes are filled in once the tasks are done.
+static int32_t b2SplitTopNodes( b2TreeBuilder* builder, int32_t startIndex, int32_t endIndex, int32_t firstNode )
+{
+	b2DynamicTree* tree = builder->tree;
+	int32_t count = endIndex - startIndex;
+	if ( count == 1 )
+	{
+		return tree->leafIndices[startIndex];
+	}
+
+	int32_t nodeIndex = tree->rebuildNodes[firstNode];
+	if ( count <= builder->taskLeafCount || builder->topNodeCount == b2_maxTreeBuildTasks )
+	{
+		if ( builder->taskCount == b2_maxTreeBuildTasks )
+		{
+			return b2BuildSubtree( tree, startIndex, endIndex, firstNode );
+		}
+
+		builder->tasks[builder->taskCount++] = ( b2TreeBuildTask ){ startIndex, endIndex, firstNode };
+		return nodeIndex;
+	}
+
+	builder->topNodes[builder->topNodeCount++] = nodeIndex;
+
+	// The second subtree starts after the internal nodes of the first subtree
+	int32_t splitIndex = b2PartitionLeaves( tree, startIndex, count );
+	b2TreeNode* node = tree->nodes + nodeIndex;
+	node->child1 = b2SplitTopNodes( builder, startIndex, splitIndex, firstNode + 1 );
+	node->child2 = b2SplitTopNodes( builder, splitIndex, endIndex, firstNode + splitIndex - startIndex );
+	return nodeIndex;
+}
+
+static void b2BuildSubtreesTask( int startIndex, int endIndex, uint32_t workerIndex, void* context )
+{
+	B2_MAYBE_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( build_subtrees, "Build Subtrees", b2_colorSnow, true );
+
+	b2TreeBuilder* builder = context;
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2TreeBuildTask* task = builder->tasks + i;
+		b2BuildSubtree( builder->tree, task->startIndex, task->endIndex, task->firstNode );
+	}
+
+	b2TracyCZoneEnd( build_subtrees );
+}
+
+// Returns root node index. Large trees are built in parallel when a world is provided.
+static int32_t b2BuildTree( b2DynamicTree* tree, int32_t leafCount, b2World* world )
+{
+	b2TreeNode* nodes = tree->nodes;
+	int32_t* leafIndices = tree->leafIndices;
+
+	if ( leafCount == 1 )
+	{
+		nodes[leafIndices[0]].parent = B2_NULL_INDEX;
+		return leafIndices[0];
+	}
+
+	// Allocate all internal nodes up front so the pool doesn't grow while subtrees are built
+	for ( int32_t i = 0; i < leafCount - 1; ++i )
+	{
+		tree->rebuildNodes[i] = b2AllocateNode( tree );
+	}
+	nodes = tree->nodes;
+
+	if ( world == NULL || world->workerCount == 1 || leafCount < 2 * b2_treeBuildTaskMinLeafCount )
+	{
+		return b2BuildSubtree( tree, 0, leafCount, 0 );
+	}
+
+	b2TreeBuilder builder;
+	builder.tree = tree;
+	builder.taskLeafCount = b2MaxInt( b2_treeBuildTaskMinLeafCount, leafCount / ( 4 * world->workerCount ) );
+	builder.taskCount = 0;
+	builder.topNodeCount = 0;
+
+	int32_t rootIndex = b2SplitTopNodes( &builder, 0, leafCount, 0 );
+
+	// Not added to the world task count, this may run on a worker while the main thread adds tasks
+	void* userTask =
+		world->enqueueTaskFcn( b2BuildSubtreesTask, builder.taskCount, 1, &builder, world->userTaskContext );
+	if ( userTask != NULL )
+	{
+		world->finishTaskFcn( userTask, world->userTaskContext );
+	}
+
+	// Children come after their parent in depth first order
+	for ( int i = builder.topNodeCount - 1; i >= 0; --i )
+	{
+		int32_t nodeIndex = builder.topNodes[i];
+		b2TreeNode* node = nodes + nodeIndex;
+		b2TreeNode* child1 = nodes + node->child1;
+		b2TreeNode* child2 = nodes + node->child2;
+
+		child1->parent = nodeIndex;
+		child2->parent = nodeIndex;
+
+		node->aabb = b2AABB_Union( child1->aabb, child2->aabb );
+		node->height = 1 + b2MaxInt16( child1->height, child2->height );
+		node->categoryBits = child1->categoryBits | child2->categoryBits;
+	}
+
+	return rootIndex;
+}
+
 // Not safe to access tree during this operation because it may grow
-int32_t b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
+static int32_t b2RebuildTree( b2DynamicTree* tree, bool fullBuild, b2World* world )
 {
+	tree->wideNodeCount = 0;
+
 	int32_t proxyCount = tree->proxyCount;
 	if ( proxyCount == 0 )
 	{
@@ -1824,6 +2346,8 @@ int32_t b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
 
 		b2Free( tree->leafIndices, tree->rebuildCapacity * sizeof( int32_t ) );
 		tree->leafIndices = b2Alloc( newCapacity * sizeof( int32_t ) );
+		b2Free( tree->rebuildNodes, tree->rebuildCapacity * sizeof( int32_t ) );
+		tree->rebuildNodes = b2Alloc( newCapacity * sizeof( int32_t ) );
 
 #if B2_TREE_HEURISTIC == 0
 		b2Free( tree->leafCenters, tree->rebuildCapacity * sizeof( b2Vec2 ) );
@@ -1918,9 +2442,155 @@ int32_t b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
 
 	B2_ASSERT( leafCount <= proxyCount );
 
-	tree->root = b2BuildTree( tree, leafCount );
+	tree->root = b2BuildTree( tree, leafCount, world );
 
 	b2DynamicTree_Validate( tree );
 
 	return leafCount;
 }
+
+int32_t b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
+{
+	return b2RebuildTree( tree, fullBuild, NULL );
+}
+
+int32_t b2DynamicTree_RebuildParallel( b2DynamicTree* tree, bool fullBuild, b2World* world )
+{
+	return b2RebuildTree( tree, fullBuild, world );
+}
+
+void b2DynamicTree_BuildWide( b2DynamicTree* tree )
+{
+	tree->wideNodeCount = 0;
+
+	if ( tree->root == B2_NULL_INDEX )
+	{
+		return;
+	}
+
+	// Every wide node stands for a different internal node, except a leaf root
+	int32_t maxWideCount = tree->nodeCount / 2 + 1;
+	if ( maxWideCount > tree->wideNodeCapacity )
+	{
+		int32_t newCapacity = maxWideCount + maxWideCount / 2;
+		b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2WideTreeNode ) );
+		tree->wideNodes = b2Alloc( newCapacity * sizeof( b2WideTreeNode ) );
+		tree->wideNodeCapacity = newCapacity;
+	}
+
+	if ( tree->nodeCapacity > tree->wideSlotCapacity )
+	{
+		b2Free( tree->wideSlots, tree->wideSlotCapacity * sizeof( int32_t ) );
+		tree->wideSlots = b2Alloc( tree->nodeCapacity * sizeof( int32_t ) );
+		tree->wideSlotCapacity = tree->nodeCapacity;
+	}
+
+	const b2TreeNode* nodes = tree->nodes;
+	b2WideTreeNode* wideNodes = tree->wideNodes;
+	int32_t* wideSlots = tree->wideSlots;
+
+	b2WideBuildItem stack[b2_treeStackSize];
+	int32_t stackCount = 0;
+	int32_t wideCount = 1;
+
+	wideSlots[tree->root] = B2_NULL_INDEX;
+	stack[stackCount++] = ( b2WideBuildItem ){ tree->root, 0 };
+
+	while ( stackCount > 0 )
+	{
+		b2WideBuildItem item = stack[--stackCount];
+		const b2TreeNode* node = nodes + item.nodeIndex;
+
+		int32_t entries[4];
+		int entryCount;
+		if ( b2IsLeaf( node ) )
+		{
+			// Only the root
+			entries[0] = item.nodeIndex;
+			entryCount = 1;
+		}
+		else
+		{
+			entries[0] = node->child1;
+			entries[1] = node->child2;
+			entryCount = 2;
+		}
+
+		// Open the largest internal child in place until there are four children
+		while ( entryCount < 4 )
+		{
+			int bestIndex = -1;
+			float bestArea = -1.0f;
+			for ( int i = 0; i < entryCount; ++i )
+			{
+				const b2TreeNode* entry = nodes + entries[i];
+				if ( b2IsLeaf( entry ) == false && b2Perimeter( entry->aabb ) > bestArea )
+				{
+					bestIndex = i;
+					bestArea = b2Perimeter( entry->aabb );
+				}
+			}
+
+			if ( bestIndex == -1 )
+			{
+				break;
+			}
+
+			const b2TreeNode* opened = nodes + entries[bestIndex];
+			wideSlots[entries[bestIndex]] = B2_NULL_INDEX;
+			for ( int i = entryCount; i > bestIndex + 1; --i )
+			{
+				entries[i] = entries[i - 1];
+			}
+			entries[bestIndex] = opened->child1;
+			entries[bestIndex + 1] = opened->child2;
+			entryCount += 1;
+		}
+
+		b2WideTreeNode* wide = wideNodes + item.wideIndex;
+		for ( int i = 0; i < 4; ++i )
+		{
+			if ( i >= entryCount )
+			{
+				// Never overlaps and never passes the mask
+				wide->lowerX[i] = FLT_MAX;
+				wide->lowerY[i] = FLT_MAX;
+				wide->upperX[i] = -FLT_MAX;
+				wide->upperY[i] = -FLT_MAX;
+				wide->categoryBits[i] = 0;
+				wide->children[i] = B2_NULL_INDEX;
+				continue;
+			}
+
+			int32_t childIndex = entries[i];
+			const b2TreeNode* child = nodes + childIndex;
+			wide->lowerX[i] = child->aabb.lowerBound.x;
+			wide->lowerY[i] = child->aabb.lowerBound.y;
+			wide->upperX[i] = child->aabb.upperBound.x;
+			wide->upperY[i] = child->aabb.upperBound.y;
+			wide->categoryBits[i] = child->categoryBits;
+			wideSlots[childIndex] = 4 * item.wideIndex + i;
+
+			if ( b2IsLeaf( child ) )
+			{
+				wide->children[i] = ~childIndex;
+			}
+			else
+			{
+				B2_ASSERT( wideCount < maxWideCount );
+				B2_ASSERT( stackCount < b2_treeStackSize );
+				if ( stackCount == b2_treeStackSize )
+				{
+					// Degenerate tree, queries keep using the binary tree
+					return;
+				}
+
+				wide->children[i] = wideCount;
+				stack[stackCount++] = ( b2WideBuildItem ){ childIndex, wideCount };
+				wideCount += 1;
+			}
+		}
+	}
+
+	tree->wideNodeCount = wideCount;
+}
@@ -0,0 +1,11 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+typedef struct b2World b2World;
+
+// Same as b2DynamicTree_Rebuild, large trees build their subtrees as tasks of the world. May be called from a task.
+int32_t b2DynamicTree_RebuildParallel( b2DynamicTree* tree, bool fullBuild, b2World* world );
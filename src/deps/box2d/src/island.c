@@ -3,6 +3,7 @@
 
 #include "island.h"
 
+#include "arena_allocator.h"
 #include "body.h"
 #include "contact.h"
 #include "core.h"
@@ -593,9 +594,72 @@ void b2MergeAwakeIslands( b2World* world )
 
 #define B2_CONTACT_REMOVE_THRESHOLD 1
 
-void b2SplitIsland( b2World* world, int baseId )
+void b2AddSplitCandidate( b2SplitCandidates* candidates, int islandId, float sleepTime )
 {
-	b2Island* baseIsland = b2IslandArray_Get( &world->islands, baseId );
+	int count = candidates->count;
+
+	// An island is listed once with the largest sleep time of its bodies
+	for ( int i = 0; i < count; ++i )
+	{
+		if ( candidates->islandIds[i] != islandId )
+		{
+			continue;
+		}
+
+		if ( sleepTime <= candidates->sleepTimes[i] )
+		{
+			return;
+		}
+
+		// Remove and insert again below with the new sleep time
+		for ( int j = i + 1; j < count; ++j )
+		{
+			candidates->islandIds[j - 1] = candidates->islandIds[j];
+			candidates->sleepTimes[j - 1] = candidates->sleepTimes[j];
+		}
+		count -= 1;
+		break;
+	}
+
+	// Tie breaking for determinism. Largest island id wins. Needed due to work stealing.
+	int index = count;
+	while ( index > 0 )
+	{
+		float otherTime = candidates->sleepTimes[index - 1];
+		if ( otherTime > sleepTime || ( otherTime == sleepTime && candidates->islandIds[index - 1] > islandId ) )
+		{
+			break;
+		}
+		index -= 1;
+	}
+
+	if ( index == b2_maxSplitIslands )
+	{
+		candidates->count = count;
+		return;
+	}
+
+	// Drop the last candidate when full
+	int last = b2MinInt( count, b2_maxSplitIslands - 1 );
+	for ( int j = last; j > index; --j )
+	{
+		candidates->islandIds[j] = candidates->islandIds[j - 1];
+		candidates->sleepTimes[j] = candidates->sleepTimes[j - 1];
+	}
+
+	candidates->islandIds[index] = islandId;
+	candidates->sleepTimes[index] = sleepTime;
+	candidates->count = last + 1;
+}
+
+// Finds the connected components of the base island with a depth first search. This only touches
+// the bodies, contacts and joints of the base island, so different islands can be searched in parallel.
+static void b2FindSplitIslands( b2World* world, b2IslandSplit* split, b2ArenaAllocator* arena )
+{
+	split->islands = NULL;
+	split->islandCount = 0;
+
+	b2Island* baseIsland = b2IslandArray_Get( &world->islands, split->baseId );
 	int setIndex = baseIsland->setIndex;
 
 	if ( setIndex != b2_awakeSet )
@@ -610,16 +674,17 @@ void b2SplitIsland( b2World* world, int baseId )
 		return;
 	}
 
-	b2ValidateIsland( world, baseId );
+	b2ValidateIsland( world, split->baseId );
 
 	int bodyCount = baseIsland->bodyCount;
 
 	b2Body* bodies = world->bodies.data;
-	b2StackAllocator* alloc = &world->stackAllocator;
 
-	// No lock is needed because I ensure the allocator is not used while this task is active.
-	int* stack = b2AllocateStackItem( alloc, bodyCount * sizeof( int ), "island stack" );
-	int* bodyIds = b2AllocateStackItem( alloc, bodyCount * sizeof( int ), "body ids" );
+	// Scratch memory comes from the arena of the calling worker and is released at the next step
+	int* stack = b2AllocateArenaItem( arena, bodyCount * sizeof( int ) );
+	int* bodyIds = b2AllocateArenaItem( arena, bodyCount * sizeof( int ) );
+	b2Island* islands = b2AllocateArenaItem( arena, bodyCount * sizeof( b2Island ) );
+	int islandCount = 0;
 
 	// Build array containing all body indices from base island. These
 	// serve as seed bodies for the depth first search (DFS).
@@ -656,9 +721,6 @@ void b2SplitIsland( b2World* world, int baseId )
 		nextJoint = joint->islandNext;
 	}
 
-	// Done with the base split island.
-	b2DestroyIsland( world, baseId );
-
 	// Each island is found as a depth first search starting from a seed body
 	for ( int i = 0; i < bodyCount; ++i )
 	{
@@ -676,12 +738,18 @@ void b2SplitIsland( b2World* world, int baseId )
 		stack[stackCount++] = seedIndex;
 		seed->isMarked = true;
 
-		// Create new island
-		// No lock needed because only a single island can split per time step. No islands are being used during the constraint
-		// solve. However, islands are touched during body finalization.
-		b2Island* island = b2CreateIsland( world, setIndex );
+		// The island is created later by b2CreateSplitIslands
+		b2Island* island = islands + islandCount;
+		islandCount += 1;
 
-		int islandId = island->islandId;
+		*island = ( b2Island ){ 0 };
+		island->islandId = B2_NULL_INDEX;
+		island->headBody = B2_NULL_INDEX;
+		island->tailBody = B2_NULL_INDEX;
+		island->headContact = B2_NULL_INDEX;
+		island->tailContact = B2_NULL_INDEX;
+		island->headJoint = B2_NULL_INDEX;
+		island->tailJoint = B2_NULL_INDEX;
 
 		// Perform a depth first search (DFS) on the constraint graph.
 		while ( stackCount > 0 )
@@ -693,7 +761,6 @@ void b2SplitIsland( b2World* world, int baseId )
 			B2_ASSERT( body->isMarked == true );
 
 			// Add body to island
-			body->islandId = islandId;
 			if ( island->tailBody != B2_NULL_INDEX )
 			{
 				bodies[island->tailBody].islandNext = bodyId;
@@ -755,7 +822,6 @@ void b2SplitIsland( b2World* world, int baseId )
 				}
 
 				// Add contact to island
-				contact->islandId = islandId;
 				if ( island->tailContact != B2_NULL_INDEX )
 				{
 					b2Contact* tailContact = b2ContactArray_Get( &world->contacts, island->tailContact );
@@ -813,7 +879,6 @@ void b2SplitIsland( b2World* world, int baseId )
 				}
 
 				// Add joint to island
-				joint->islandId = islandId;
 				if ( island->tailJoint != B2_NULL_INDEX )
 				{
 					b2Joint* tailJoint = b2JointArray_Get( &world->joints, island->tailJoint );
@@ -831,40 +896,133 @@ void b2SplitIsland( b2World* world, int baseId )
 				island->jointCount += 1;
 			}
 		}
+	}
+
+	split->islands = islands;
+	split->islandCount = islandCount;
+}
+
+// Replaces the base island with the islands found by the search. Island ids are allocated in
+// the order of the splits and then the order of the search, so they are deterministic.
+static void b2CreateSplitIslandsForBase( b2World* world, b2IslandSplit* split )
+{
+	if ( split->islandCount == 0 )
+	{
+		return;
+	}
+
+	// Done with the base split island.
+	b2DestroyIsland( world, split->baseId );
+
+	for ( int i = 0; i < split->islandCount; ++i )
+	{
+		b2Island* found = split->islands + i;
+		b2Island* island = b2CreateIsland( world, b2_awakeSet );
+
+		island->headBody = found->headBody;
+		island->tailBody = found->tailBody;
+		island->bodyCount = found->bodyCount;
+		island->headContact = found->headContact;
+		island->tailContact = found->tailContact;
+		island->contactCount = found->contactCount;
+		island->headJoint = found->headJoint;
+		island->tailJoint = found->tailJoint;
+		island->jointCount = found->jointCount;
+
+		found->islandId = island->islandId;
+	}
+}
+
+// Stores the new island ids on the bodies, contacts and joints of the split
+static void b2LinkSplitIslands( b2World* world, b2IslandSplit* split )
+{
+	b2Body* bodies = world->bodies.data;
+
+	for ( int i = 0; i < split->islandCount; ++i )
+	{
+		const b2Island* found = split->islands + i;
+		int islandId = found->islandId;
+		B2_ASSERT( islandId != B2_NULL_INDEX );
+
+		int bodyId = found->headBody;
+		while ( bodyId != B2_NULL_INDEX )
+		{
+			b2Body* body = bodies + bodyId;
+			body->islandId = islandId;
+			bodyId = body->islandNext;
+		}
+
+		int contactId = found->headContact;
+		while ( contactId != B2_NULL_INDEX )
+		{
+			b2Contact* contact = b2ContactArray_Get( &world->contacts, contactId );
+			contact->islandId = islandId;
+			contactId = contact->islandNext;
+		}
+
+		int jointId = found->headJoint;
+		while ( jointId != B2_NULL_INDEX )
+		{
+			b2Joint* joint = b2JointArray_Get( &world->joints, jointId );
+			joint->islandId = islandId;
+			jointId = joint->islandNext;
+		}
 
 		b2ValidateIsland( world, islandId );
 	}
+}
 
-	b2FreeStackItem( alloc, bodyIds );
-	b2FreeStackItem( alloc, stack );
+void b2SplitIsland( b2World* world, int baseId, b2ArenaAllocator* arena )
+{
+	b2IslandSplit split = { .baseId = baseId };
+	b2FindSplitIslands( world, &split, arena );
+	b2CreateSplitIslandsForBase( world, &split );
+	b2LinkSplitIslands( world, &split );
 }
 
-// Split an island because some contacts and/or joints have been removed.
+// Split islands because some contacts and/or joints have been removed.
 // This is called during the constraint solve while islands are not being touched. This uses DFS and touches a lot of memory,
 // so it can be quite slow.
 // Note: contacts/joints connected to static bodies must belong to an island but don't affect island connectivity
 // Note: static bodies are never in an island
-// Note: this task interacts with some allocators without locks under the assumption that no other tasks
-// are interacting with these data structures.
 void b2SplitIslandTask( int startIndex, int endIndex, uint32_t threadIndex, void* context )
 {
 	b2TracyCZoneNC( split, "Split Island", b2_colorHoneydew, true );
 
-	B2_MAYBE_UNUSED( startIndex );
-	B2_MAYBE_UNUSED( endIndex );
-	B2_MAYBE_UNUSED( threadIndex );
-
-	b2Timer timer = b2CreateTimer();
 	b2World* world = context;
+	b2ArenaAllocator* arena = &world->taskContexts.data[threadIndex].arena;
 
-	B2_ASSERT( world->splitIslandId != B2_NULL_INDEX );
-
-	b2SplitIsland( world, world->splitIslandId );
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2FindSplitIslands( world, world->islandSplits + i, arena );
+	}
 
-	world->profile.splitIslands += b2GetMilliseconds( &timer );
 	b2TracyCZoneEnd( split );
 }
 
+void b2CreateSplitIslands( b2World* world )
+{
+	for ( int i = 0; i < world->splitCandidates.count; ++i )
+	{
+		b2CreateSplitIslandsForBase( world, world->islandSplits + i );
+	}
+}
+
+void b2LinkSplitIslandsTask( int startIndex, int endIndex, uint32_t threadIndex, void* context )
+{
+	b2TracyCZoneNC( link_split, "Link Split Islands", b2_colorHoneydew, true );
+
+	B2_MAYBE_UNUSED( threadIndex );
+
+	b2World* world = context;
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2LinkSplitIslands( world, world->islandSplits + i );
+	}
+
+	b2TracyCZoneEnd( link_split );
+}
+
 #if B2_VALIDATE
 void b2ValidateIsland( b2World* world, int islandId )
 {
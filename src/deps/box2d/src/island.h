@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef struct b2ArenaAllocator b2ArenaAllocator;
 typedef struct b2Body b2Body;
 typedef struct b2Contact b2Contact;
 typedef struct b2Joint b2Joint;
@@ -64,6 +65,30 @@ typedef struct b2IslandSim
 
 } b2IslandSim;
 
+// Maximum number of islands split per time step. The splits run in parallel.
+#define b2_maxSplitIslands 8
+
+// The sleepiest islands that need to be split before they can sleep. Sorted by decreasing sleep time
+// and then by decreasing island id, so the order doesn't depend on how bodies are spread over workers.
+typedef struct b2SplitCandidates
+{
+	int islandIds[b2_maxSplitIslands];
+	float sleepTimes[b2_maxSplitIslands];
+	int count;
+} b2SplitCandidates;
+
+// Islands found by splitting an island. The depth first search runs in parallel for different base
+// islands and only links the bodies, contacts and joints of each new island. The islands are created
+// afterwards on a single thread because that touches the island id pool and the awake solver set.
+typedef struct b2IslandSplit
+{
+	int baseId;
+
+	// Only the body, contact and joint lists are valid until b2CreateSplitIslands assigns the ids
+	b2Island* islands;
+	int islandCount;
+} b2IslandSplit;
+
 b2Island* b2CreateIsland( b2World* world, int setIndex );
 void b2DestroyIsland( b2World* world, int islandId );
 
@@ -81,8 +106,19 @@ void b2UnlinkJoint( b2World* world, b2Joint* joint );
 
 void b2MergeAwakeIslands( b2World* world );
 
-void b2SplitIsland( b2World* world, int baseId );
+// Adds an island with a body that wants to sleep. Keeps the largest sleep time of each island.
+void b2AddSplitCandidate( b2SplitCandidates* candidates, int islandId, float sleepTime );
+
+// Splits one island right away
+void b2SplitIsland( b2World* world, int baseId, b2ArenaAllocator* arena );
+
+// Splitting the candidates of the previous step has three phases:
+// - b2SplitIslandTask finds the new islands of each candidate in parallel
+// - b2CreateSplitIslands replaces the base islands with the new islands on one thread
+// - b2LinkSplitIslandsTask stores the new island ids on the bodies, contacts and joints in parallel
 void b2SplitIslandTask( int startIndex, int endIndex, uint32_t threadIndex, void* context );
+void b2CreateSplitIslands( b2World* world );
+void b2LinkSplitIslandsTask( int startIndex, int endIndex, uint32_t threadIndex, void* context );
 
 void b2ValidateIsland( b2World* world, int islandId );
 
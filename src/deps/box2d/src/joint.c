@@ -1234,9 +1234,12 @@ void b2DrawJoint( b2DebugDraw* draw, b2World* world, b2Joint* joint )
 
 	if ( draw->drawGraphColors )
 	{
-		b2HexColor colors[b2_graphColorCount] = { b2_colorRed,		 b2_colorOrange,	b2_colorYellow, b2_colorGreen,
-												  b2_colorCyan,		 b2_colorBlue,		b2_colorViolet, b2_colorPink,
-												  b2_colorChocolate, b2_colorGoldenrod, b2_colorCoral,	b2_colorBlack };
+		b2HexColor colors[b2_graphColorCount] = { b2_colorRed,		 b2_colorOrange,	b2_colorYellow,	 b2_colorGreen,
+												  b2_colorCyan,		 b2_colorBlue,		b2_colorViolet,	 b2_colorPink,
+												  b2_colorChocolate, b2_colorGoldenrod, b2_colorCoral,	 b2_colorCrimson,
+												  b2_colorGold,		 b2_colorIndigo,	b2_colorKhaki,	 b2_colorMaroon,
+												  b2_colorOlive,	 b2_colorOrchid,	b2_colorPlum,	 b2_colorSeaGreen,
+												  b2_colorSkyBlue,	 b2_colorTeal,		b2_colorTomato,	 b2_colorBlack };
 
 		int colorIndex = joint->colorIndex;
 		if ( colorIndex != B2_NULL_INDEX )
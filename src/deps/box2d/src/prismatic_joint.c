@@ -13,6 +13,18 @@
 
 #include <stdio.h>
 
+b2Vec2 b2PrismaticJoint_GetLocalAxisA( b2JointId jointId )
+{
+	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	return joint->prismaticJoint.localAxisA;
+}
+
+float b2PrismaticJoint_GetReferenceAngle( b2JointId jointId )
+{
+	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	return joint->prismaticJoint.referenceAngle;
+}
+
 void b2PrismaticJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
 	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
@@ -0,0 +1,637 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "proxy_grid.h"
+
+#include "aabb.h"
+#include "core.h"
+
+#include "box2d/math_functions.h"
+
+#include <math.h>
+#include <string.h>
+
+B2_ARRAY_SOURCE( b2GridProxy, b2GridProxy );
+B2_ARRAY_SOURCE( b2GridEntry, b2GridEntry );
+
+// Proxies covering more cells stay loose. They would add too many entries and move between cells often.
+#define b2_maxGridProxyCells 16
+
+// Keeps cell coordinates and their products in range for proxies far from the origin
+#define b2_maxGridCoordinate ( 1 << 24 )
+
+static inline int b2GridCoordinate( float x, float inv_cellSize )
+{
+	float c = floorf( x * inv_cellSize );
+	c = b2ClampFloat( c, -(float)b2_maxGridCoordinate, (float)b2_maxGridCoordinate );
+	return (int)c;
+}
+
+static inline b2GridCells b2ComputeCells( const b2ProxyGrid* grid, b2AABB aabb )
+{
+	float s = grid->inv_cellSize;
+	b2GridCells cells = {
+		b2GridCoordinate( aabb.lowerBound.x, s ),
+		b2GridCoordinate( aabb.lowerBound.y, s ),
+		b2GridCoordinate( aabb.upperBound.x, s ),
+		b2GridCoordinate( aabb.upperBound.y, s ),
+	};
+	return cells;
+}
+
+static inline int64_t b2GetCellCount( b2GridCells cells )
+{
+	return (int64_t)( cells.upperX - cells.lowerX + 1 ) * (int64_t)( cells.upperY - cells.lowerY + 1 );
+}
+
+static inline bool b2SameCells( b2GridCells a, b2GridCells b )
+{
+	return a.lowerX == b.lowerX && a.lowerY == b.lowerY && a.upperX == b.upperX && a.upperY == b.upperY;
+}
+
+static inline int b2GridHash( int x, int y, int mask )
+{
+	uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	return (int)( h & (uint32_t)mask );
+}
+
+b2ProxyGrid b2ProxyGrid_Create( float cellSize )
+{
+	B2_ASSERT( b2IsValid( cellSize ) && cellSize > 0.0f );
+
+	b2ProxyGrid grid = { 0 };
+	grid.proxies = b2GridProxyArray_Create( 16 );
+	grid.proxyIdPool = b2CreateIdPool();
+	grid.cellSize = cellSize;
+	grid.inv_cellSize = 1.0f / cellSize;
+	grid.looseProxies = b2IntArray_Create( 16 );
+	grid.entries = b2GridEntryArray_Create( 0 );
+	grid.bucketStarts = b2IntArray_Create( 0 );
+	return grid;
+}
+
+void b2ProxyGrid_Destroy( b2ProxyGrid* grid )
+{
+	b2GridProxyArray_Destroy( &grid->proxies );
+	b2DestroyIdPool( &grid->proxyIdPool );
+	b2IntArray_Destroy( &grid->looseProxies );
+	b2GridEntryArray_Destroy( &grid->entries );
+	b2IntArray_Destroy( &grid->bucketStarts );
+	memset( grid, 0, sizeof( b2ProxyGrid ) );
+}
+
+static void b2AddLoose( b2ProxyGrid* grid, int proxyId )
+{
+	b2GridProxy* proxy = grid->proxies.data + proxyId;
+	B2_ASSERT( proxy->state != b2_gridProxyLoose );
+
+	proxy->state = b2_gridProxyLoose;
+	proxy->looseIndex = grid->looseProxies.count;
+	b2IntArray_Push( &grid->looseProxies, proxyId );
+
+	// The loose order follows the order of the calls, which may not be deterministic. The rebuild restores
+	// id order.
+	grid->needsRebuild = true;
+}
+
+static void b2RemoveLoose( b2ProxyGrid* grid, int proxyId )
+{
+	b2GridProxy* proxy = grid->proxies.data + proxyId;
+	B2_ASSERT( proxy->state == b2_gridProxyLoose );
+
+	int movedIndex = b2IntArray_RemoveSwap( &grid->looseProxies, proxy->looseIndex );
+	if ( movedIndex != B2_NULL_INDEX )
+	{
+		int movedId = grid->looseProxies.data[proxy->looseIndex];
+		grid->proxies.data[movedId].looseIndex = proxy->looseIndex;
+	}
+
+	proxy->looseIndex = B2_NULL_INDEX;
+}
+
+int b2ProxyGrid_CreateProxy( b2ProxyGrid* grid, b2AABB aabb, uint64_t categoryBits, int userData )
+{
+	B2_ASSERT( -b2_huge < aabb.lowerBound.x && aabb.lowerBound.x < b2_huge );
+	B2_ASSERT( -b2_huge < aabb.lowerBound.y && aabb.lowerBound.y < b2_huge );
+	B2_ASSERT( -b2_huge < aabb.upperBound.x && aabb.upperBound.x < b2_huge );
+	B2_ASSERT( -b2_huge < aabb.upperBound.y && aabb.upperBound.y < b2_huge );
+
+	int proxyId = b2AllocId( &grid->proxyIdPool );
+	if ( proxyId == grid->proxies.count )
+	{
+		b2GridProxyArray_Push( &grid->proxies, ( b2GridProxy ){ 0 } );
+	}
+
+	b2GridProxy* proxy = grid->proxies.data + proxyId;
+	B2_ASSERT( proxy->state == b2_gridProxyFree );
+	proxy->aabb = aabb;
+	proxy->categoryBits = categoryBits;
+	proxy->userData = userData;
+	proxy->cells = b2ComputeCells( grid, aabb );
+	proxy->looseIndex = B2_NULL_INDEX;
+
+	b2AddLoose( grid, proxyId );
+	grid->proxyCount += 1;
+
+	return proxyId;
+}
+
+void b2ProxyGrid_DestroyProxy( b2ProxyGrid* grid, int proxyId )
+{
+	B2_ASSERT( 0 <= proxyId && proxyId < grid->proxies.count );
+	b2GridProxy* proxy = grid->proxies.data + proxyId;
+	B2_ASSERT( proxy->state != b2_gridProxyFree );
+
+	if ( proxy->state == b2_gridProxyLoose )
+	{
+		b2RemoveLoose( grid, proxyId );
+	}
+
+	// Entries of a binned proxy stay until the next rebuild and are skipped by the state check
+	proxy->state = b2_gridProxyFree;
+	b2FreeId( &grid->proxyIdPool, proxyId );
+	grid->proxyCount -= 1;
+}
+
+void b2ProxyGrid_MoveProxy( b2ProxyGrid* grid, int proxyId, b2AABB aabb )
+{
+	B2_ASSERT( b2AABB_IsValid( aabb ) );
+	B2_ASSERT( 0 <= proxyId && proxyId < grid->proxies.count );
+	b2GridProxy* proxy = grid->proxies.data + proxyId;
+	B2_ASSERT( proxy->state != b2_gridProxyFree );
+
+	proxy->aabb = aabb;
+
+	b2GridCells cells = b2ComputeCells( grid, aabb );
+	if ( b2SameCells( cells, proxy->cells ) )
+	{
+		return;
+	}
+
+	proxy->cells = cells;
+
+	if ( proxy->state == b2_gridProxyBinned )
+	{
+		b2AddLoose( grid, proxyId );
+	}
+	else if ( b2GetCellCount( cells ) <= b2_maxGridProxyCells )
+	{
+		// A large loose proxy now fits
+		grid->needsRebuild = true;
+	}
+}
+
+void b2ProxyGrid_Rebuild( b2ProxyGrid* grid )
+{
+	if ( grid->needsRebuild == false )
+	{
+		return;
+	}
+
+	grid->needsRebuild = false;
+
+	b2GridProxy* proxies = grid->proxies.data;
+	int proxyCapacity = grid->proxies.count;
+
+	// Bin the loose proxies that fit and keep the others loose in id order
+	b2IntArray_Clear( &grid->looseProxies );
+	int entryCount = 0;
+	for ( int proxyId = 0; proxyId < proxyCapacity; ++proxyId )
+	{
+		b2GridProxy* proxy = proxies + proxyId;
+		if ( proxy->state == b2_gridProxyFree )
+		{
+			continue;
+		}
+
+		int64_t cellCount = b2GetCellCount( proxy->cells );
+		if ( cellCount <= b2_maxGridProxyCells )
+		{
+			proxy->state = b2_gridProxyBinned;
+			proxy->looseIndex = B2_NULL_INDEX;
+			entryCount += (int)cellCount;
+		}
+		else
+		{
+			B2_ASSERT( proxy->state == b2_gridProxyLoose );
+			proxy->looseIndex = grid->looseProxies.count;
+			b2IntArray_Push( &grid->looseProxies, proxyId );
+		}
+	}
+
+	int bucketCount = 16;
+	while ( bucketCount < entryCount )
+	{
+		bucketCount <<= 1;
+	}
+
+	int mask = bucketCount - 1;
+	grid->bucketMask = mask;
+
+	b2IntArray_Resize( &grid->bucketStarts, bucketCount + 1 );
+	b2GridEntryArray_Resize( &grid->entries, entryCount );
+
+	int* starts = grid->bucketStarts.data;
+	b2GridEntry* entries = grid->entries.data;
+	memset( starts, 0, ( bucketCount + 1 ) * sizeof( int ) );
+
+	// Counting sort by bucket. Filling backwards from the bucket ends leaves each bucket sorted by proxy id.
+	for ( int proxyId = 0; proxyId < proxyCapacity; ++proxyId )
+	{
+		const b2GridProxy* proxy = proxies + proxyId;
+		if ( proxy->state != b2_gridProxyBinned )
+		{
+			continue;
+		}
+
+		b2GridCells c = proxy->cells;
+		for ( int y = c.lowerY; y <= c.upperY; ++y )
+		{
+			for ( int x = c.lowerX; x <= c.upperX; ++x )
+			{
+				starts[b2GridHash( x, y, mask )] += 1;
+			}
+		}
+	}
+
+	int sum = 0;
+	for ( int i = 0; i < bucketCount; ++i )
+	{
+		sum += starts[i];
+		starts[i] = sum;
+	}
+	starts[bucketCount] = sum;
+
+	for ( int proxyId = proxyCapacity - 1; proxyId >= 0; --proxyId )
+	{
+		const b2GridProxy* proxy = proxies + proxyId;
+		if ( proxy->state != b2_gridProxyBinned )
+		{
+			continue;
+		}
+
+		b2GridCells c = proxy->cells;
+		for ( int y = c.upperY; y >= c.lowerY; --y )
+		{
+			for ( int x = c.upperX; x >= c.lowerX; --x )
+			{
+				int index = --starts[b2GridHash( x, y, mask )];
+				entries[index] = ( b2GridEntry ){ x, y, proxyId };
+			}
+		}
+	}
+}
+
+void b2ProxyGrid_Query( const b2ProxyGrid* grid, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
+						void* context )
+{
+	const b2GridProxy* proxies = grid->proxies.data;
+	b2GridCells cells = b2ComputeCells( grid, aabb );
+
+	// Large queries are cheaper as a scan
+	if ( b2GetCellCount( cells ) > grid->entries.count )
+	{
+		int proxyCapacity = grid->proxies.count;
+		for ( int proxyId = 0; proxyId < proxyCapacity; ++proxyId )
+		{
+			const b2GridProxy* proxy = proxies + proxyId;
+			if ( proxy->state == b2_gridProxyFree || ( proxy->categoryBits & maskBits ) == 0 ||
+				 b2AABB_Overlaps( proxy->aabb, aabb ) == false )
+			{
+				continue;
+			}
+
+			if ( callback( proxyId, proxy->userData, context ) == false )
+			{
+				return;
+			}
+		}
+
+		return;
+	}
+
+	const b2GridEntry* entries = grid->entries.data;
+	const int* starts = grid->bucketStarts.data;
+	int mask = grid->bucketMask;
+
+	for ( int y = cells.lowerY; y <= cells.upperY; ++y )
+	{
+		for ( int x = cells.lowerX; x <= cells.upperX; ++x )
+		{
+			int bucket = b2GridHash( x, y, mask );
+			int end = starts[bucket + 1];
+			for ( int i = starts[bucket]; i < end; ++i )
+			{
+				const b2GridEntry* entry = entries + i;
+				if ( entry->cellX != x || entry->cellY != y )
+				{
+					continue;
+				}
+
+				int proxyId = entry->proxyId;
+				const b2GridProxy* proxy = proxies + proxyId;
+				if ( proxy->state != b2_gridProxyBinned )
+				{
+					continue;
+				}
+
+				// A proxy spanning several cells is only reported in the first cell it shares with the query
+				if ( x != b2MaxInt( cells.lowerX, proxy->cells.lowerX ) || y != b2MaxInt( cells.lowerY, proxy->cells.lowerY ) )
+				{
+					continue;
+				}
+
+				if ( ( proxy->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( proxy->aabb, aabb ) == false )
+				{
+					continue;
+				}
+
+				if ( callback( proxyId, proxy->userData, context ) == false )
+				{
+					return;
+				}
+			}
+		}
+	}
+
+	const int* looseProxies = grid->looseProxies.data;
+	int looseCount = grid->looseProxies.count;
+	for ( int i = 0; i < looseCount; ++i )
+	{
+		int proxyId = looseProxies[i];
+		const b2GridProxy* proxy = proxies + proxyId;
+		if ( ( proxy->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( proxy->aabb, aabb ) == false )
+		{
+			continue;
+		}
+
+		if ( callback( proxyId, proxy->userData, context ) == false )
+		{
+			return;
+		}
+	}
+}
+
+// Shared state of ray and shape casts. A ray is a shape cast of a point.
+typedef struct b2GridCast
+{
+	const b2RayCastInput* rayInput;
+	const b2ShapeCastInput* shapeInput;
+	b2TreeRayCastCallbackFcn* rayCallback;
+	b2TreeShapeCastCallbackFcn* shapeCallback;
+	void* context;
+	uint64_t maskBits;
+
+	b2AABB originAABB;
+	b2Vec2 translation;
+	b2Vec2 p1;
+	b2Vec2 extension;
+	b2Vec2 v;
+	b2Vec2 abs_v;
+
+	float maxFraction;
+	b2AABB totalAABB;
+} b2GridCast;
+
+static void b2UpdateCastAABB( b2GridCast* cast )
+{
+	b2Vec2 t = b2MulSV( cast->maxFraction, cast->translation );
+	cast->totalAABB.lowerBound = b2Min( cast->originAABB.lowerBound, b2Add( cast->originAABB.lowerBound, t ) );
+	cast->totalAABB.upperBound = b2Max( cast->originAABB.upperBound, b2Add( cast->originAABB.upperBound, t ) );
+}
+
+// Returns false when the client terminated the cast
+static bool b2CastProxy( b2GridCast* cast, const b2GridProxy* proxy, int proxyId )
+{
+	if ( ( proxy->categoryBits & cast->maskBits ) == 0 || b2AABB_Overlaps( proxy->aabb, cast->totalAABB ) == false )
+	{
+		return true;
+	}
+
+	// Separating axis for segment (Gino, p80).
+	// |dot(v, p1 - c)| > dot(|v|, h)
+	b2Vec2 c = b2AABB_Center( proxy->aabb );
+	b2Vec2 h = b2Add( b2AABB_Extents( proxy->aabb ), cast->extension );
+	float term1 = b2AbsFloat( b2Dot( cast->v, b2Sub( cast->p1, c ) ) );
+	float term2 = b2Dot( cast->abs_v, h );
+	if ( term2 < term1 )
+	{
+		return true;
+	}
+
+	float value;
+	if ( cast->rayInput != NULL )
+	{
+		b2RayCastInput subInput = *cast->rayInput;
+		subInput.maxFraction = cast->maxFraction;
+		value = cast->rayCallback( &subInput, proxyId, proxy->userData, cast->context );
+	}
+	else
+	{
+		b2ShapeCastInput subInput = *cast->shapeInput;
+		subInput.maxFraction = cast->maxFraction;
+		value = cast->shapeCallback( &subInput, proxyId, proxy->userData, cast->context );
+	}
+
+	if ( value == 0.0f )
+	{
+		// The client has terminated the cast.
+		return false;
+	}
+
+	if ( 0.0f < value && value < cast->maxFraction )
+	{
+		cast->maxFraction = value;
+		b2UpdateCastAABB( cast );
+	}
+
+	return true;
+}
+
+static void b2CastGrid( const b2ProxyGrid* grid, b2GridCast* cast )
+{
+	cast->p1 = b2AABB_Center( cast->originAABB );
+	cast->extension = b2AABB_Extents( cast->originAABB );
+	cast->v = b2CrossSV( 1.0f, cast->translation );
+	cast->abs_v = b2Abs( cast->v );
+	b2UpdateCastAABB( cast );
+
+	const b2GridProxy* proxies = grid->proxies.data;
+	b2GridCells cells = b2ComputeCells( grid, cast->totalAABB );
+
+	if ( b2GetCellCount( cells ) > grid->entries.count )
+	{
+		int proxyCapacity = grid->proxies.count;
+		for ( int proxyId = 0; proxyId < proxyCapacity; ++proxyId )
+		{
+			const b2GridProxy* proxy = proxies + proxyId;
+			if ( proxy->state != b2_gridProxyFree && b2CastProxy( cast, proxy, proxyId ) == false )
+			{
+				return;
+			}
+		}
+
+		return;
+	}
+
+	const b2GridEntry* entries = grid->entries.data;
+	const int* starts = grid->bucketStarts.data;
+	int mask = grid->bucketMask;
+
+	// Visit cells starting from the origin side so that early hits clip the rest. Cells outside the clipped
+	// cast are still visited because a proxy is only reported in its first cell of the initial range.
+	int stepX = cast->translation.x < 0.0f ? -1 : 1;
+	int stepY = cast->translation.y < 0.0f ? -1 : 1;
+	int firstX = stepX > 0 ? cells.lowerX : cells.upperX;
+	int firstY = stepY > 0 ? cells.lowerY : cells.upperY;
+	int countX = cells.upperX - cells.lowerX + 1;
+	int countY = cells.upperY - cells.lowerY + 1;
+
+	for ( int j = 0, y = firstY; j < countY; ++j, y += stepY )
+	{
+		for ( int i = 0, x = firstX; i < countX; ++i, x += stepX )
+		{
+			int bucket = b2GridHash( x, y, mask );
+			int end = starts[bucket + 1];
+			for ( int k = starts[bucket]; k < end; ++k )
+			{
+				const b2GridEntry* entry = entries + k;
+				if ( entry->cellX != x || entry->cellY != y )
+				{
+					continue;
+				}
+
+				int proxyId = entry->proxyId;
+				const b2GridProxy* proxy = proxies + proxyId;
+				if ( proxy->state != b2_gridProxyBinned )
+				{
+					continue;
+				}
+
+				if ( x != b2MaxInt( cells.lowerX, proxy->cells.lowerX ) || y != b2MaxInt( cells.lowerY, proxy->cells.lowerY ) )
+				{
+					continue;
+				}
+
+				if ( b2CastProxy( cast, proxy, proxyId ) == false )
+				{
+					return;
+				}
+			}
+		}
+	}
+
+	const int* looseProxies = grid->looseProxies.data;
+	int looseCount = grid->looseProxies.count;
+	for ( int i = 0; i < looseCount; ++i )
+	{
+		int proxyId = looseProxies[i];
+		if ( b2CastProxy( cast, proxies + proxyId, proxyId ) == false )
+		{
+			return;
+		}
+	}
+}
+
+void b2ProxyGrid_RayCast( const b2ProxyGrid* grid, const b2RayCastInput* input, uint64_t maskBits,
+						  b2TreeRayCastCallbackFcn* callback, void* context )
+{
+	b2GridCast cast = { 0 };
+	cast.rayInput = input;
+	cast.rayCallback = callback;
+	cast.context = context;
+	cast.maskBits = maskBits;
+	cast.originAABB = ( b2AABB ){ input->origin, input->origin };
+	cast.translation = input->translation;
+	cast.maxFraction = input->maxFraction;
+
+	b2CastGrid( grid, &cast );
+}
+
+void b2ProxyGrid_ShapeCast( const b2ProxyGrid* grid, const b2ShapeCastInput* input, uint64_t maskBits,
+							b2TreeShapeCastCallbackFcn* callback, void* context )
+{
+	if ( input->count == 0 )
+	{
+		return;
+	}
+
+	b2AABB originAABB = { input->points[0], input->points[0] };
+	for ( int i = 1; i < input->count; ++i )
+	{
+		originAABB.lowerBound = b2Min( originAABB.lowerBound, input->points[i] );
+		originAABB.upperBound = b2Max( originAABB.upperBound, input->points[i] );
+	}
+
+	b2Vec2 radius = { input->radius, input->radius };
+	originAABB.lowerBound = b2Sub( originAABB.lowerBound, radius );
+	originAABB.upperBound = b2Add( originAABB.upperBound, radius );
+
+	b2GridCast cast = { 0 };
+	cast.shapeInput = input;
+	cast.shapeCallback = callback;
+	cast.context = context;
+	cast.maskBits = maskBits;
+	cast.originAABB = originAABB;
+	cast.translation = input->translation;
+	cast.maxFraction = input->maxFraction;
+
+	b2CastGrid( grid, &cast );
+}
+
+int b2ProxyGrid_GetByteCount( const b2ProxyGrid* grid )
+{
+	size_t size = sizeof( b2ProxyGrid ) + sizeof( b2GridProxy ) * grid->proxies.capacity +
+				  sizeof( int ) * ( grid->proxyIdPool.freeArray.capacity + grid->looseProxies.capacity +
+									grid->bucketStarts.capacity ) +
+				  sizeof( b2GridEntry ) * grid->entries.capacity;
+
+	return (int)size;
+}
+
+void b2ProxyGrid_Validate( const b2ProxyGrid* grid )
+{
+#if B2_VALIDATE
+	int proxyCount = 0;
+	int proxyCapacity = grid->proxies.count;
+	for ( int proxyId = 0; proxyId < proxyCapacity; ++proxyId )
+	{
+		const b2GridProxy* proxy = grid->proxies.data + proxyId;
+		if ( proxy->state == b2_gridProxyFree )
+		{
+			continue;
+		}
+
+		proxyCount += 1;
+
+		b2GridCells cells = b2ComputeCells( grid, proxy->aabb );
+		B2_ASSERT( b2SameCells( cells, proxy->cells ) );
+
+		if ( proxy->state == b2_gridProxyLoose )
+		{
+			B2_ASSERT( grid->looseProxies.data[proxy->looseIndex] == proxyId );
+		}
+		else
+		{
+			B2_ASSERT( proxy->looseIndex == B2_NULL_INDEX );
+			B2_ASSERT( b2GetCellCount( cells ) <= b2_maxGridProxyCells );
+		}
+	}
+
+	B2_ASSERT( proxyCount == grid->proxyCount );
+	B2_ASSERT( proxyCount == b2GetIdCount( (b2IdPool*)&grid->proxyIdPool ) );
+
+	int entryCount = grid->entries.count;
+	for ( int i = 0; i < entryCount; ++i )
+	{
+		const b2GridEntry* entry = grid->entries.data + i;
+		int bucket = b2GridHash( entry->cellX, entry->cellY, grid->bucketMask );
+		B2_ASSERT( grid->bucketStarts.data[bucket] <= i && i < grid->bucketStarts.data[bucket + 1] );
+	}
+#else
+	B2_MAYBE_UNUSED( grid );
+#endif
+}
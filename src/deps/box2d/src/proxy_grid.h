@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "array.h"
+#include "id_pool.h"
+
+#include "box2d/collision.h"
+
+typedef enum b2GridProxyState
+{
+	b2_gridProxyFree,
+
+	// In the cells of the last rebuild
+	b2_gridProxyBinned,
+
+	// Created or moved to other cells since the last rebuild, or too large for the grid. Tested by every query.
+	b2_gridProxyLoose,
+} b2GridProxyState;
+
+// Inclusive range of cell coordinates
+typedef struct b2GridCells
+{
+	int lowerX, lowerY;
+	int upperX, upperY;
+} b2GridCells;
+
+typedef struct b2GridProxy
+{
+	b2AABB aabb;
+	uint64_t categoryBits;
+	int userData;
+
+	// Cells covered by the AABB
+	b2GridCells cells;
+
+	// Index in the loose array or B2_NULL_INDEX
+	int looseIndex;
+	b2GridProxyState state;
+} b2GridProxy;
+
+typedef struct b2GridEntry
+{
+	int cellX, cellY;
+	int proxyId;
+} b2GridEntry;
+
+B2_ARRAY_DECLARE( b2GridProxy, b2GridProxy );
+B2_ARRAY_DECLARE( b2GridEntry, b2GridEntry );
+
+/// Hashed uniform grid with the same interface as b2DynamicTree. Works well when proxies are about the
+/// size of a cell, such as piles of similar bodies, because moving a proxy within its cells costs nothing.
+/// Binned proxies are grouped by cell hash. Proxies that leave their cells become loose and are tested
+/// by every query until the next rebuild bins them again. Query order only depends on the proxy ids and
+/// the sequence of operations, so results are deterministic.
+typedef struct b2ProxyGrid
+{
+	b2GridProxyArray proxies;
+	b2IdPool proxyIdPool;
+	int proxyCount;
+
+	float cellSize;
+	float inv_cellSize;
+
+	// Loose proxies in the order they became loose
+	b2IntArray looseProxies;
+
+	// Binned proxies, one entry per covered cell, sorted by bucket and then by proxy id
+	b2GridEntryArray entries;
+
+	// Start of each bucket in the entries, bucketMask + 2 items when not empty
+	b2IntArray bucketStarts;
+	int bucketMask;
+
+	// A proxy that fits the grid became loose since the last rebuild
+	bool needsRebuild;
+} b2ProxyGrid;
+
+b2ProxyGrid b2ProxyGrid_Create( float cellSize );
+void b2ProxyGrid_Destroy( b2ProxyGrid* grid );
+
+int b2ProxyGrid_CreateProxy( b2ProxyGrid* grid, b2AABB aabb, uint64_t categoryBits, int userData );
+void b2ProxyGrid_DestroyProxy( b2ProxyGrid* grid, int proxyId );
+
+// Moving and enlarging are the same for the grid
+void b2ProxyGrid_MoveProxy( b2ProxyGrid* grid, int proxyId, b2AABB aabb );
+
+// Bin the loose proxies that fit the grid. Cost is linear in the binned proxy count.
+void b2ProxyGrid_Rebuild( b2ProxyGrid* grid );
+
+void b2ProxyGrid_Query( const b2ProxyGrid* grid, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
+						void* context );
+void b2ProxyGrid_RayCast( const b2ProxyGrid* grid, const b2RayCastInput* input, uint64_t maskBits,
+						  b2TreeRayCastCallbackFcn* callback, void* context );
+void b2ProxyGrid_ShapeCast( const b2ProxyGrid* grid, const b2ShapeCastInput* input, uint64_t maskBits,
+							b2TreeShapeCastCallbackFcn* callback, void* context );
+
+int b2ProxyGrid_GetByteCount( const b2ProxyGrid* grid );
+void b2ProxyGrid_Validate( const b2ProxyGrid* grid );
+
+static inline b2AABB b2ProxyGrid_GetAABB( const b2ProxyGrid* grid, int proxyId )
+{
+	B2_ASSERT( 0 <= proxyId && proxyId < grid->proxies.count );
+	return grid->proxies.data[proxyId].aabb;
+}
+
+static inline int b2ProxyGrid_GetUserData( const b2ProxyGrid* grid, int proxyId )
+{
+	B2_ASSERT( 0 <= proxyId && proxyId < grid->proxies.count );
+	return grid->proxies.data[proxyId].userData;
+}
+
+B2_ARRAY_INLINE( b2GridProxy, b2GridProxy );
+B2_ARRAY_INLINE( b2GridEntry, b2GridEntry );
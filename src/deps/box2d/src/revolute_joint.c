@@ -17,6 +17,12 @@
 
 #include <stdio.h>
 
+float b2RevoluteJoint_GetReferenceAngle( b2JointId jointId )
+{
+	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	return joint->revoluteJoint.referenceAngle;
+}
+
 void b2RevoluteJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
 	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
@@ -188,6 +188,82 @@ static void b2IntegratePositionsTask( int startIndex, int endIndex, b2StepContex
 	b2TracyCZoneEnd( integrate_positions );
 }
 
+static inline uint64_t b2MixChecksum( uint64_t hash, uint32_t value )
+{
+	// murmur3 finalizer step, spreads a single bit change over the whole word
+	hash ^= value;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+static inline uint64_t b2MixChecksumFloat( uint64_t hash, float value )
+{
+	union
+	{
+		float f;
+		uint32_t u;
+	} bits = { value };
+	return b2MixChecksum( hash, bits.u );
+}
+
+// Checksum of the awake bodies in [startIndex, endIndex) and of a proportional slice of the solver contacts, so
+// that each contact is visited by exactly one block. Items are hashed individually and summed, which makes the
+// result independent of how the range is split across workers.
+static uint64_t b2ComputeChecksum( int startIndex, int endIndex, b2StepContext* stepContext )
+{
+	b2World* world = stepContext->world;
+	b2BodyState* states = stepContext->states;
+	b2BodySim* sims = stepContext->sims;
+	uint64_t checksum = 0;
+
+	for ( int simIndex = startIndex; simIndex < endIndex; ++simIndex )
+	{
+		const b2BodySim* sim = sims + simIndex;
+		const b2BodyState* state = states + simIndex;
+
+		uint64_t hash = b2MixChecksum( 0, (uint32_t)sim->bodyId );
+		hash = b2MixChecksumFloat( hash, sim->transform.p.x );
+		hash = b2MixChecksumFloat( hash, sim->transform.p.y );
+		hash = b2MixChecksumFloat( hash, sim->transform.q.c );
+		hash = b2MixChecksumFloat( hash, sim->transform.q.s );
+		hash = b2MixChecksumFloat( hash, state->linearVelocity.x );
+		hash = b2MixChecksumFloat( hash, state->linearVelocity.y );
+		hash = b2MixChecksumFloat( hash, state->angularVelocity );
+		checksum += hash;
+	}
+
+	// SIMD contact slots (with NULL gaps) followed by the overflow contacts
+	b2GraphColor* overflow = stepContext->graph->colors + b2_overflowIndex;
+	int slotCount = stepContext->contactSlotCount;
+	int64_t contactCount = slotCount + overflow->contactSims.count;
+	int64_t bodyCount = b2SolverSetArray_Get( &world->solverSets, b2_awakeSet )->bodySims.count;
+	int contactStart = (int)( startIndex * contactCount / bodyCount );
+	int contactEnd = (int)( endIndex * contactCount / bodyCount );
+
+	for ( int i = contactStart; i < contactEnd; ++i )
+	{
+		const b2ContactSim* contactSim = i < slotCount ? stepContext->contacts[i] : overflow->contactSims.data + ( i - slotCount );
+		if ( contactSim == NULL )
+		{
+			continue;
+		}
+
+		const b2Manifold* manifold = &contactSim->manifold;
+		uint64_t hash = b2MixChecksum( 0, (uint32_t)contactSim->contactId );
+		for ( int j = 0; j < manifold->pointCount; ++j )
+		{
+			const b2ManifoldPoint* mp = manifold->points + j;
+			hash = b2MixChecksum( hash, mp->id );
+			hash = b2MixChecksumFloat( hash, mp->normalImpulse );
+			hash = b2MixChecksumFloat( hash, mp->tangentImpulse );
+		}
+		checksum += hash;
+	}
+
+	return checksum;
+}
+
 static void b2FinalizeBodiesTask( int startIndex, int endIndex, uint32_t threadIndex, void* context )
 {
 	b2TracyCZoneNC( finalize_bodies, "FinalizeBodies", b2_colorViolet, true );
@@ -315,12 +391,7 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, uint32_t threadI
 		else if ( island->constraintRemoveCount > 0 )
 		{
 			// body wants to sleep but its island needs splitting first
-			if ( body->sleepTime > taskContext->splitSleepTime )
-			{
-				// pick the sleepiest candidate
-				taskContext->splitIslandId = body->islandId;
-				taskContext->splitSleepTime = body->sleepTime;
-			}
+			b2AddSplitCandidate( &taskContext->splitCandidates, body->islandId, body->sleepTime );
 		}
 
 		// Update shapes AABBs
@@ -373,6 +444,11 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, uint32_t threadI
 		}
 	}
 
+	if ( world->enableChecksum )
+	{
+		taskContext->checksum += b2ComputeChecksum( startIndex, endIndex, stepContext );
+	}
+
 	b2TracyCZoneEnd( finalize_bodies );
 }
 
@@ -406,6 +482,7 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 	b2SolverBlockType blockType = block->blockType;
 	int startIndex = block->startIndex;
 	int endIndex = startIndex + block->count;
+	const b2ContactSolverSIMD* contactSolver = context->world->contactSolver;
 
 	switch ( stageType )
 	{
@@ -414,7 +491,7 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 			break;
 
 		case b2_stagePrepareContacts:
-			b2PrepareContactsTask( startIndex, endIndex, context );
+			contactSolver->prepareContacts( startIndex, endIndex, context );
 			break;
 
 		case b2_stageIntegrateVelocities:
@@ -426,7 +503,7 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 			{
 				if ( blockType == b2_graphContactBlock )
 				{
-					b2WarmStartContactsTask( startIndex, endIndex, context, stage->colorIndex );
+					contactSolver->warmStartContacts( startIndex, endIndex, context, stage->colorIndex );
 				}
 				else if ( blockType == b2_graphJointBlock )
 				{
@@ -438,7 +515,7 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 		case b2_stageSolve:
 			if ( blockType == b2_graphContactBlock )
 			{
-				b2SolveContactsTask( startIndex, endIndex, context, stage->colorIndex, true );
+				contactSolver->solveContacts( startIndex, endIndex, context, stage->colorIndex, true );
 			}
 			else if ( blockType == b2_graphJointBlock )
 			{
@@ -453,7 +530,7 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 		case b2_stageRelax:
 			if ( blockType == b2_graphContactBlock )
 			{
-				b2SolveContactsTask( startIndex, endIndex, context, stage->colorIndex, false );
+				contactSolver->solveContacts( startIndex, endIndex, context, stage->colorIndex, false );
 			}
 			else if ( blockType == b2_graphJointBlock )
 			{
@@ -464,16 +541,22 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 		case b2_stageRestitution:
 			if ( blockType == b2_graphContactBlock )
 			{
-				b2ApplyRestitutionTask( startIndex, endIndex, context, stage->colorIndex );
+				contactSolver->applyRestitution( startIndex, endIndex, context, stage->colorIndex );
 			}
 			break;
 
 		case b2_stageStoreImpulses:
-			b2StoreImpulsesTask( startIndex, endIndex, context );
+			contactSolver->storeImpulses( startIndex, endIndex, context );
 			break;
 	}
 }
 
+// Profiler zone names, indexed by b2SolverStageType
+static const char* b2_stageNames[] = {
+	"Prepare Joints", "Prepare Contacts", "Integrate Velocities", "Warm Start", "Solve",
+	"Integrate Positions", "Relax", "Restitution", "Store Impulses",
+};
+
 static inline int GetWorkerStartIndex( int workerIndex, int blockCount, int workerCount )
 {
 	if ( blockCount <= workerCount )
@@ -502,6 +585,8 @@ static void b2ExecuteStage( b2SolverStage* stage, b2StepContext* context, int pr
 
 	B2_ASSERT( 0 <= startIndex && startIndex < blockCount );
 
+	b2TraceBegin( b2_stageNames[stage->type] );
+
 	int blockIndex = startIndex;
 
 	// Caution: this can change expectedSyncIndex
@@ -546,6 +631,8 @@ static void b2ExecuteStage( b2SolverStage* stage, b2StepContext* context, int pr
 		blockIndex -= 1;
 	}
 
+	b2TraceEnd();
+
 	(void)atomic_fetch_add( &stage->completionCount, completedCount );
 }
 
@@ -559,7 +646,9 @@ static void b2ExecuteMainStage( b2SolverStage* stage, b2StepContext* context, ui
 
 	if ( blockCount == 1 )
 	{
+		b2TraceBegin( b2_stageNames[stage->type] );
 		b2ExecuteBlock( stage, context, stage->blocks );
+		b2TraceEnd();
 	}
 	else
 	{
@@ -572,10 +661,12 @@ static void b2ExecuteMainStage( b2SolverStage* stage, b2StepContext* context, ui
 		b2ExecuteStage( stage, context, previousSyncIndex, syncIndex, 0 );
 
 		// todo consider using the cycle counter as well
+		b2TracyCZoneNC( stage_wait, "Stage Wait", b2_colorGray, true );
 		while ( atomic_load( &stage->completionCount ) != blockCount )
 		{
 			b2Pause();
 		}
+		b2TracyCZoneEnd( stage_wait );
 
 		atomic_store( &stage->completionCount, 0 );
 	}
@@ -595,6 +686,8 @@ void b2SolverTask( int startIndex, int endIndex, uint32_t threadIndexDontUse, vo
 	b2SolverStage* stages = context->stages;
 	b2Profile* profile = &context->world->profile;
 
+	b2TracyCZoneNC( solver_task, "Solver Task", b2_colorSeaGreen, true );
+
 	if ( workerIndex == 0 )
 	{
 		// Main thread synchronizes the workers and does work itself.
@@ -753,6 +846,7 @@ void b2SolverTask( int startIndex, int endIndex, uint32_t threadIndexDontUse, vo
 		atomic_store( &context->atomicSyncBits, UINT_MAX );
 
 		B2_ASSERT( stageIndex + 1 == context->stageCount );
+		b2TracyCZoneEnd( solver_task );
 		return;
 	}
 
@@ -808,6 +902,8 @@ void b2SolverTask( int startIndex, int endIndex, uint32_t threadIndexDontUse, vo
 
 		lastSyncBits = syncBits;
 	}
+
+	b2TracyCZoneEnd( solver_task );
 }
 
 struct b2ContinuousContext
@@ -952,9 +1048,7 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex )
 	xf2.q = sweep.q2;
 	xf2.p = b2Sub( sweep.c2, b2RotateVector( sweep.q2, sweep.localCenter ) );
 
-	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
-	b2DynamicTree* kinematicTree = world->broadPhase.trees + b2_kinematicBody;
-	b2DynamicTree* dynamicTree = world->broadPhase.trees + b2_dynamicBody;
+	b2BroadPhase* broadPhase = &world->broadPhase;
 
 	struct b2ContinuousContext context;
 	context.world = world;
@@ -993,12 +1087,12 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex )
 			continue;
 		}
 
-		b2DynamicTree_Query( staticTree, box, b2_defaultMaskBits, b2ContinuousQueryCallback, &context );
+		b2BroadPhase_Query( broadPhase, b2_staticBody, box, b2_defaultMaskBits, b2ContinuousQueryCallback, &context );
 
 		if ( isBullet )
 		{
-			b2DynamicTree_Query( kinematicTree, box, b2_defaultMaskBits, b2ContinuousQueryCallback, &context );
-			b2DynamicTree_Query( dynamicTree, box, b2_defaultMaskBits, b2ContinuousQueryCallback, &context );
+			b2BroadPhase_Query( broadPhase, b2_kinematicBody, box, b2_defaultMaskBits, b2ContinuousQueryCallback, &context );
+			b2BroadPhase_Query( broadPhase, b2_dynamicBody, box, b2_defaultMaskBits, b2ContinuousQueryCallback, &context );
 		}
 	}
 
@@ -1121,12 +1215,6 @@ static void b2BulletBodyTask( int startIndex, int endIndex, uint32_t threadIndex
 	b2TracyCZoneEnd( bullet_body_task );
 }
 
-#if B2_SIMD_WIDTH == 8
-#define B2_SIMD_SHIFT 3
-#else
-#define B2_SIMD_SHIFT 2
-#endif
-
 // Solve with graph coloring
 void b2Solve( b2World* world, b2StepContext* stepContext )
 {
@@ -1201,7 +1289,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		// 2. keep M large enough for other workers to be able to steal work
 		// The block size is a power of two to make math efficient.
 
-		int workerCount = world->workerCount;
+		int workerCount = world->solverWorkerCount;
 		const int blocksPerWorker = 4;
 		const int maxBlockCount = blocksPerWorker * workerCount;
 
@@ -1233,6 +1321,10 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 		int graphBlockCount = 0;
 
+		// 4/8/16-way SIMD depending on the contact solver picked for this CPU
+		const b2ContactSolverSIMD* contactSolver = world->contactSolver;
+		int simdWidth = contactSolver->width;
+
 		// c is the active color index
 		int simdContactCount = 0;
 		int c = 0;
@@ -1245,8 +1337,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			{
 				activeColorIndices[c] = i;
 
-				// 4/8-way SIMD
-				int colorContactCountSIMD = colorContactCount > 0 ? ( ( colorContactCount - 1 ) >> B2_SIMD_SHIFT ) + 1 : 0;
+				int colorContactCountSIMD = colorContactCount > 0 ? ( colorContactCount - 1 ) / simdWidth + 1 : 0;
 
 				colorContactCounts[c] = colorContactCountSIMD;
 
@@ -1300,17 +1391,19 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 		// Gather contact pointers for easy parallel-for traversal. Some may be NULL due to SIMD remainders.
 		b2ContactSim** contacts = b2AllocateStackItem(
-			&world->stackAllocator, B2_SIMD_WIDTH * simdContactCount * sizeof( b2ContactSim* ), "contact pointers" );
+			&world->stackAllocator, simdWidth * simdContactCount * sizeof( b2ContactSim* ), "contact pointers" );
 
 		// Gather joint pointers for easy parallel-for traversal.
 		b2JointSim** joints =
 			b2AllocateStackItem( &world->stackAllocator, awakeJointCount * sizeof( b2JointSim* ), "joint pointers" );
 
-		int simdConstraintSize = b2GetContactConstraintSIMDByteCount();
+		int simdConstraintSize = contactSolver->constraintByteCount;
 		b2ContactConstraintSIMD* simdContactConstraints =
 			b2AllocateStackItem( &world->stackAllocator, simdContactCount * simdConstraintSize, "contact constraint" );
 
 		int overflowContactCount = colors[b2_overflowIndex].contactSims.count;
+		world->overflowContactCount = overflowContactCount;
+		world->overflowJointCount = colors[b2_overflowIndex].jointSims.count;
 		b2ContactConstraint* overflowContactConstraints = b2AllocateStackItem(
 			&world->stackAllocator, overflowContactCount * sizeof( b2ContactConstraint ), "overflow contact constraint" );
 
@@ -1338,14 +1431,14 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 					for ( int k = 0; k < colorContactCount; ++k )
 					{
-						contacts[B2_SIMD_WIDTH * contactBase + k] = color->contactSims.data + k;
+						contacts[simdWidth * contactBase + k] = color->contactSims.data + k;
 					}
 
 					// remainder
-					int colorContactCountSIMD = ( ( colorContactCount - 1 ) >> B2_SIMD_SHIFT ) + 1;
-					for ( int k = colorContactCount; k < B2_SIMD_WIDTH * colorContactCountSIMD; ++k )
+					int colorContactCountSIMD = ( colorContactCount - 1 ) / simdWidth + 1;
+					for ( int k = colorContactCount; k < simdWidth * colorContactCountSIMD; ++k )
 					{
-						contacts[B2_SIMD_WIDTH * contactBase + k] = NULL;
+						contacts[simdWidth * contactBase + k] = NULL;
 					}
 
 					contactBase += colorContactCountSIMD;
@@ -1414,16 +1507,24 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2SolverBlock* graphBlocks =
 			b2AllocateStackItem( &world->stackAllocator, graphBlockCount * sizeof( b2SolverBlock ), "graph blocks" );
 
-		// Split an awake island. This modifies:
-		// - stack allocator
+		// Split the awake island candidates. This modifies:
+		// - worker arenas
 		// - world island array and solver set
 		// - island indices on bodies, contacts, and joints
-		// I'm squeezing this task in here because it may be expensive and this is a safe place to put it.
+		// I'm squeezing these tasks in here because they may be expensive and this is a safe place to put them.
 		// Note: cannot split islands in parallel with FinalizeBodies
+		// Split time runs from this enqueue to the finish of the link task, the split overlaps the stage preparation
+		b2Timer splitTimer = b2CreateTimer();
+		int splitCount = world->splitCandidates.count;
 		void* splitIslandTask = NULL;
-		if ( world->splitIslandId != B2_NULL_INDEX )
+		if ( splitCount > 0 )
 		{
-			splitIslandTask = world->enqueueTaskFcn( &b2SplitIslandTask, 1, 1, world, world->userTaskContext );
+			for ( int i = 0; i < splitCount; ++i )
+			{
+				world->islandSplits[i].baseId = world->splitCandidates.islandIds[i];
+			}
+
+			splitIslandTask = world->enqueueTaskFcn( &b2SplitIslandTask, splitCount, 1, world, world->userTaskContext );
 			world->taskCount += 1;
 			world->activeTaskCount += splitIslandTask == NULL ? 0 : 1;
 		}
@@ -1613,6 +1714,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		stepContext->graph = graph;
 		stepContext->joints = joints;
 		stepContext->contacts = contacts;
+		stepContext->contactSlotCount = simdWidth * simdContactCount;
 		stepContext->simdContactConstraints = simdContactConstraints;
 		stepContext->activeColorCount = activeColorCount;
 		stepContext->workerCount = workerCount;
@@ -1640,7 +1742,21 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			world->finishTaskFcn( splitIslandTask, world->userTaskContext );
 			world->activeTaskCount -= 1;
 		}
-		world->splitIslandId = B2_NULL_INDEX;
+
+		if ( splitCount > 0 )
+		{
+			b2CreateSplitIslands( world );
+
+			void* linkIslandsTask = world->enqueueTaskFcn( &b2LinkSplitIslandsTask, splitCount, 1, world, world->userTaskContext );
+			world->taskCount += 1;
+			if ( linkIslandsTask != NULL )
+			{
+				world->finishTaskFcn( linkIslandsTask, world->userTaskContext );
+			}
+
+			world->profile.splitIslands = b2GetMilliseconds( &splitTimer );
+		}
+		world->splitCandidates.count = 0;
 
 		// Finish constraint solve
 		for ( int i = 0; i < workerCount; ++i )
@@ -1661,8 +1777,8 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			b2TaskContext* taskContext = world->taskContexts.data + i;
 			b2SetBitCountAndClear( &taskContext->enlargedSimBitSet, awakeBodyCount );
 			b2SetBitCountAndClear( &taskContext->awakeIslandBitSet, awakeIslandCount );
-			taskContext->splitIslandId = B2_NULL_INDEX;
-			taskContext->splitSleepTime = 0.0f;
+			taskContext->splitCandidates.count = 0;
+			taskContext->checksum = 0;
 		}
 
 		// Finalize bodies. Must happen after the constraint solver and after island splitting.
@@ -1674,6 +1790,16 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			world->finishTaskFcn( finalizeBodiesTask, world->userTaskContext );
 		}
 
+		if ( world->enableChecksum )
+		{
+			uint64_t checksum = 0;
+			for ( int i = 0; i < world->workerCount; ++i )
+			{
+				checksum += world->taskContexts.data[i].checksum;
+			}
+			world->checksum = checksum;
+		}
+
 		world->profile.finalizeBodies = b2GetMillisecondsAndReset( &timer );
 
 		b2FreeStackItem( &world->stackAllocator, graphBlocks );
@@ -1851,7 +1977,6 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 	// Doing this here so that bullet shapes see them
 	{
 		b2BroadPhase* broadPhase = &world->broadPhase;
-		b2DynamicTree* dynamicTree = broadPhase->trees + b2_dynamicBody;
 
 		// Fast array access is important here
 		b2Body* bodyArray = world->bodies.data;
@@ -1891,14 +2016,8 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 				// clear flag
 				shape->enlargedAABB = false;
 
-				int proxyKey = shape->proxyKey;
-				int proxyId = B2_PROXY_ID( proxyKey );
-				B2_ASSERT( B2_PROXY_TYPE( proxyKey ) == b2_dynamicBody );
-
 				// all fast shapes should already be in the move buffer
-				B2_ASSERT( b2ContainsKey( &broadPhase->moveSet, proxyKey + 1 ) );
-
-				b2DynamicTree_EnlargeProxy( dynamicTree, proxyId, shape->fatAABB );
+				b2BroadPhase_EnlargeMovedProxy( broadPhase, shape->proxyKey, shape->fatAABB );
 
 				shapeId = shape->nextShapeId;
 			}
@@ -1907,6 +2026,9 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 	if ( stepContext->bulletBodyCount > 0 )
 	{
+		// Fast bodies were enlarged in no particular order, bullets must see the same grid every time
+		b2BroadPhase_RebuildGrid( &world->broadPhase );
+
 		// bullet bodies
 		int minRange = 8;
 		void* userBulletBodyTask = world->enqueueTaskFcn( &b2BulletBodyTask, stepContext->bulletBodyCount, minRange, stepContext,
@@ -1921,7 +2043,6 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 	// Serially enlarge broad-phase proxies for bullet shapes
 	{
 		b2BroadPhase* broadPhase = &world->broadPhase;
-		b2DynamicTree* dynamicTree = broadPhase->trees + b2_dynamicBody;
 
 		// Fast array access is important here
 		b2Body* bodyArray = world->bodies.data;
@@ -1961,20 +2082,17 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 				// clear flag
 				shape->enlargedAABB = false;
 
-				int proxyKey = shape->proxyKey;
-				int proxyId = B2_PROXY_ID( proxyKey );
-				B2_ASSERT( B2_PROXY_TYPE( proxyKey ) == b2_dynamicBody );
-
 				// all fast shapes should already be in the move buffer
-				B2_ASSERT( b2ContainsKey( &broadPhase->moveSet, proxyKey + 1 ) );
-
-				b2DynamicTree_EnlargeProxy( dynamicTree, proxyId, shape->fatAABB );
+				b2BroadPhase_EnlargeMovedProxy( broadPhase, shape->proxyKey, shape->fatAABB );
 
 				shapeId = shape->nextShapeId;
 			}
 		}
 	}
 
+	// Leave the grid the same for queries between steps, whatever the order of the fast and bullet bodies
+	b2BroadPhase_RebuildGrid( &world->broadPhase );
+
 	b2TracyCZoneEnd( continuous_collision );
 
 	b2FreeStackItem( &world->stackAllocator, stepContext->bulletBodies );
@@ -1993,24 +2111,16 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 	{
 		b2TracyCZoneNC( sleep_islands, "Island Sleep", b2_colorGainsboro, true );
 
-		// Collect split island candidate for the next time step. No need to split if sleeping is disabled.
-		B2_ASSERT( world->splitIslandId == B2_NULL_INDEX );
-		float splitSleepTimer = 0.0f;
+		// Collect split island candidates for the next time step. No need to split if sleeping is disabled.
+		// Each worker keeps its sleepiest islands, so the sleepiest islands overall are among them.
+		B2_ASSERT( world->splitCandidates.count == 0 );
 		for ( int i = 0; i < world->workerCount; ++i )
 		{
-			b2TaskContext* taskContext = world->taskContexts.data + i;
-			if ( taskContext->splitIslandId != B2_NULL_INDEX && taskContext->splitSleepTime >= splitSleepTimer )
+			b2SplitCandidates* candidates = &world->taskContexts.data[i].splitCandidates;
+			for ( int j = 0; j < candidates->count; ++j )
 			{
-				B2_ASSERT( taskContext->splitSleepTime > 0.0f );
-
-				// Tie breaking for determinism. Largest island id wins. Needed due to work stealing.
-				if ( taskContext->splitSleepTime == splitSleepTimer && taskContext->splitIslandId < world->splitIslandId )
-				{
-					continue;
-				}
-
-				world->splitIslandId = taskContext->splitIslandId;
-				splitSleepTimer = taskContext->splitSleepTime;
+				B2_ASSERT( candidates->sleepTimes[j] > 0.0f );
+				b2AddSplitCandidate( &world->splitCandidates, candidates->islandIds[j], candidates->sleepTimes[j] );
 			}
 		}
 
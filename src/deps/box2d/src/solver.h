@@ -121,6 +121,7 @@ typedef struct b2StepContext
 	// despite being an array of pointers, these are contiguous sub-arrays corresponding
 	// to constraint graph colors
 	b2ContactSim** contacts;
+	int contactSlotCount;
 
 	struct b2ContactConstraintSIMD* simdContactConstraints;
 	int activeColorCount;
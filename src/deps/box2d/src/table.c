@@ -95,7 +95,7 @@ static void b2AddKeyHaveCapacity( b2HashSet* set, uint64_t key, uint32_t hash )
 	set->count += 1;
 }
 
-static void b2GrowTable( b2HashSet* set )
+static void b2GrowTable( b2HashSet* set, uint32_t capacity )
 {
 	uint32_t oldCount = set->count;
 	B2_MAYBE_UNUSED( oldCount );
@@ -105,7 +105,8 @@ static void b2GrowTable( b2HashSet* set )
 
 	set->count = 0;
 	// Capacity must be a power of 2
-	set->capacity = 2 * oldCapacity;
+	B2_ASSERT( capacity > oldCapacity && ( capacity & ( capacity - 1 ) ) == 0 );
+	set->capacity = capacity;
 	set->items = b2Alloc( set->capacity * sizeof( b2SetItem ) );
 	memset( set->items, 0, set->capacity * sizeof( b2SetItem ) );
 
@@ -159,13 +160,58 @@ bool b2AddKey( b2HashSet* set, uint64_t key )
 
 	if ( 2 * set->count >= set->capacity )
 	{
-		b2GrowTable( set );
+		b2GrowTable( set, 2 * set->capacity );
 	}
 
 	b2AddKeyHaveCapacity( set, key, hash );
 	return false;
 }
 
+void b2ReserveSet( b2HashSet* set, int32_t count )
+{
+	// Same load factor as b2AddKey
+	uint32_t capacity = set->capacity;
+	while ( 2 * (uint32_t)count >= capacity )
+	{
+		capacity *= 2;
+	}
+
+	if ( capacity > set->capacity )
+	{
+		b2GrowTable( set, capacity );
+	}
+}
+
+void b2AddNewKeyConcurrent( b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint32_t hash = b2KeyHash( key );
+	B2_ASSERT( hash != 0 );
+
+	// Claim the first empty slot by swapping in the key. The hash is only read once all threads
+	// are done, so it doesn't need to be atomic. Slots never become empty during the insertion,
+	// so the result is a valid linear probing table regardless of which thread wins each slot.
+	uint32_t capacity = set->capacity;
+	uint32_t index = hash & ( capacity - 1 );
+	b2SetItem* items = set->items;
+	for ( ;; )
+	{
+		_Atomic uint64_t* slotKey = (_Atomic uint64_t*)&items[index].key;
+		uint64_t expected = 0;
+		if ( atomic_load_explicit( slotKey, memory_order_relaxed ) == 0 &&
+			 atomic_compare_exchange_strong( slotKey, &expected, key ) )
+		{
+			items[index].hash = hash;
+			return;
+		}
+
+		B2_ASSERT( atomic_load_explicit( slotKey, memory_order_relaxed ) != key );
+		index = ( index + 1 ) & ( capacity - 1 );
+	}
+}
+
 // See https://en.wikipedia.org/wiki/Open_addressing
 bool b2RemoveKey( b2HashSet* set, uint64_t key )
 {
@@ -29,6 +29,14 @@ void b2ClearSet( b2HashSet* set );
 // Returns true if key was already in set
 bool b2AddKey( b2HashSet* set, uint64_t key );
 
+// Grow the set so that count keys fit without growing again
+void b2ReserveSet( b2HashSet* set, int32_t count );
+
+// Add a key that is not in the set. Multiple threads may add keys concurrently as long as
+// the set has been reserved and nothing else touches the set in the meantime. The set count
+// is not updated, the caller must add the number of new keys once all threads are done.
+void b2AddNewKeyConcurrent( b2HashSet* set, uint64_t key );
+
 // Returns true if the key was found
 bool b2RemoveKey( b2HashSet* set, uint64_t key );
 
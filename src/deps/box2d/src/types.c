@@ -23,6 +23,9 @@ b2WorldDef b2DefaultWorldDef( void )
 	def.restitutionMixingRule = b2_mixMaximum;
 	def.enableSleep = true;
 	def.enableContinuous = true;
+	def.enableWideTrees = true;
+	def.broadPhaseType = b2_broadPhaseTree;
+	def.gridCellSize = 2.0f * b2_lengthUnitsPerMeter;
 	def.internalValue = B2_SECRET_COOKIE;
 	return def;
 }
@@ -13,6 +13,12 @@
 
 #include <stdio.h>
 
+b2Vec2 b2WheelJoint_GetLocalAxisA( b2JointId jointId )
+{
+	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	return joint->wheelJoint.localAxisA;
+}
+
 void b2WheelJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
 	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
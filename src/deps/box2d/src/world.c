@@ -14,6 +14,7 @@
 #include "broad_phase.h"
 #include "constraint_graph.h"
 #include "contact.h"
+#include "contact_solver.h"
 #include "core.h"
 #include "ctz.h"
 #include "island.h"
@@ -117,7 +118,7 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->inUse = true;
 
 	world->stackAllocator = b2CreateStackAllocator( 2048 );
-	b2CreateBroadPhase( &world->broadPhase );
+	b2CreateBroadPhase( &world->broadPhase, def );
 	b2CreateGraph( &world->constraintGraph, 16 );
 
 	// pools
@@ -167,9 +168,11 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->contactHitEvents = b2ContactHitEventArray_Create( 4 );
 
 	world->stepIndex = 0;
-	world->splitIslandId = B2_NULL_INDEX;
+	world->splitCandidates.count = 0;
 	world->activeTaskCount = 0;
 	world->taskCount = 0;
+	world->overflowContactCount = 0;
+	world->overflowJointCount = 0;
 	world->gravity = def->gravity;
 	world->hitEventThreshold = def->hitEventThreshold;
 	world->restitutionThreshold = def->restitutionThreshold;
@@ -185,6 +188,8 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->locked = false;
 	world->enableWarmStarting = true;
 	world->enableContinuous = def->enableContinuous;
+	world->enableChecksum = def->enableChecksum;
+	world->contactSolver = b2GetContactSolverSIMD( def->simdType );
 	world->userTreeTask = NULL;
 
 	if ( def->workerCount > 0 && def->enqueueTask != NULL && def->finishTask != NULL )
@@ -202,6 +207,13 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 		world->userTaskContext = NULL;
 	}
 
+	world->solverWorkerCount = world->workerCount;
+	if ( def->solverWorkerCount > 0 )
+	{
+		world->solverWorkerCount = b2MinInt( def->solverWorkerCount, world->workerCount );
+	}
+
+	world->stateCopies = b2StateCopyArray_Create( 0 );
 	world->taskContexts = b2TaskContextArray_Create( world->workerCount );
 	b2TaskContextArray_Resize( &world->taskContexts, world->workerCount );
 
@@ -210,6 +222,7 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 		world->taskContexts.data[i].contactStateBitSet = b2CreateBitSet( 1024 );
 		world->taskContexts.data[i].enlargedSimBitSet = b2CreateBitSet( 256 );
 		world->taskContexts.data[i].awakeIslandBitSet = b2CreateBitSet( 256 );
+		world->taskContexts.data[i].arena = b2CreateArenaAllocator( 1024 );
 	}
 
 	world->debugBodySet = b2CreateBitSet( 256 );
@@ -233,9 +246,11 @@ void b2DestroyWorld( b2WorldId worldId )
 		b2DestroyBitSet( &world->taskContexts.data[i].contactStateBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].enlargedSimBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].awakeIslandBitSet );
+		b2DestroyArenaAllocator( &world->taskContexts.data[i].arena );
 	}
 
 	b2TaskContextArray_Destroy( &world->taskContexts );
+	b2StateCopyArray_Destroy( &world->stateCopies );
 
 	b2BodyMoveEventArray_Destroy( &world->bodyMoveEvents );
 	b2SensorBeginTouchEventArray_Destroy( &world->sensorBeginEvents );
@@ -384,7 +399,7 @@ static void b2UpdateTreesTask( int startIndex, int endIndex, uint32_t threadInde
 	b2TracyCZoneNC( tree_task, "Rebuild Trees", b2_colorSnow, true );
 
 	b2World* world = context;
-	b2BroadPhase_RebuildTrees( &world->broadPhase );
+	b2BroadPhase_RebuildTrees( &world->broadPhase, world );
 
 	b2TracyCZoneEnd( tree_task );
 }
@@ -695,6 +710,7 @@ void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
 	b2ContactHitEventArray_Clear( &world->contactHitEvents );
 
 	world->profile = ( b2Profile ){ 0 };
+	world->checksum = 0;
 
 	if ( timeStep == 0.0f )
 	{
@@ -708,6 +724,12 @@ void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
 	world->activeTaskCount = 0;
 	world->taskCount = 0;
 
+	// Release the scratch memory of the previous step and grow the arenas that overflowed
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2ResetArena( &world->taskContexts.data[i].arena );
+	}
+
 	b2Timer stepTimer = b2CreateTimer();
 
 	// Update collision pairs and create contacts
@@ -937,9 +959,12 @@ static void b2DrawWithBounds( b2World* world, b2DebugDraw* draw )
 	b2HexColor impulseColor = b2_colorMagenta;
 	b2HexColor frictionColor = b2_colorYellow;
 
-	b2HexColor graphColors[b2_graphColorCount] = { b2_colorRed,		  b2_colorOrange,	 b2_colorYellow, b2_colorGreen,
-												   b2_colorCyan,	  b2_colorBlue,		 b2_colorViolet, b2_colorPink,
-												   b2_colorChocolate, b2_colorGoldenrod, b2_colorCoral,	 b2_colorBlack };
+	b2HexColor graphColors[b2_graphColorCount] = { b2_colorRed,		  b2_colorOrange,	 b2_colorYellow,  b2_colorGreen,
+												   b2_colorCyan,	  b2_colorBlue,		 b2_colorViolet,  b2_colorPink,
+												   b2_colorChocolate, b2_colorGoldenrod, b2_colorCoral,	  b2_colorCrimson,
+												   b2_colorGold,	  b2_colorIndigo,	 b2_colorKhaki,	  b2_colorMaroon,
+												   b2_colorOlive,	  b2_colorOrchid,	 b2_colorPlum,	  b2_colorSeaGreen,
+												   b2_colorSkyBlue,	  b2_colorTeal,		 b2_colorTomato,  b2_colorBlack };
 
 	int bodyCapacity = b2GetIdCapacity( &world->bodyIdPool );
 	b2SetBitCountAndClear( &world->debugBodySet, bodyCapacity );
@@ -954,8 +979,8 @@ static void b2DrawWithBounds( b2World* world, b2DebugDraw* draw )
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_Query( world->broadPhase.trees + i, draw->drawingBounds, b2_defaultMaskBits, DrawQueryCallback,
-							 &drawContext );
+		b2BroadPhase_Query( &world->broadPhase, i, draw->drawingBounds, b2_defaultMaskBits, DrawQueryCallback,
+							&drawContext );
 	}
 
 	uint32_t wordCount = world->debugBodySet.blockCount;
@@ -1288,9 +1313,12 @@ void b2World_Draw( b2WorldId worldId, b2DebugDraw* draw )
 		b2HexColor impulseColor = b2_colorMagenta;
 		b2HexColor frictionColor = b2_colorYellow;
 
-		b2HexColor colors[b2_graphColorCount] = { b2_colorRed,		 b2_colorOrange,	b2_colorYellow, b2_colorGreen,
-												  b2_colorCyan,		 b2_colorBlue,		b2_colorViolet, b2_colorPink,
-												  b2_colorChocolate, b2_colorGoldenrod, b2_colorCoral,	b2_colorBlack };
+		b2HexColor colors[b2_graphColorCount] = { b2_colorRed,		 b2_colorOrange,	b2_colorYellow,	 b2_colorGreen,
+												  b2_colorCyan,		 b2_colorBlue,		b2_colorViolet,	 b2_colorPink,
+												  b2_colorChocolate, b2_colorGoldenrod, b2_colorCoral,	 b2_colorCrimson,
+												  b2_colorGold,		 b2_colorIndigo,	b2_colorKhaki,	 b2_colorMaroon,
+												  b2_colorOlive,	 b2_colorOrchid,	b2_colorPlum,	 b2_colorSeaGreen,
+												  b2_colorSkyBlue,	 b2_colorTeal,		b2_colorTomato,	 b2_colorBlack };
 
 		for ( int colorIndex = 0; colorIndex < b2_graphColorCount; ++colorIndex )
 		{
@@ -1636,6 +1664,18 @@ bool b2World_IsContinuousEnabled( b2WorldId worldId )
 	return world->enableContinuous;
 }
 
+void b2World_EnableChecksum( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableChecksum = flag;
+}
+
 void b2World_SetRestitutionThreshold( b2WorldId worldId, float value )
 {
 	b2World* world = b2GetWorldFromId( worldId );
@@ -1725,6 +1765,18 @@ b2Profile b2World_GetProfile( b2WorldId worldId )
 	return world->profile;
 }
 
+uint64_t b2World_GetChecksum( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->checksum;
+}
+
+b2SIMDType b2World_GetSIMDType( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->contactSolver->type;
+}
+
 b2Counters b2World_GetCounters( b2WorldId worldId )
 {
 	b2World* world = b2GetWorldFromId( worldId );
@@ -1743,6 +1795,14 @@ b2Counters b2World_GetCounters( b2WorldId worldId )
 	s.treeHeight = b2MaxInt( b2DynamicTree_GetHeight( dynamicTree ), b2DynamicTree_GetHeight( kinematicTree ) );
 
 	s.stackUsed = b2GetMaxStackAllocation( &world->stackAllocator );
+
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2ArenaAllocator* arena = &world->taskContexts.data[i].arena;
+		s.arenaUsed += b2GetArenaAllocation( arena );
+		s.arenaCapacity += b2GetArenaCapacity( arena );
+	}
+
 	s.byteCount = b2GetByteCount();
 	s.taskCount = world->taskCount;
 
@@ -1750,6 +1810,9 @@ b2Counters b2World_GetCounters( b2WorldId worldId )
 	{
 		s.colorCounts[i] = world->constraintGraph.colors[i].contactSims.count + world->constraintGraph.colors[i].jointSims.count;
 	}
+
+	s.overflowContactCount = world->overflowContactCount;
+	s.overflowJointCount = world->overflowJointCount;
 	return s;
 }
 
@@ -1789,7 +1852,7 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 	fprintf( file, "broad-phase\n" );
 	fprintf( file, "static tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_staticBody ) );
 	fprintf( file, "kinematic tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_kinematicBody ) );
-	fprintf( file, "dynamic tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_dynamicBody ) );
+	fprintf( file, "dynamic tree: %d\n", b2BroadPhase_GetByteCount( &world->broadPhase, b2_dynamicBody ) );
 	b2HashSet* moveSet = &world->broadPhase.moveSet;
 	fprintf( file, "moveSet: %d (%d, %d)\n", b2GetHashSetBytes( moveSet ), moveSet->count, moveSet->capacity );
 	fprintf( file, "moveArray: %d\n", b2IntArray_ByteCount( &world->broadPhase.moveArray ) );
@@ -1899,7 +1962,7 @@ void b2World_OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryFilter filter,
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeQueryCallback, &worldContext );
+		b2BroadPhase_Query( &world->broadPhase, i, aabb, filter.maskBits, TreeQueryCallback, &worldContext );
 	}
 }
 
@@ -1973,7 +2036,7 @@ void b2World_OverlapCircle( b2WorldId worldId, const b2Circle* circle, b2Transfo
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
+		b2BroadPhase_Query( &world->broadPhase, i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
 	}
 }
 
@@ -1997,7 +2060,7 @@ void b2World_OverlapCapsule( b2WorldId worldId, const b2Capsule* capsule, b2Tran
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
+		b2BroadPhase_Query( &world->broadPhase, i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
 	}
 }
 
@@ -2021,7 +2084,7 @@ void b2World_OverlapPolygon( b2WorldId worldId, const b2Polygon* polygon, b2Tran
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
+		b2BroadPhase_Query( &world->broadPhase, i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
 	}
 }
 
@@ -2084,7 +2147,7 @@ void b2World_CastRay( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2Qu
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_RayCast( world->broadPhase.trees + i, &input, filter.maskBits, RayCastCallback, &worldContext );
+		b2BroadPhase_RayCast( &world->broadPhase, i, &input, filter.maskBits, RayCastCallback, &worldContext );
 
 		if ( worldContext.fraction == 0.0f )
 		{
@@ -2126,7 +2189,7 @@ b2RayResult b2World_CastRayClosest( b2WorldId worldId, b2Vec2 origin, b2Vec2 tra
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_RayCast( world->broadPhase.trees + i, &input, filter.maskBits, RayCastCallback, &worldContext );
+		b2BroadPhase_RayCast( &world->broadPhase, i, &input, filter.maskBits, RayCastCallback, &worldContext );
 
 		if ( worldContext.fraction == 0.0f )
 		{
@@ -2195,7 +2258,7 @@ void b2World_CastCircle( b2WorldId worldId, const b2Circle* circle, b2Transform
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
+		b2BroadPhase_ShapeCast( &world->broadPhase, i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
 
 		if ( worldContext.fraction == 0.0f )
 		{
@@ -2232,7 +2295,7 @@ void b2World_CastCapsule( b2WorldId worldId, const b2Capsule* capsule, b2Transfo
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
+		b2BroadPhase_ShapeCast( &world->broadPhase, i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
 
 		if ( worldContext.fraction == 0.0f )
 		{
@@ -2271,7 +2334,7 @@ void b2World_CastPolygon( b2WorldId worldId, const b2Polygon* polygon, b2Transfo
 
 	for ( int i = 0; i < b2_bodyTypeCount; ++i )
 	{
-		b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
+		b2BroadPhase_ShapeCast( &world->broadPhase, i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
 
 		if ( worldContext.fraction == 0.0f )
 		{
@@ -2512,8 +2575,7 @@ void b2World_Explode( b2WorldId worldId, const b2ExplosionDef* explosionDef )
 	aabb.upperBound.x = position.x + (radius + falloff);
 	aabb.upperBound.y = position.y + (radius + falloff);
 
-	b2DynamicTree_Query( world->broadPhase.trees + b2_dynamicBody, aabb, maskBits, ExplosionCallback,
-						 &explosionContext );
+	b2BroadPhase_Query( &world->broadPhase, b2_dynamicBody, aabb, maskBits, ExplosionCallback, &explosionContext );
 }
 
 #if B2_VALIDATE
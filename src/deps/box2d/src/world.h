@@ -3,11 +3,13 @@
 
 #pragma once
 
+#include "arena_allocator.h"
 #include "array.h"
 #include "bitset.h"
 #include "broad_phase.h"
 #include "constraint_graph.h"
 #include "id_pool.h"
+#include "island.h"
 #include "stack_allocator.h"
 
 #include "box2d/types.h"
@@ -35,12 +37,28 @@ typedef struct b2TaskContext
 	// Used to put islands to sleep
 	b2BitSet awakeIslandBitSet;
 
-	// Per worker split island candidate
-	float splitSleepTime;
-	int splitIslandId;
+	// Per worker split island candidates
+	b2SplitCandidates splitCandidates;
+
+	// Per worker sum of the step checksum, see b2World_GetChecksum
+	uint64_t checksum;
+
+	// Scratch memory for tasks running on this worker, reset at the start of each step
+	b2ArenaAllocator arena;
 
 } b2TaskContext;
 
+// A memory copy of b2World_SaveState/b2World_RestoreState that is large enough to run in parallel
+typedef struct b2StateCopy
+{
+	void* destination;
+	const void* source;
+	int size;
+
+	// sum of the sizes of the previous copies
+	int offset;
+} b2StateCopy;
+
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
 /// management facilities.
@@ -98,6 +116,9 @@ typedef struct b2World
 	// Per thread storage
 	b2TaskContextArray taskContexts;
 
+	// Deferred copies of the last save or restore, kept to avoid allocating
+	b2StateCopyArray stateCopies;
+
 	b2BodyMoveEventArray bodyMoveEvents;
 	b2SensorBeginTouchEventArray sensorBeginEvents;
 	b2SensorEndTouchEventArray sensorEndEvents;
@@ -120,7 +141,9 @@ typedef struct b2World
 	// - islands that have removed constraints must be put split first because I don't want to wake bodies incorrectly
 	// - otherwise I can use the awake islands that have bodies wanting to sleep as the splitting candidates
 	// - if no bodies want to sleep then there is no reason to perform island splitting
-	int splitIslandId;
+	// The sleepiest candidates are split in parallel during the next step.
+	b2SplitCandidates splitCandidates;
+	b2IslandSplit islandSplits[b2_maxSplitIslands];
 
 	b2Vec2 gravity;
 	float hitEventThreshold;
@@ -138,6 +161,7 @@ typedef struct b2World
 	uint16_t revision;
 
 	b2Profile profile;
+	uint64_t checksum;
 
 	b2PreSolveFcn* preSolveFcn;
 	void* preSolveContext;
@@ -145,7 +169,13 @@ typedef struct b2World
 	b2CustomFilterFcn* customFilterFcn;
 	void* customFilterContext;
 
+	// Contact solver for the instruction set selected at creation
+	const struct b2ContactSolverSIMD* contactSolver;
+
 	int workerCount;
+
+	// Workers used by the constraint solver stages, at most workerCount
+	int solverWorkerCount;
 	b2EnqueueTaskCallback* enqueueTaskFcn;
 	b2FinishTaskCallback* finishTaskFcn;
 	void* userTaskContext;
@@ -157,12 +187,17 @@ typedef struct b2World
 	int activeTaskCount;
 	int taskCount;
 
+	// Constraints solved single-threaded in the last step, see b2_overflowIndex
+	int overflowContactCount;
+	int overflowJointCount;
+
 	uint16_t worldId;
 
 	bool enableSleep;
 	bool locked;
 	bool enableWarmStarting;
 	bool enableContinuous;
+	bool enableChecksum;
 	bool inUse;
 } b2World;
 
@@ -181,3 +216,4 @@ B2_ARRAY_INLINE( b2ContactHitEvent, b2ContactHitEvent );
 B2_ARRAY_INLINE( b2SensorBeginTouchEvent, b2SensorBeginTouchEvent );
 B2_ARRAY_INLINE( b2SensorEndTouchEvent, b2SensorEndTouchEvent );
 B2_ARRAY_INLINE( b2TaskContext, b2TaskContext );
+B2_ARRAY_INLINE( b2StateCopy, b2StateCopy );
@@ -0,0 +1,691 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// World save/restore for rollback. The state is every persistent array of the world copied back to back. Restoring
+// copies into the existing allocations and only grows them when the saved state is larger, so rolling back and
+// re-simulating a few steps does not allocate in the steady state. Transient step data (stack allocator, task
+// contexts, debug draw sets) is not part of the state.
+//
+// Both directions are bound by memory bandwidth. Small copies are done while walking the world, large ones are
+// recorded and then split into blocks that run on the task system.
+
+#include "world.h"
+
+#include "array.h"
+#include "bitset.h"
+#include "body.h"
+#include "broad_phase.h"
+#include "constraint_graph.h"
+#include "contact.h"
+#include "core.h"
+#include "id_pool.h"
+#include "island.h"
+#include "joint.h"
+#include "shape.h"
+#include "solver_set.h"
+#include "table.h"
+
+#include "box2d/box2d.h"
+
+#include <string.h>
+
+#define B2_STATE_MAGIC 0x54533242 // "B2ST"
+
+// Copies smaller than this are done inline
+#define B2_STATE_DEFER_SIZE ( 16 * 1024 )
+
+// Bytes per parallel-for item
+#define B2_STATE_BLOCK_SIZE ( 64 * 1024 )
+
+B2_ARRAY_SOURCE( b2StateCopy, b2StateCopy );
+
+// Layout check, a state can only be restored by the build that saved it
+typedef struct b2StateHeader
+{
+	uint32_t magic;
+	uint16_t worldId;
+	uint16_t worldRevision;
+	int byteCount;
+	uint16_t bodySize;
+	uint16_t shapeSize;
+	uint16_t contactSimSize;
+	uint16_t jointSimSize;
+} b2StateHeader;
+
+typedef struct b2StateWriter
+{
+	b2StateCopyArray* copies;
+	uint8_t* data;
+	int capacity;
+	int size;
+} b2StateWriter;
+
+typedef struct b2StateReader
+{
+	b2StateCopyArray* copies;
+	const uint8_t* data;
+	int size;
+	int offset;
+} b2StateReader;
+
+static void b2CopyOrDefer( b2StateCopyArray* copies, void* dst, const void* src, int byteCount )
+{
+	if ( byteCount < B2_STATE_DEFER_SIZE )
+	{
+		memcpy( dst, src, byteCount );
+		return;
+	}
+
+	int offset = 0;
+	if ( copies->count > 0 )
+	{
+		b2StateCopy* last = copies->data + copies->count - 1;
+		offset = last->offset + last->size;
+	}
+	b2StateCopyArray_Push( copies, ( b2StateCopy ){ dst, src, byteCount, offset } );
+}
+
+static void b2StateCopyTask( int startIndex, int endIndex, uint32_t workerIndex, void* context )
+{
+	B2_MAYBE_UNUSED( workerIndex );
+	b2TracyCZoneNC( state_copy, "State Copy", b2_colorKhaki, true );
+
+	b2StateCopyArray* copies = context;
+	b2StateCopy* last = copies->data + copies->count - 1;
+	int totalSize = last->offset + last->size;
+	int begin = startIndex * B2_STATE_BLOCK_SIZE;
+	int end = b2MinInt( endIndex * B2_STATE_BLOCK_SIZE, totalSize );
+
+	// first copy overlapping the range
+	int lower = 0, upper = copies->count - 1;
+	while ( lower < upper )
+	{
+		int mid = ( lower + upper + 1 ) / 2;
+		if ( copies->data[mid].offset <= begin )
+		{
+			lower = mid;
+		}
+		else
+		{
+			upper = mid - 1;
+		}
+	}
+
+	for ( int i = lower; i < copies->count && copies->data[i].offset < end; ++i )
+	{
+		b2StateCopy* copy = copies->data + i;
+		int copyBegin = b2MaxInt( begin, copy->offset );
+		int copyEnd = b2MinInt( end, copy->offset + copy->size );
+		int local = copyBegin - copy->offset;
+		memcpy( (uint8_t*)copy->destination + local, (const uint8_t*)copy->source + local, copyEnd - copyBegin );
+	}
+
+	b2TracyCZoneEnd( state_copy );
+}
+
+static void b2RunStateCopies( b2World* world )
+{
+	b2StateCopyArray* copies = &world->stateCopies;
+	if ( copies->count == 0 )
+	{
+		return;
+	}
+
+	b2StateCopy* last = copies->data + copies->count - 1;
+	int blockCount = ( last->offset + last->size + B2_STATE_BLOCK_SIZE - 1 ) / B2_STATE_BLOCK_SIZE;
+
+	void* task = world->enqueueTaskFcn( b2StateCopyTask, blockCount, 1, copies, world->userTaskContext );
+	world->taskCount += 1;
+	if ( task != NULL )
+	{
+		world->finishTaskFcn( task, world->userTaskContext );
+	}
+
+	b2StateCopyArray_Clear( copies );
+}
+
+// Counts bytes only when the writer has no buffer or the buffer is full
+static void b2WriteBytes( b2StateWriter* writer, const void* src, int byteCount )
+{
+	if ( writer->data != NULL && writer->size + byteCount <= writer->capacity && byteCount > 0 )
+	{
+		b2CopyOrDefer( writer->copies, writer->data + writer->size, src, byteCount );
+	}
+	writer->size += byteCount;
+}
+
+static const void* b2ReadBytes( b2StateReader* reader, int byteCount )
+{
+	B2_ASSERT( reader->offset + byteCount <= reader->size );
+	const void* src = reader->data + reader->offset;
+	reader->offset += byteCount;
+	return src;
+}
+
+static void b2ReadInto( b2StateReader* reader, void* dst, int byteCount )
+{
+	if ( byteCount > 0 )
+	{
+		b2CopyOrDefer( reader->copies, dst, b2ReadBytes( reader, byteCount ), byteCount );
+	}
+}
+
+#define B2_WRITE_VALUE( writer, value ) b2WriteBytes( writer, &( value ), (int)sizeof( value ) )
+#define B2_READ_VALUE( reader, value ) b2ReadInto( reader, &( value ), (int)sizeof( value ) )
+
+// Count followed by the elements
+#define B2_WRITE_ARRAY( writer, array )                                                                                          \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		B2_WRITE_VALUE( writer, ( array ).count );                                                                               \
+		b2WriteBytes( writer, ( array ).data, ( array ).count * (int)sizeof( *( array ).data ) );                                \
+	}                                                                                                                            \
+	while ( 0 )
+
+// Grows the array only when the saved count exceeds its capacity
+#define B2_READ_ARRAY( reader, PREFIX, array )                                                                                   \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		int count_;                                                                                                              \
+		B2_READ_VALUE( reader, count_ );                                                                                         \
+		if ( count_ > ( array ).capacity )                                                                                       \
+		{                                                                                                                        \
+			( array ).count = 0;                                                                                                 \
+			PREFIX##Array_Reserve( &( array ), count_ );                                                                         \
+		}                                                                                                                        \
+		b2ReadInto( reader, ( array ).data, count_ * (int)sizeof( *( array ).data ) );                                           \
+		( array ).count = count_;                                                                                                \
+	}                                                                                                                            \
+	while ( 0 )
+
+static void b2WriteIdPool( b2StateWriter* writer, const b2IdPool* pool )
+{
+	B2_WRITE_VALUE( writer, pool->nextIndex );
+	B2_WRITE_ARRAY( writer, pool->freeArray );
+}
+
+static void b2ReadIdPool( b2StateReader* reader, b2IdPool* pool )
+{
+	B2_READ_VALUE( reader, pool->nextIndex );
+	B2_READ_ARRAY( reader, b2Int, pool->freeArray );
+}
+
+static void b2WriteBitSet( b2StateWriter* writer, const b2BitSet* bitSet )
+{
+	B2_WRITE_VALUE( writer, bitSet->blockCount );
+	b2WriteBytes( writer, bitSet->bits, (int)( bitSet->blockCount * sizeof( uint64_t ) ) );
+}
+
+static void b2ReadBitSet( b2StateReader* reader, b2BitSet* bitSet )
+{
+	uint32_t blockCount;
+	B2_READ_VALUE( reader, blockCount );
+	if ( blockCount > bitSet->blockCapacity )
+	{
+		b2GrowBitSet( bitSet, blockCount );
+	}
+	b2ReadInto( reader, bitSet->bits, (int)( blockCount * sizeof( uint64_t ) ) );
+
+	// Growing within the capacity doesn't clear, blocks past the count must stay zero
+	if ( blockCount < bitSet->blockCount )
+	{
+		memset( bitSet->bits + blockCount, 0, ( bitSet->blockCount - blockCount ) * sizeof( uint64_t ) );
+	}
+	bitSet->blockCount = blockCount;
+}
+
+// Items are stored by hash slot, so the capacity must match exactly. The sets are never iterated, so an empty set
+// of any capacity is equivalent. The move set is usually empty between steps.
+static void b2WriteHashSet( b2StateWriter* writer, const b2HashSet* set )
+{
+	B2_WRITE_VALUE( writer, set->capacity );
+	B2_WRITE_VALUE( writer, set->count );
+	if ( set->count > 0 )
+	{
+		b2WriteBytes( writer, set->items, (int)( set->capacity * sizeof( b2SetItem ) ) );
+	}
+}
+
+static void b2ReadHashSet( b2StateReader* reader, b2HashSet* set )
+{
+	uint32_t capacity, count;
+	B2_READ_VALUE( reader, capacity );
+	B2_READ_VALUE( reader, count );
+
+	if ( count == 0 )
+	{
+		if ( set->count > 0 )
+		{
+			b2ClearSet( set );
+		}
+		return;
+	}
+
+	if ( capacity != set->capacity )
+	{
+		b2DestroySet( set );
+		set->items = b2Alloc( capacity * sizeof( b2SetItem ) );
+		set->capacity = capacity;
+	}
+	set->count = count;
+	b2ReadInto( reader, set->items, (int)( capacity * sizeof( b2SetItem ) ) );
+}
+
+// Nodes are written up to the capacity because the free list lives in the unused nodes
+static void b2WriteTree( b2StateWriter* writer, const b2DynamicTree* tree )
+{
+	B2_WRITE_VALUE( writer, tree->root );
+	B2_WRITE_VALUE( writer, tree->nodeCount );
+	B2_WRITE_VALUE( writer, tree->nodeCapacity );
+	B2_WRITE_VALUE( writer, tree->freeList );
+	B2_WRITE_VALUE( writer, tree->proxyCount );
+	b2WriteBytes( writer, tree->nodes, tree->nodeCapacity * (int)sizeof( b2TreeNode ) );
+}
+
+static void b2ReadTree( b2StateReader* reader, b2DynamicTree* tree )
+{
+	int nodeCapacity;
+	B2_READ_VALUE( reader, tree->root );
+	B2_READ_VALUE( reader, tree->nodeCount );
+	B2_READ_VALUE( reader, nodeCapacity );
+	B2_READ_VALUE( reader, tree->freeList );
+	B2_READ_VALUE( reader, tree->proxyCount );
+
+	// The wide tree is built again before the next pair update
+	tree->wideNodeCount = 0;
+
+	if ( nodeCapacity > tree->nodeCapacity )
+	{
+		b2Free( tree->nodes, tree->nodeCapacity * sizeof( b2TreeNode ) );
+		tree->nodes = b2Alloc( nodeCapacity * sizeof( b2TreeNode ) );
+		tree->nodeCapacity = nodeCapacity;
+	}
+
+	if ( nodeCapacity == tree->nodeCapacity )
+	{
+		b2ReadInto( reader, tree->nodes, nodeCapacity * (int)sizeof( b2TreeNode ) );
+		return;
+	}
+
+	// Keep the larger pool and append the nodes past the saved capacity to the free list, in the order the tree
+	// would have added them when growing. Nodes are then allocated with the same indices as after the save. The
+	// free list is walked below, so this copy is not deferred.
+	int byteCount = nodeCapacity * (int)sizeof( b2TreeNode );
+	memcpy( tree->nodes, b2ReadBytes( reader, byteCount ), byteCount );
+
+	for ( int i = nodeCapacity; i < tree->nodeCapacity - 1; ++i )
+	{
+		tree->nodes[i].next = i + 1;
+		tree->nodes[i].height = -1;
+	}
+	tree->nodes[tree->nodeCapacity - 1].next = B2_NULL_INDEX;
+	tree->nodes[tree->nodeCapacity - 1].height = -1;
+
+	if ( tree->freeList == B2_NULL_INDEX )
+	{
+		tree->freeList = nodeCapacity;
+	}
+	else
+	{
+		int tail = tree->freeList;
+		while ( tree->nodes[tail].next != B2_NULL_INDEX )
+		{
+			tail = tree->nodes[tail].next;
+		}
+		tree->nodes[tail].next = nodeCapacity;
+	}
+}
+
+static void b2FreeSolverSetArrays( b2SolverSet* set )
+{
+	b2BodySimArray_Destroy( &set->bodySims );
+	b2BodyStateArray_Destroy( &set->bodyStates );
+	b2ContactSimArray_Destroy( &set->contactSims );
+	b2JointSimArray_Destroy( &set->jointSims );
+	b2IslandSimArray_Destroy( &set->islandSims );
+	*set = ( b2SolverSet ){ 0 };
+	set->setIndex = B2_NULL_INDEX;
+}
+
+// The entries are copied rather than binned again so that queries visit proxies in the same order
+static void b2WriteGrid( b2StateWriter* writer, const b2ProxyGrid* grid )
+{
+	B2_WRITE_ARRAY( writer, grid->proxies );
+	b2WriteIdPool( writer, &grid->proxyIdPool );
+	B2_WRITE_VALUE( writer, grid->proxyCount );
+	B2_WRITE_ARRAY( writer, grid->looseProxies );
+	B2_WRITE_ARRAY( writer, grid->entries );
+	B2_WRITE_ARRAY( writer, grid->bucketStarts );
+	B2_WRITE_VALUE( writer, grid->bucketMask );
+	B2_WRITE_VALUE( writer, grid->needsRebuild );
+}
+
+static void b2ReadGrid( b2StateReader* reader, b2ProxyGrid* grid )
+{
+	B2_READ_ARRAY( reader, b2GridProxy, grid->proxies );
+	b2ReadIdPool( reader, &grid->proxyIdPool );
+	B2_READ_VALUE( reader, grid->proxyCount );
+	B2_READ_ARRAY( reader, b2Int, grid->looseProxies );
+	B2_READ_ARRAY( reader, b2GridEntry, grid->entries );
+	B2_READ_ARRAY( reader, b2Int, grid->bucketStarts );
+	B2_READ_VALUE( reader, grid->bucketMask );
+	B2_READ_VALUE( reader, grid->needsRebuild );
+}
+
+static void b2WriteWorld( b2StateWriter* writer, b2World* world )
+{
+	b2StateHeader header = {
+		.magic = B2_STATE_MAGIC,
+		.worldId = world->worldId,
+		.worldRevision = world->revision,
+		.bodySize = sizeof( b2Body ),
+		.shapeSize = sizeof( b2Shape ),
+		.contactSimSize = sizeof( b2ContactSim ),
+		.jointSimSize = sizeof( b2JointSim ),
+	};
+
+	// byte count is patched by the caller
+	B2_WRITE_VALUE( writer, header );
+
+	B2_WRITE_VALUE( writer, world->stepIndex );
+	B2_WRITE_VALUE( writer, world->splitCandidates );
+	B2_WRITE_VALUE( writer, world->gravity );
+	B2_WRITE_VALUE( writer, world->hitEventThreshold );
+	B2_WRITE_VALUE( writer, world->restitutionThreshold );
+	B2_WRITE_VALUE( writer, world->maxLinearVelocity );
+	B2_WRITE_VALUE( writer, world->contactPushoutVelocity );
+	B2_WRITE_VALUE( writer, world->contactHertz );
+	B2_WRITE_VALUE( writer, world->contactDampingRatio );
+	B2_WRITE_VALUE( writer, world->jointHertz );
+	B2_WRITE_VALUE( writer, world->jointDampingRatio );
+	B2_WRITE_VALUE( writer, world->inv_h );
+	B2_WRITE_VALUE( writer, world->checksum );
+	B2_WRITE_VALUE( writer, world->enableSleep );
+	B2_WRITE_VALUE( writer, world->enableWarmStarting );
+	B2_WRITE_VALUE( writer, world->enableContinuous );
+
+	b2WriteIdPool( writer, &world->bodyIdPool );
+	b2WriteIdPool( writer, &world->solverSetIdPool );
+	b2WriteIdPool( writer, &world->jointIdPool );
+	b2WriteIdPool( writer, &world->contactIdPool );
+	b2WriteIdPool( writer, &world->islandIdPool );
+	b2WriteIdPool( writer, &world->shapeIdPool );
+	b2WriteIdPool( writer, &world->chainIdPool );
+
+	B2_WRITE_ARRAY( writer, world->bodies );
+	B2_WRITE_ARRAY( writer, world->joints );
+	B2_WRITE_ARRAY( writer, world->contacts );
+	B2_WRITE_ARRAY( writer, world->islands );
+	B2_WRITE_ARRAY( writer, world->shapes );
+	B2_WRITE_ARRAY( writer, world->chainShapes );
+
+	// Chain shape indices are immutable, but owned by each chain
+	for ( int i = 0; i < world->chainShapes.count; ++i )
+	{
+		b2ChainShape* chain = world->chainShapes.data + i;
+		if ( chain->id != B2_NULL_INDEX )
+		{
+			b2WriteBytes( writer, chain->shapeIndices, chain->count * (int)sizeof( int ) );
+		}
+	}
+
+	B2_WRITE_VALUE( writer, world->solverSets.count );
+	for ( int i = 0; i < world->solverSets.count; ++i )
+	{
+		b2SolverSet* set = world->solverSets.data + i;
+		B2_WRITE_VALUE( writer, set->setIndex );
+		if ( set->setIndex == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		B2_WRITE_ARRAY( writer, set->bodySims );
+		B2_WRITE_ARRAY( writer, set->bodyStates );
+		B2_WRITE_ARRAY( writer, set->jointSims );
+		B2_WRITE_ARRAY( writer, set->contactSims );
+		B2_WRITE_ARRAY( writer, set->islandSims );
+	}
+
+	for ( int i = 0; i < b2_graphColorCount; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		b2WriteBitSet( writer, &color->bodySet );
+		B2_WRITE_ARRAY( writer, color->contactSims );
+		B2_WRITE_ARRAY( writer, color->jointSims );
+	}
+
+	b2BroadPhase* bp = &world->broadPhase;
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		b2WriteTree( writer, bp->trees + i );
+	}
+	if ( bp->useDynamicGrid )
+	{
+		b2WriteGrid( writer, &bp->dynamicGrid );
+	}
+	B2_WRITE_VALUE( writer, bp->proxyCount );
+	b2WriteHashSet( writer, &bp->moveSet );
+	B2_WRITE_ARRAY( writer, bp->moveArray );
+	b2WriteHashSet( writer, &bp->pairSet );
+
+	// Events of the last step, bodies refer to their move event
+	B2_WRITE_ARRAY( writer, world->bodyMoveEvents );
+	B2_WRITE_ARRAY( writer, world->sensorBeginEvents );
+	B2_WRITE_ARRAY( writer, world->sensorEndEvents );
+	B2_WRITE_ARRAY( writer, world->contactBeginEvents );
+	B2_WRITE_ARRAY( writer, world->contactEndEvents );
+	B2_WRITE_ARRAY( writer, world->contactHitEvents );
+}
+
+static void b2ReadWorld( b2StateReader* reader, b2World* world )
+{
+	b2ReadBytes( reader, sizeof( b2StateHeader ) );
+
+	B2_READ_VALUE( reader, world->stepIndex );
+	B2_READ_VALUE( reader, world->splitCandidates );
+	B2_READ_VALUE( reader, world->gravity );
+	B2_READ_VALUE( reader, world->hitEventThreshold );
+	B2_READ_VALUE( reader, world->restitutionThreshold );
+	B2_READ_VALUE( reader, world->maxLinearVelocity );
+	B2_READ_VALUE( reader, world->contactPushoutVelocity );
+	B2_READ_VALUE( reader, world->contactHertz );
+	B2_READ_VALUE( reader, world->contactDampingRatio );
+	B2_READ_VALUE( reader, world->jointHertz );
+	B2_READ_VALUE( reader, world->jointDampingRatio );
+	B2_READ_VALUE( reader, world->inv_h );
+	B2_READ_VALUE( reader, world->checksum );
+	B2_READ_VALUE( reader, world->enableSleep );
+	B2_READ_VALUE( reader, world->enableWarmStarting );
+	B2_READ_VALUE( reader, world->enableContinuous );
+
+	b2ReadIdPool( reader, &world->bodyIdPool );
+	b2ReadIdPool( reader, &world->solverSetIdPool );
+	b2ReadIdPool( reader, &world->jointIdPool );
+	b2ReadIdPool( reader, &world->contactIdPool );
+	b2ReadIdPool( reader, &world->islandIdPool );
+	b2ReadIdPool( reader, &world->shapeIdPool );
+	b2ReadIdPool( reader, &world->chainIdPool );
+
+	B2_READ_ARRAY( reader, b2Body, world->bodies );
+	B2_READ_ARRAY( reader, b2Joint, world->joints );
+	B2_READ_ARRAY( reader, b2Contact, world->contacts );
+	B2_READ_ARRAY( reader, b2Island, world->islands );
+	B2_READ_ARRAY( reader, b2Shape, world->shapes );
+
+	// A chain keeps its index array when the saved chain in its slot is the same chain, otherwise the array is
+	// replaced. Chains are usually static level geometry, so this rarely allocates.
+	{
+		b2ChainShapeArray* chains = &world->chainShapes;
+		int oldCount = chains->count;
+		int count;
+		B2_READ_VALUE( reader, count );
+		const uint8_t* savedChains = b2ReadBytes( reader, count * (int)sizeof( b2ChainShape ) );
+
+		for ( int i = 0; i < oldCount; ++i )
+		{
+			b2ChainShape* chain = chains->data + i;
+			b2ChainShape saved = { .id = B2_NULL_INDEX };
+			if ( i < count )
+			{
+				memcpy( &saved, savedChains + i * sizeof( b2ChainShape ), sizeof( b2ChainShape ) );
+			}
+
+			bool same = chain->id == saved.id && chain->revision == saved.revision && chain->count == saved.count;
+			if ( chain->id == B2_NULL_INDEX )
+			{
+				chain->shapeIndices = NULL;
+			}
+			else if ( same == false )
+			{
+				b2Free( chain->shapeIndices, chain->count * sizeof( int ) );
+				chain->shapeIndices = NULL;
+			}
+		}
+
+		b2ChainShapeArray_Reserve( chains, count );
+		for ( int i = 0; i < count; ++i )
+		{
+			b2ChainShape* chain = chains->data + i;
+			int* shapeIndices = i < oldCount ? chain->shapeIndices : NULL;
+			memcpy( chain, savedChains + i * sizeof( b2ChainShape ), sizeof( b2ChainShape ) );
+
+			if ( chain->id == B2_NULL_INDEX )
+			{
+				chain->shapeIndices = NULL;
+				continue;
+			}
+
+			chain->shapeIndices = shapeIndices != NULL ? shapeIndices : b2Alloc( chain->count * sizeof( int ) );
+			b2ReadInto( reader, chain->shapeIndices, chain->count * (int)sizeof( int ) );
+		}
+		chains->count = count;
+	}
+
+	{
+		b2SolverSetArray* sets = &world->solverSets;
+		int count;
+		B2_READ_VALUE( reader, count );
+
+		for ( int i = count; i < sets->count; ++i )
+		{
+			b2FreeSolverSetArrays( sets->data + i );
+		}
+
+		if ( count > sets->count )
+		{
+			b2SolverSetArray_Reserve( sets, count );
+			memset( sets->data + sets->count, 0, ( count - sets->count ) * sizeof( b2SolverSet ) );
+		}
+		sets->count = count;
+
+		for ( int i = 0; i < count; ++i )
+		{
+			b2SolverSet* set = sets->data + i;
+			int setIndex;
+			B2_READ_VALUE( reader, setIndex );
+			if ( setIndex == B2_NULL_INDEX )
+			{
+				// Unused sets must have no arrays, they are created again when the set is reused
+				b2FreeSolverSetArrays( set );
+				continue;
+			}
+
+			set->setIndex = setIndex;
+			B2_READ_ARRAY( reader, b2BodySim, set->bodySims );
+			B2_READ_ARRAY( reader, b2BodyState, set->bodyStates );
+			B2_READ_ARRAY( reader, b2JointSim, set->jointSims );
+			B2_READ_ARRAY( reader, b2ContactSim, set->contactSims );
+			B2_READ_ARRAY( reader, b2IslandSim, set->islandSims );
+		}
+	}
+
+	for ( int i = 0; i < b2_graphColorCount; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		b2ReadBitSet( reader, &color->bodySet );
+		B2_READ_ARRAY( reader, b2ContactSim, color->contactSims );
+		B2_READ_ARRAY( reader, b2JointSim, color->jointSims );
+	}
+
+	b2BroadPhase* bp = &world->broadPhase;
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		b2ReadTree( reader, bp->trees + i );
+	}
+	if ( bp->useDynamicGrid )
+	{
+		b2ReadGrid( reader, &bp->dynamicGrid );
+	}
+	B2_READ_VALUE( reader, bp->proxyCount );
+	b2ReadHashSet( reader, &bp->moveSet );
+	B2_READ_ARRAY( reader, b2Int, bp->moveArray );
+	b2ReadHashSet( reader, &bp->pairSet );
+
+	B2_READ_ARRAY( reader, b2BodyMoveEvent, world->bodyMoveEvents );
+	B2_READ_ARRAY( reader, b2SensorBeginTouchEvent, world->sensorBeginEvents );
+	B2_READ_ARRAY( reader, b2SensorEndTouchEvent, world->sensorEndEvents );
+	B2_READ_ARRAY( reader, b2ContactBeginTouchEvent, world->contactBeginEvents );
+	B2_READ_ARRAY( reader, b2ContactEndTouchEvent, world->contactEndEvents );
+	B2_READ_ARRAY( reader, b2ContactHitEvent, world->contactHitEvents );
+
+	B2_ASSERT( reader->offset == reader->size );
+}
+
+int b2World_GetStateSize( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	b2StateWriter writer = { &world->stateCopies, NULL, 0, 0 };
+	b2WriteWorld( &writer, world );
+	return writer.size;
+}
+
+int b2World_SaveState( b2WorldId worldId, void* buffer, int capacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return 0;
+	}
+
+	b2StateWriter writer = { &world->stateCopies, buffer, capacity, 0 };
+	b2WriteWorld( &writer, world );
+	if ( writer.size > capacity )
+	{
+		b2StateCopyArray_Clear( &world->stateCopies );
+		return 0;
+	}
+
+	b2RunStateCopies( world );
+
+	b2StateHeader* header = buffer;
+	header->byteCount = writer.size;
+	return writer.size;
+}
+
+bool b2World_RestoreState( b2WorldId worldId, const void* buffer, int size )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked || size < (int)sizeof( b2StateHeader ) )
+	{
+		return false;
+	}
+
+	b2StateHeader header;
+	memcpy( &header, buffer, sizeof( header ) );
+	if ( header.magic != B2_STATE_MAGIC || header.worldId != world->worldId || header.worldRevision != world->revision ||
+		 header.byteCount != size || header.bodySize != sizeof( b2Body ) || header.shapeSize != sizeof( b2Shape ) ||
+		 header.contactSimSize != sizeof( b2ContactSim ) || header.jointSimSize != sizeof( b2JointSim ) )
+	{
+		return false;
+	}
+
+	b2StateReader reader = { &world->stateCopies, buffer, size, 0 };
+	b2ReadWorld( &reader, world );
+	b2RunStateCopies( world );
+
+	b2ValidateSolverSets( world );
+	b2ValidateContacts( world );
+	return true;
+}
@@ -20,6 +20,7 @@
 #include "LockLessMultiReadPipe.h"
 
 #include <algorithm>
+#include <chrono>
 
 #if defined __i386__ || defined __x86_64__
 #include "x86intrin.h"
@@ -180,6 +181,12 @@ namespace
     }
     #endif
 
+    uint64_t GetTimeNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
     void SafeCallback( ProfilerCallbackFunc func_, uint32_t threadnum_ )
     {
         if( func_ != nullptr )
@@ -288,6 +295,7 @@ void TaskScheduler::TaskingThreadFunction( const ThreadArgs& args_ )
     SafeCallback( pTS->m_Config.profilerCallbacks.threadStart, threadNum );
 
     uint32_t spinCount = 0;
+    bool     bSpinWindow = false;
     uint32_t hintPipeToCheck_io = threadNum + 1; // does not need to be clamped.
     while( pTS->GetIsRunningInt() )
     {
@@ -297,7 +305,17 @@ void TaskScheduler::TaskingThreadFunction( const ThreadArgs& args_ )
             ++spinCount;
             if( spinCount > gc_SpinCount )
             {
-                pTS->WaitForNewTasks( threadNum );
+                bSpinWindow = pTS->GetIsInSpinWindow();
+                if( bSpinWindow )
+                {
+                    // keep spinning at the longest backoff until the window passes
+                    spinCount = gc_SpinCount;
+                    SpinWait( gc_SpinCount * gc_SpinBackOffMultiplier );
+                }
+                else
+                {
+                    pTS->WaitForNewTasks( threadNum );
+                }
             }
             else
             {
@@ -307,6 +325,11 @@ void TaskScheduler::TaskingThreadFunction( const ThreadArgs& args_ )
         }
         else
         {
+            if( bSpinWindow )
+            {
+                pTS->m_NumSpinWindowTasks.fetch_add( 1, std::memory_order_relaxed );
+                bSpinWindow = false;
+            }
             spinCount = 0; // have run a task so reset spin count.
         }
     }
@@ -325,6 +348,7 @@ void TaskScheduler::StartThreads()
     }
 
     m_NumThreads = m_Config.numTaskThreadsToCreate + m_Config.numExternalTaskThreads + 1;
+    ResetWakeStats();
 
     for( int priority = 0; priority < TASK_PRIORITY_NUM; ++priority )
     {
@@ -710,14 +734,27 @@ void TaskScheduler::WaitForNewTasks( uint32_t threadNum_ )
     ThreadState prevThreadState = m_pThreadDataStore[threadNum_].threadState.load( std::memory_order_relaxed );
     m_pThreadDataStore[threadNum_].threadState.store( ENKI_THREAD_STATE_WAIT_NEW_TASKS, std::memory_order_seq_cst );
 
-    if( HaveTasks( threadNum_ ) )
+    // A spin window opened before the increment above sends no signal, so
+    // check for it here as for tasks.
+    if( HaveTasks( threadNum_ ) || GetIsInSpinWindow() )
     {
         m_NumThreadsWaitingForNewTasks.fetch_sub( 1, std::memory_order_release );
     }
     else
     {
         SafeCallback( m_Config.profilerCallbacks.waitForNewTaskSuspendStart, threadNum_ );
+        m_NumSuspends.fetch_add( 1, std::memory_order_relaxed );
         SemaphoreWait( *m_pNewTaskSemaphore );
+
+        // Latency from the last signal, threads woken together all measure from it.
+        uint64_t signalNs  = m_WakeSignalNs.load( std::memory_order_relaxed );
+        uint64_t nowNs     = GetTimeNs();
+        uint64_t latencyNs = nowNs > signalNs ? nowNs - signalNs : 0;
+        m_NumWakes.fetch_add( 1, std::memory_order_relaxed );
+        m_WakeLatencyTotalNs.fetch_add( latencyNs, std::memory_order_relaxed );
+        uint64_t maxNs = m_WakeLatencyMaxNs.load( std::memory_order_relaxed );
+        while( latencyNs > maxNs && !m_WakeLatencyMaxNs.compare_exchange_weak( maxNs, latencyNs, std::memory_order_relaxed ) ) {}
+
         SafeCallback( m_Config.profilerCallbacks.waitForNewTaskSuspendStop, threadNum_ );
     }
 
@@ -769,6 +806,7 @@ void TaskScheduler::WakeThreadsForNewTasks()
 
     if( waiting > 0 )
     {
+        m_WakeSignalNs.store( GetTimeNs(), std::memory_order_relaxed );
         SemaphoreSignal( *m_pNewTaskSemaphore, waiting );
     }
 
@@ -776,6 +814,54 @@ void TaskScheduler::WakeThreadsForNewTasks()
     WakeThreadsForTaskCompletion();
 }
 
+bool TaskScheduler::GetIsInSpinWindow() const
+{
+    // seq_cst pairs with SpinTaskThreadsFor() so a thread about to suspend sees the window
+    return GetTimeNs() < m_SpinUntilNs.load( std::memory_order_seq_cst );
+}
+
+void TaskScheduler::SpinTaskThreadsFor( uint64_t durationNs_ )
+{
+    uint64_t nowNs     = GetTimeNs();
+    uint64_t untilNs   = nowNs + durationNs_;
+    uint64_t prevNs    = m_SpinUntilNs.load( std::memory_order_relaxed );
+    while( untilNs > prevNs && !m_SpinUntilNs.compare_exchange_weak( prevNs, untilNs, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {}
+
+    if( prevNs <= nowNs )
+    {
+        // window was closed, threads may be suspended. Only threads waiting for new
+        // tasks spin, threads waiting for task completion are left suspended.
+        int32_t waiting = m_NumThreadsWaitingForNewTasks.load( std::memory_order_seq_cst );
+        while( waiting > 0 && !m_NumThreadsWaitingForNewTasks.compare_exchange_weak( waiting, 0, std::memory_order_release, std::memory_order_relaxed ) ) {}
+
+        if( waiting > 0 )
+        {
+            m_WakeSignalNs.store( GetTimeNs(), std::memory_order_relaxed );
+            SemaphoreSignal( *m_pNewTaskSemaphore, waiting );
+        }
+    }
+}
+
+WakeStats TaskScheduler::GetWakeStats() const
+{
+    WakeStats stats;
+    stats.numSuspends        = m_NumSuspends.load( std::memory_order_relaxed );
+    stats.numWakes           = m_NumWakes.load( std::memory_order_relaxed );
+    stats.wakeLatencyTotalNs = m_WakeLatencyTotalNs.load( std::memory_order_relaxed );
+    stats.wakeLatencyMaxNs   = m_WakeLatencyMaxNs.load( std::memory_order_relaxed );
+    stats.numSpinWindowTasks = m_NumSpinWindowTasks.load( std::memory_order_relaxed );
+    return stats;
+}
+
+void TaskScheduler::ResetWakeStats()
+{
+    m_NumSuspends.store( 0, std::memory_order_relaxed );
+    m_NumWakes.store( 0, std::memory_order_relaxed );
+    m_WakeLatencyTotalNs.store( 0, std::memory_order_relaxed );
+    m_WakeLatencyMaxNs.store( 0, std::memory_order_relaxed );
+    m_NumSpinWindowTasks.store( 0, std::memory_order_relaxed );
+}
+
 void TaskScheduler::WakeThreadsForTaskCompletion()
 {
     // m_NumThreadsWaitingForTaskCompletion can go negative as this indicates that
@@ -1283,6 +1369,13 @@ TaskScheduler::TaskScheduler()
         , m_NumInitialPartitions(0)
         , m_bHaveThreads(false)
         , m_NumExternalTaskThreadsRegistered(0)
+        , m_SpinUntilNs(0)
+        , m_WakeSignalNs(0)
+        , m_NumSuspends(0)
+        , m_NumWakes(0)
+        , m_WakeLatencyTotalNs(0)
+        , m_WakeLatencyMaxNs(0)
+        , m_NumSpinWindowTasks(0)
 {
 }
 
@@ -274,6 +274,16 @@ namespace enki
         void*     userData = nullptr;
     };
 
+    // Counters of task threads suspending and waking for new tasks, see TaskScheduler::GetWakeStats()
+    struct WakeStats
+    {
+        uint64_t numSuspends;        // task threads suspended waiting for new tasks
+        uint64_t numWakes;           // suspended task threads woken by new tasks
+        uint64_t wakeLatencyTotalNs; // sum over numWakes of the time from signalling to the thread running
+        uint64_t wakeLatencyMaxNs;
+        uint64_t numSpinWindowTasks; // tasks found by threads kept spinning by SpinTaskThreadsFor()
+    };
+
     // TaskSchedulerConfig - configuration struct for advanced Initialize
     struct TaskSchedulerConfig
     {
@@ -385,6 +395,16 @@ namespace enki
         // It is guaranteed that GetThreadNum() < GetNumTaskThreads()
         ENKITS_API uint32_t        GetNumTaskThreads() const;
 
+        // Task threads out of tasks spin instead of suspending until durationNs_ from now,
+        // the window only grows. Suspended threads are woken when a window opens so they
+        // are spinning when the next tasks are added, saving the OS wake up latency.
+        // Cheap to call for every added task. Threads suspend as usual once the window passes.
+        ENKITS_API void            SpinTaskThreadsFor( uint64_t durationNs_ );
+
+        // Counters since Initialize() or the last ResetWakeStats().
+        ENKITS_API WakeStats       GetWakeStats() const;
+        ENKITS_API void            ResetWakeStats();
+
         // Returns the current task threadNum.
         // Will return 0 for thread which initialized the task scheduler,
         // and NO_THREAD_NUM for all other non-enkiTS threads which have not been registered ( see RegisterExternalTaskThread() ),
@@ -452,6 +472,7 @@ namespace enki
         bool        WakeSuspendedThreadsWithPinnedTasks( uint32_t threadNum_ );
         void        InitDependencies( ICompletable* pCompletable_  );
         inline bool GetIsRunningInt() const { return m_bRunning.load( std::memory_order_acquire ); }
+        bool        GetIsInSpinWindow() const;
 
         ENKITS_API void TaskComplete( ICompletable* pTask_, bool bWakeThreads_, uint32_t threadNum_ );
         ENKITS_API void AddTaskSetToPipeInt( ITaskSet* pTaskSet_, uint32_t threadNum_ );
@@ -485,6 +506,13 @@ namespace enki
         bool                   m_bHaveThreads;
         TaskSchedulerConfig    m_Config;
         std::atomic<int32_t>   m_NumExternalTaskThreadsRegistered;
+        std::atomic<uint64_t>  m_SpinUntilNs;
+        std::atomic<uint64_t>  m_WakeSignalNs;
+        std::atomic<uint64_t>  m_NumSuspends;
+        std::atomic<uint64_t>  m_NumWakes;
+        std::atomic<uint64_t>  m_WakeLatencyTotalNs;
+        std::atomic<uint64_t>  m_WakeLatencyMaxNs;
+        std::atomic<uint64_t>  m_NumSpinWindowTasks;
 
         TaskScheduler( const TaskScheduler& nocopy_ );
         TaskScheduler& operator=( const TaskScheduler& nocopy_ );
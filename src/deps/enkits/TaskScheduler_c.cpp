@@ -411,6 +411,28 @@ uint32_t enkiGetNumTaskThreads( enkiTaskScheduler* pETS_ )
     return pETS_->GetNumTaskThreads();
 }
 
+void enkiSpinTaskThreadsFor( enkiTaskScheduler* pETS_, uint64_t durationNs_ )
+{
+    pETS_->SpinTaskThreadsFor( durationNs_ );
+}
+
+enkiWakeStats enkiGetWakeStats( enkiTaskScheduler* pETS_ )
+{
+    WakeStats stats = pETS_->GetWakeStats();
+    enkiWakeStats statsC;
+    statsC.numSuspends        = stats.numSuspends;
+    statsC.numWakes           = stats.numWakes;
+    statsC.wakeLatencyTotalNs = stats.wakeLatencyTotalNs;
+    statsC.wakeLatencyMaxNs   = stats.wakeLatencyMaxNs;
+    statsC.numSpinWindowTasks = stats.numSpinWindowTasks;
+    return statsC;
+}
+
+void enkiResetWakeStats( enkiTaskScheduler* pETS_ )
+{
+    pETS_->ResetWakeStats();
+}
+
 uint32_t enkiGetThreadNum( enkiTaskScheduler* pETS_ )
 {
     return pETS_->GetThreadNum();
@@ -106,6 +106,16 @@ struct enkiParamsCompletionAction
     const enkiCompletable* pDependency; // task which when complete triggers completion function
 };
 
+// Counters of task threads suspending and waking for new tasks, see enkiGetWakeStats()
+struct enkiWakeStats
+{
+    uint64_t numSuspends;        // task threads suspended waiting for new tasks
+    uint64_t numWakes;           // suspended task threads woken by new tasks
+    uint64_t wakeLatencyTotalNs; // sum over numWakes of the time from signalling to the thread running
+    uint64_t wakeLatencyMaxNs;
+    uint64_t numSpinWindowTasks; // tasks found by threads kept spinning by enkiSpinTaskThreadsFor()
+};
+
 // enkiTaskSchedulerConfig - configuration struct for advanced Initialize
 // Always use enkiGetTaskSchedulerConfig() to get defaults prior to altering and
 // initializing with enkiInitTaskSchedulerWithConfig().
@@ -190,6 +200,16 @@ ENKITS_API void                enkiWaitForAll( enkiTaskScheduler* pETS_ );
 // It is guaranteed that enkiGetThreadNum() < enkiGetNumTaskThreads()
 ENKITS_API uint32_t            enkiGetNumTaskThreads( enkiTaskScheduler* pETS_ );
 
+// Task threads out of tasks spin instead of suspending until durationNs_ from now,
+// the window only grows. Suspended threads are woken when a window opens so they
+// are spinning when the next tasks are added, saving the OS wake up latency.
+// Cheap to call for every added task. Threads suspend as usual once the window passes.
+ENKITS_API void                enkiSpinTaskThreadsFor( enkiTaskScheduler* pETS_, uint64_t durationNs_ );
+
+// Counters since initialization or the last enkiResetWakeStats().
+ENKITS_API struct enkiWakeStats enkiGetWakeStats( enkiTaskScheduler* pETS_ );
+ENKITS_API void                enkiResetWakeStats( enkiTaskScheduler* pETS_ );
+
 // Returns the current task threadNum.
 // Will return 0 for thread which initialized the task scheduler,
 // and ENKI_NO_THREAD_NUM for all other non-enkiTS threads which have not been registered ( see enkiRegisterExternalTaskThread() ),
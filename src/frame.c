@@ -0,0 +1,144 @@
+#include "pch.h"
+#include "trace.h"
+#include "frame.h"
+
+static void
+frame_node_execute(uint32_t start_index, uint32_t end_index,
+  uint32_t worker_index, void *args)
+{
+  (void)start_index;
+  (void)end_index;
+  (void)worker_index;
+  assert(args);
+  FrameNode *node = (FrameNode *)args;
+
+  node->begin_ms = b2GetMilliseconds(&node->graph->run_timer);
+  trace_begin(node->name);
+  node->fn(node->context);
+  trace_end();
+  node->end_ms = b2GetMilliseconds(&node->graph->run_timer);
+}
+
+void
+frame_graph_init(FrameGraph *graph, enkiTaskScheduler *scheduler)
+{
+  assert(graph && scheduler);
+  *graph = (FrameGraph){ .scheduler = scheduler };
+}
+
+void
+frame_graph_deinit(FrameGraph *graph)
+{
+  assert(graph);
+
+  for (uint32_t i = 0; i < graph->num_nodes; ++i) {
+    FrameNode *node = &graph->nodes[i];
+    for (uint32_t d = 0; d < node->num_deps; ++d) {
+      enkiDeleteDependency(graph->scheduler, node->dependencies[d]);
+    }
+    enkiDeleteTaskSet(graph->scheduler, node->task);
+  }
+  *graph = (FrameGraph){0};
+}
+
+uint32_t
+frame_graph_add(FrameGraph *graph, const char *name, FrameNodeFn *fn,
+  void *context)
+{
+  assert(graph && name && fn);
+  assert(graph->num_nodes < FRAME_MAX_NODES && graph->num_runs == 0);
+
+  uint32_t index = graph->num_nodes++;
+  FrameNode *node = &graph->nodes[index];
+  *node = (FrameNode){
+    .graph = graph,
+    .name = name,
+    .fn = fn,
+    .context = context,
+    .task = enkiCreateTaskSet(graph->scheduler, frame_node_execute),
+  };
+  enkiSetArgsTaskSet(node->task, node);
+  return index;
+}
+
+void
+frame_graph_depend(FrameGraph *graph, uint32_t node, uint32_t dependency)
+{
+  assert(graph && graph->num_runs == 0);
+  // Dependencies on earlier nodes only, the graph can't have cycles.
+  assert(dependency < node && node < graph->num_nodes);
+
+  FrameNode *n = &graph->nodes[node];
+  assert(n->num_deps < FRAME_MAX_DEPS);
+
+  enkiDependency *dep = enkiCreateDependency(graph->scheduler);
+  enkiSetDependency(dep,
+    enkiGetCompletableFromTaskSet(graph->nodes[dependency].task),
+    enkiGetCompletableFromTaskSet(n->task));
+
+  n->dependencies[n->num_deps] = dep;
+  n->deps[n->num_deps] = dependency;
+  n->num_deps += 1;
+}
+
+// Longest chain of dependent nodes by their time in the last run. Nodes only
+// depend on earlier ones, so index order is a topological order.
+static void
+compute_critical_path(FrameGraph *graph)
+{
+  float path_ms[FRAME_MAX_NODES];
+  uint32_t prev[FRAME_MAX_NODES];
+  uint32_t last = 0;
+
+  for (uint32_t i = 0; i < graph->num_nodes; ++i) {
+    const FrameNode *node = &graph->nodes[i];
+    float before_ms = 0.0f;
+    prev[i] = UINT32_MAX;
+    for (uint32_t d = 0; d < node->num_deps; ++d) {
+      if (path_ms[node->deps[d]] > before_ms) {
+        before_ms = path_ms[node->deps[d]];
+        prev[i] = node->deps[d];
+      }
+    }
+    path_ms[i] = before_ms + graph->node_ms[i];
+    if (path_ms[i] > path_ms[last]) last = i;
+  }
+
+  uint32_t len = 0;
+  for (uint32_t i = last; i != UINT32_MAX; i = prev[i]) {
+    graph->critical_path[len++] = i;
+  }
+  for (uint32_t i = 0; i < len / 2; ++i) {
+    uint32_t t = graph->critical_path[i];
+    graph->critical_path[i] = graph->critical_path[len - 1 - i];
+    graph->critical_path[len - 1 - i] = t;
+  }
+  graph->critical_path_len = len;
+  graph->critical_ms = path_ms[last];
+}
+
+void
+frame_graph_run(FrameGraph *graph)
+{
+  assert(graph && graph->scheduler);
+  if (graph->num_nodes == 0) return;
+
+  graph->run_timer = b2CreateTimer();
+
+  // enkiTS starts the dependent nodes.
+  for (uint32_t i = 0; i < graph->num_nodes; ++i) {
+    if (graph->nodes[i].num_deps == 0)
+      enkiAddTaskSet(graph->scheduler, graph->nodes[i].task);
+  }
+  for (uint32_t i = 0; i < graph->num_nodes; ++i) {
+    enkiWaitForTaskSet(graph->scheduler, graph->nodes[i].task);
+  }
+
+  graph->frame_ms = b2GetMilliseconds(&graph->run_timer);
+  for (uint32_t i = 0; i < graph->num_nodes; ++i) {
+    const FrameNode *node = &graph->nodes[i];
+    graph->node_ms[i] = node->end_ms - node->begin_ms;
+  }
+  compute_critical_path(graph);
+  graph->num_runs += 1;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+//
+// Per-frame task graph on enkiTS. Nodes are declared once with their
+// dependencies (enkiDependency), every `frame_graph_run()` starts the nodes
+// without dependencies and enkiTS starts the others when theirs complete, so
+// independent phases of the frame run concurrently.
+//
+
+#define FRAME_MAX_NODES 16
+#define FRAME_MAX_DEPS 4
+
+typedef void FrameNodeFn(void *context);
+
+typedef struct FrameGraph FrameGraph;
+
+typedef struct FrameNode
+{
+  FrameGraph *graph;
+  const char *name; // string literal, also the trace zone
+  FrameNodeFn *fn;
+  void *context;
+  uint32_t deps[FRAME_MAX_DEPS]; // nodes added before this one
+  uint32_t num_deps;
+
+  enkiTaskSet *task;
+  enkiDependency *dependencies[FRAME_MAX_DEPS];
+
+  // Written by the node while the graph runs [ms since the run started].
+  float begin_ms;
+  float end_ms;
+} FrameNode;
+
+typedef struct FrameGraph
+{
+  enkiTaskScheduler *scheduler;
+  FrameNode nodes[FRAME_MAX_NODES];
+  uint32_t num_nodes;
+  b2Timer run_timer;
+
+  // Results of the last run, not touched while a run is in flight.
+  float node_ms[FRAME_MAX_NODES];
+  float frame_ms; // wall time of the run
+  float critical_ms; // sum of `node_ms` along the critical path
+  uint32_t critical_path[FRAME_MAX_NODES]; // node indices, first node first
+  uint32_t critical_path_len;
+  uint32_t num_runs;
+} FrameGraph;
+
+/// The graph must not move after init, its tasks point to it.
+void frame_graph_init(FrameGraph *graph, enkiTaskScheduler *scheduler);
+void frame_graph_deinit(FrameGraph *graph);
+
+/// Adds a node that calls `fn(context)` once per run. Returns its index.
+/// Nodes can't be added after the first run.
+uint32_t frame_graph_add(FrameGraph *graph, const char *name, FrameNodeFn *fn,
+  void *context);
+
+/// `node` starts when `dependency` (added before it) completes.
+void frame_graph_depend(FrameGraph *graph, uint32_t node,
+  uint32_t dependency);
+
+/// Runs every node once and returns when all are done. Call from the thread
+/// that created the scheduler. Computes the critical path of the run: the
+/// chain of dependent nodes with the longest total time, the frame can't be
+/// shorter than that however many workers there are.
+void frame_graph_run(FrameGraph *graph);
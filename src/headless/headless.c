@@ -0,0 +1,791 @@
+#include "pch.h"
+#include "cpu_gpu_common.h"
+#include "cpu.h"
+#include "prof.h"
+#include "trace.h"
+#include "phy.h"
+#include "obj.h"
+#include "scn.h"
+
+//
+// Headless physics runner. Builds the same PhyState (world, enkiTS scheduler)
+// as the game, fills it with a pile of 1m boxes and steps it without a window
+// or GPU. Used to benchmark physics throughput on machines with no display.
+//
+
+static const char *simd_names[] = {
+  [b2_simdDefault] = "default",
+  [b2_simdNone] = "none",
+  [b2_simdSSE2] = "sse2",
+  [b2_simdNEON] = "neon",
+  [b2_simdAVX2] = "avx2",
+  [b2_simdAVX512] = "avx512",
+};
+
+typedef struct HeadlessArgs
+{
+  uint32_t num_threads;
+  uint32_t num_bodies;
+  uint32_t num_steps;
+  uint32_t num_churn;
+  uint32_t num_queries;
+  uint32_t num_rollback;
+  uint32_t num_worlds;
+  uint32_t spin_us;
+  int32_t num_substeps;
+  float step_rate; // Hz; 0 steps as fast as possible
+  bool enable_sleep;
+  bool pin_threads;
+  bool enable_checksum;
+  bool narrow_trees;
+  float grid_cell_size;
+  b2SIMDType simd_type;
+  const char *csv_filename;
+  const char *json_filename;
+  const char *scene_filename;
+  const char *save_scene_filename;
+  const char *trace_filename;
+} HeadlessArgs;
+
+// Inputs and outputs of the per-step query batches, see `run_queries()`.
+typedef struct QueryBench
+{
+  b2AABB *aabbs;
+  b2Transform *origins;
+  b2Vec2 *translations;
+  b2ShapeId *hits;
+  int32_t *num_hits;
+  b2RayResult *results;
+  int32_t max_hits;
+  uint64_t total_hits;
+  float total_ms;
+} QueryBench;
+
+// World states saved before each of the last `num_frames` steps and the
+// checksums those steps produced, see `run_rollback()`.
+typedef struct RollbackBench
+{
+  uint8_t **states;
+  int32_t *state_sizes;
+  int32_t *state_capacities;
+  uint64_t *checksums;
+  uint32_t num_frames;
+  uint32_t num_saves;
+  uint32_t num_rollbacks;
+  uint32_t num_mismatches;
+  int32_t max_state_size;
+  float total_save_ms;
+  float total_restore_ms;
+  float max_restore_ms;
+  float total_replay_ms;
+} RollbackBench;
+
+static void
+print_usage(const char *exe)
+{
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  -t, --threads N    worker threads including main (default: number of\n"
+    "                     performance cores)\n"
+    "  --pin              pin worker threads to distinct cores (workers beyond\n"
+    "                     the core count are not pinned)\n"
+    "  --spin US          keep workers spinning US microseconds after physics\n"
+    "                     tasks before they sleep (default: 0)\n"
+    "  -b, --bodies N     number of dynamic boxes (default: 1000)\n"
+    "  -s, --steps N      number of steps to run (default: 1000)\n"
+    "  -u, --substeps N   box2d sub-steps per step (default: 1)\n"
+    "  -r, --rate HZ      run at a fixed step rate (default: unbounded)\n"
+    "  -c, --churn N      destroy and respawn N boxes every step (default: 0)\n"
+    "  -q, --queries N    run N AABB overlaps, rays and box casts every step\n"
+    "                     as batches (default: 0)\n"
+    "  --rollback N       save the world every step, every N steps restore the\n"
+    "                     oldest state and re-simulate N steps (no --churn)\n"
+    "  -w, --worlds N     step N copies of the scene as a world group on one\n"
+    "                     scheduler (no --churn, --queries, --rollback, --scene)\n"
+    "  --csv FILE         write per-step profile of the run to FILE\n"
+    "  --json FILE        write profile stats and samples to FILE\n"
+    "  --trace FILE       write a Chrome trace of the last steps of every\n"
+    "                     thread to FILE (chrome://tracing, ui.perfetto.dev)\n"
+    "  --scene FILE       load the scene from FILE instead of building it\n"
+    "  --save-scene FILE  write the scene to FILE after the last step\n"
+    "  --simd ISA         contact solver: none, sse2, neon, avx2, avx512\n"
+    "                     (default: widest supported by the CPU)\n"
+    "  --checksum         print a checksum of the state over all steps\n"
+    "  --narrow-trees     query the binary broad-phase trees instead of their\n"
+    "                     4-wide copies\n"
+    "  --grid SIZE        keep dynamic boxes in a broad-phase grid with cells\n"
+    "                     of SIZE meters instead of a tree\n"
+    "  --no-sleep         disable body sleeping\n", exe);
+}
+
+static bool
+parse_args(int argc, char **argv, HeadlessArgs *args)
+{
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+    if (strcmp(arg, "--no-sleep") == 0) {
+      args->enable_sleep = false;
+      continue;
+    }
+    if (strcmp(arg, "--pin") == 0) {
+      args->pin_threads = true;
+      continue;
+    }
+    if (strcmp(arg, "--checksum") == 0) {
+      args->enable_checksum = true;
+      continue;
+    }
+    if (strcmp(arg, "--narrow-trees") == 0) {
+      args->narrow_trees = true;
+      continue;
+    }
+    if (value == NULL) return false;
+
+    if (strcmp(arg, "-t") == 0 || strcmp(arg, "--threads") == 0) {
+      args->num_threads = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-b") == 0 || strcmp(arg, "--bodies") == 0) {
+      args->num_bodies = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-s") == 0 || strcmp(arg, "--steps") == 0) {
+      args->num_steps = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-u") == 0 || strcmp(arg, "--substeps") == 0) {
+      args->num_substeps = (int32_t)strtol(value, NULL, 10);
+    } else if (strcmp(arg, "-c") == 0 || strcmp(arg, "--churn") == 0) {
+      args->num_churn = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-q") == 0 || strcmp(arg, "--queries") == 0) {
+      args->num_queries = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--rollback") == 0) {
+      args->num_rollback = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-w") == 0 || strcmp(arg, "--worlds") == 0) {
+      args->num_worlds = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--spin") == 0) {
+      args->spin_us = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-r") == 0 || strcmp(arg, "--rate") == 0) {
+      args->step_rate = strtof(value, NULL);
+    } else if (strcmp(arg, "--csv") == 0) {
+      args->csv_filename = value;
+    } else if (strcmp(arg, "--json") == 0) {
+      args->json_filename = value;
+    } else if (strcmp(arg, "--trace") == 0) {
+      args->trace_filename = value;
+    } else if (strcmp(arg, "--scene") == 0) {
+      args->scene_filename = value;
+    } else if (strcmp(arg, "--save-scene") == 0) {
+      args->save_scene_filename = value;
+    } else if (strcmp(arg, "--grid") == 0) {
+      args->grid_cell_size = strtof(value, NULL);
+      if (args->grid_cell_size <= 0.0f) return false;
+    } else if (strcmp(arg, "--simd") == 0) {
+      uint32_t type = 0;
+      while (type < _countof(simd_names) && strcmp(value, simd_names[type]))
+        type += 1;
+      if (type == _countof(simd_names)) return false;
+      args->simd_type = (b2SIMDType)type;
+    } else {
+      return false;
+    }
+    i += 1;
+  }
+  // Churned objects are not part of the world state.
+  if (args->num_rollback > 0 && args->num_churn > 0) return false;
+  // Groups run the plain scene only.
+  if (args->num_worlds > 0 && (args->num_churn > 0 || args->num_queries > 0 ||
+    args->num_rollback > 0 || args->scene_filename))
+    return false;
+  return args->num_substeps > 0 && args->step_rate >= 0.0f;
+}
+
+static ObjHandle
+create_box(b2WorldId world, ObjStore *objects, b2Vec2 position)
+{
+  CgObject *object;
+  ObjHandle handle = obj_create(objects, &object);
+
+  b2BodyDef body_def = b2DefaultBodyDef();
+  body_def.type = b2_dynamicBody;
+  body_def.position = position;
+  body_def.userData = obj_handle_to_ptr(handle);
+  b2BodyId body_id = b2CreateBody(world, &body_def);
+
+  b2Polygon box1m = b2MakeBox(0.5f, 0.5f);
+  b2ShapeDef shape_def = b2DefaultShapeDef();
+  b2CreatePolygonShape(body_id, &shape_def, &box1m);
+
+  *object = (CgObject){ .phy_body_id = *(uint64_t *)&body_id };
+  return handle;
+}
+
+static void
+destroy_object(ObjStore *objects, ObjHandle handle)
+{
+  CgObject *object = obj_get(objects, handle);
+  if (object == NULL) return;
+
+  b2DestroyBody(*(b2BodyId *)&object->phy_body_id);
+  obj_destroy(objects, handle);
+}
+
+static float
+create_scene(b2WorldId world, uint32_t num_bodies, ObjStore *objects)
+{
+  b2ShapeDef shape_def = b2DefaultShapeDef();
+
+  uint32_t num_columns = (uint32_t)ceilf(sqrtf((float)num_bodies));
+  if (num_columns == 0) num_columns = 1;
+  float half_width = 0.5f * 1.1f * (float)num_columns + 1.0f;
+
+  // Ground and two side walls.
+  const b2Vec2 wall_pos[3] = {
+    { 0.0f, -0.5f }, { -half_width - 0.5f, 0.0f }, { half_width + 0.5f, 0.0f },
+  };
+  const b2Vec2 wall_size[3] = {
+    { half_width + 1.0f, 0.5f }, { 0.5f, 2.0f * half_width },
+    { 0.5f, 2.0f * half_width },
+  };
+  for (uint32_t i = 0; i < 3; ++i) {
+    CgObject *object;
+    ObjHandle handle = obj_create(objects, &object);
+
+    b2BodyDef body_def = b2DefaultBodyDef();
+    body_def.type = b2_staticBody;
+    body_def.position = wall_pos[i];
+    body_def.userData = obj_handle_to_ptr(handle);
+    b2BodyId body_id = b2CreateBody(world, &body_def);
+
+    b2Polygon wall = b2MakeBox(wall_size[i].x, wall_size[i].y);
+    b2CreatePolygonShape(body_id, &shape_def, &wall);
+
+    *object = (CgObject){ .phy_body_id = *(uint64_t *)&body_id };
+  }
+
+  for (uint32_t i = 0; i < num_bodies; ++i) {
+    uint32_t column = i % num_columns;
+    uint32_t row = i / num_columns;
+
+    create_box(world, objects, (b2Vec2){
+      -half_width + 1.0f + 1.1f * (float)column + 0.05f * (float)(row & 1),
+      0.5f + 1.1f * (float)row,
+    });
+  }
+
+  return half_width;
+}
+
+// Loaded scenes are expected to be saved by this program, side walls are the
+// right-most bodies then.
+static float
+scene_half_width(const ObjStore *objects)
+{
+  float max_x = 1.5f;
+  for (uint32_t i = 0; i < obj_count(objects); ++i) {
+    if (objects->objects[i].position[0] > max_x)
+      max_x = objects->objects[i].position[0];
+  }
+  return max_x - 0.5f;
+}
+
+static void
+churn_scene(PhyState *phy, ObjStore *objects, uint32_t num_churn,
+  float half_width)
+{
+  // Static walls are created first, skip them.
+  uint32_t num_dynamic = obj_count(objects) - 3;
+  if (num_dynamic == 0) return;
+
+  for (uint32_t i = 0; i < num_churn; ++i) {
+    uint32_t dense_idx = 3 + (uint32_t)rand() % num_dynamic;
+    destroy_object(objects, objects->handles[dense_idx]);
+
+    float x = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * (half_width - 1.0f);
+    create_box(phy->world, objects, (b2Vec2){ x, 4.0f * half_width });
+  }
+}
+
+static void
+query_bench_init(QueryBench *bench, uint32_t num_queries)
+{
+  *bench = (QueryBench){ .max_hits = 8 };
+  if (num_queries == 0) return;
+
+  bench->aabbs = M_ALLOC(num_queries * sizeof(b2AABB));
+  bench->origins = M_ALLOC(num_queries * sizeof(b2Transform));
+  bench->translations = M_ALLOC(num_queries * sizeof(b2Vec2));
+  bench->hits = M_ALLOC(num_queries * bench->max_hits * sizeof(b2ShapeId));
+  bench->num_hits = M_ALLOC(num_queries * sizeof(int32_t));
+  bench->results = M_ALLOC(num_queries * sizeof(b2RayResult));
+}
+
+static void
+query_bench_deinit(QueryBench *bench)
+{
+  if (bench->aabbs) {
+    M_FREE(bench->aabbs);
+    M_FREE(bench->origins);
+    M_FREE(bench->translations);
+    M_FREE(bench->hits);
+    M_FREE(bench->num_hits);
+    M_FREE(bench->results);
+  }
+  *bench = (QueryBench){0};
+}
+
+static float
+random_float(float min, float max)
+{
+  return min + (max - min) * ((float)rand() / RAND_MAX);
+}
+
+static void
+run_queries(PhyState *phy, QueryBench *bench, uint32_t num_queries,
+  float half_width)
+{
+  for (uint32_t i = 0; i < num_queries; ++i) {
+    b2Vec2 p = { random_float(-half_width, half_width),
+      random_float(0.0f, 2.0f * half_width) };
+    bench->aabbs[i] = (b2AABB){ { p.x - 1.0f, p.y - 1.0f },
+      { p.x + 1.0f, p.y + 1.0f } };
+    bench->origins[i] = (b2Transform){ p, b2Rot_identity };
+    bench->translations[i] = (b2Vec2){ random_float(-10.0f, 10.0f),
+      random_float(-10.0f, 10.0f) };
+  }
+
+  b2Polygon box = b2MakeBox(0.25f, 0.25f);
+  PhyQueryBatch batch = {
+    .num_queries = (int32_t)num_queries,
+    .filter = b2DefaultQueryFilter(),
+    .aabbs = bench->aabbs,
+    .max_hits = bench->max_hits,
+    .hits = bench->hits,
+    .num_hits = bench->num_hits,
+    .origins = bench->origins,
+    .translations = bench->translations,
+    .polygon = &box,
+    .results = bench->results,
+  };
+
+  b2Timer timer = b2CreateTimer();
+
+  batch.type = PhyQueryType_OverlapAABB;
+  phy_query_batch(phy, &batch);
+  for (uint32_t i = 0; i < num_queries; ++i) {
+    bench->total_hits += (uint64_t)bench->num_hits[i];
+  }
+
+  batch.type = PhyQueryType_CastRay;
+  phy_query_batch(phy, &batch);
+  for (uint32_t i = 0; i < num_queries; ++i) {
+    bench->total_hits += bench->results[i].hit;
+  }
+
+  batch.type = PhyQueryType_CastPolygon;
+  phy_query_batch(phy, &batch);
+  for (uint32_t i = 0; i < num_queries; ++i) {
+    bench->total_hits += bench->results[i].hit;
+  }
+
+  bench->total_ms += b2GetMilliseconds(&timer);
+}
+
+static void
+print_topology(void)
+{
+  CpuTopology topo;
+  cpu_get_topology(&topo);
+
+  printf("cpu: %u logical, %u cores (%u performance)%s%s\n", topo.num_logical,
+    topo.num_cores, topo.num_performance_cores, topo.has_smt ? ", smt" : "",
+    topo.is_hybrid ? ", hybrid" : "");
+
+  static const char *cache_types[] = { "", "i", "d" };
+  for (uint32_t i = 0; i < topo.num_caches; ++i) {
+    const CpuCache *cache = &topo.caches[i];
+    printf("  L%u%s: %u KB, %u B line, shared by %u\n", cache->level,
+      cache_types[cache->type], cache->size / 1024, cache->line_size,
+      cache->num_shared_logical);
+  }
+}
+
+static void
+rollback_bench_init(RollbackBench *bench, uint32_t num_frames)
+{
+  *bench = (RollbackBench){ .num_frames = num_frames };
+  if (num_frames == 0) return;
+
+  bench->states = M_ALLOC(num_frames * sizeof(uint8_t *));
+  bench->state_sizes = M_ALLOC(num_frames * sizeof(int32_t));
+  bench->state_capacities = M_ALLOC(num_frames * sizeof(int32_t));
+  bench->checksums = M_ALLOC(num_frames * sizeof(uint64_t));
+  memset(bench->states, 0, num_frames * sizeof(uint8_t *));
+  memset(bench->state_capacities, 0, num_frames * sizeof(int32_t));
+}
+
+static void
+rollback_bench_deinit(RollbackBench *bench)
+{
+  for (uint32_t i = 0; i < bench->num_frames; ++i) {
+    if (bench->states[i]) M_FREE(bench->states[i]);
+  }
+  if (bench->states) {
+    M_FREE(bench->states);
+    M_FREE(bench->state_sizes);
+    M_FREE(bench->state_capacities);
+    M_FREE(bench->checksums);
+  }
+  *bench = (RollbackBench){0};
+}
+
+static void
+save_rollback_state(PhyState *phy, RollbackBench *bench, uint32_t frame)
+{
+  b2Timer timer = b2CreateTimer();
+
+  int32_t size = b2World_GetStateSize(phy->world);
+  if (size > bench->state_capacities[frame]) {
+    // Some slack so a slowly growing world doesn't reallocate every step.
+    int32_t capacity = size + size / 4;
+    if (bench->states[frame]) M_FREE(bench->states[frame]);
+    bench->states[frame] = M_ALLOC((size_t)capacity);
+    bench->state_capacities[frame] = capacity;
+  }
+  bench->state_sizes[frame] = b2World_SaveState(phy->world,
+    bench->states[frame], bench->state_capacities[frame]);
+  assert(bench->state_sizes[frame] == size);
+  if (size > bench->max_state_size) bench->max_state_size = size;
+
+  bench->total_save_ms += b2GetMilliseconds(&timer);
+  bench->num_saves += 1;
+}
+
+// Restores the state saved before the first of the last `num_frames` steps
+// and steps again, every step has to reproduce its checksum.
+static void
+run_rollback(PhyState *phy, RollbackBench *bench, float time_step)
+{
+  b2Timer timer = b2CreateTimer();
+
+  bool ok = b2World_RestoreState(phy->world, bench->states[0],
+    bench->state_sizes[0]);
+  assert(ok);
+  (void)ok;
+
+  float restore_ms = b2GetMilliseconds(&timer);
+  bench->total_restore_ms += restore_ms;
+  if (restore_ms > bench->max_restore_ms) bench->max_restore_ms = restore_ms;
+  bench->num_rollbacks += 1;
+
+  // Replayed steps stay out of the step count and the stage profile, so
+  // those compare with runs without rollbacks.
+  timer = b2CreateTimer();
+  for (uint32_t frame = 0; frame < bench->num_frames; ++frame) {
+    phy_replay_step(phy, time_step, phy->num_substeps);
+    if (b2World_GetChecksum(phy->world) != bench->checksums[frame])
+      bench->num_mismatches += 1;
+  }
+  bench->total_replay_ms += b2GetMilliseconds(&timer);
+}
+
+// Wake-ups of workers since the stepping started, see `enkiGetWakeStats()`.
+static void
+print_wake_stats(enkiTaskScheduler *scheduler, uint32_t spin_us)
+{
+  struct enkiWakeStats s = enkiGetWakeStats(scheduler);
+  printf("worker sleeps/wakes: %llu/%llu  wake latency avg/max: "
+    "%.1f/%.1f us\n", (unsigned long long)s.numSuspends, (unsigned long long)s.numWakes,
+    s.numWakes > 0 ? (double)s.wakeLatencyTotalNs / s.numWakes / 1000.0 : 0.0,
+    (double)s.wakeLatencyMaxNs / 1000.0);
+  printf("spin window: %u us  tasks found spinning: %llu\n", spin_us,
+    (unsigned long long)s.numSpinWindowTasks);
+}
+
+static void
+print_report(PhyState *phy, const HeadlessArgs *args,
+  const QueryBench *bench, const RollbackBench *rollback, uint64_t checksum,
+  float total_ms)
+{
+  b2Counters c = b2World_GetCounters(phy->world);
+  ProfStats stats[PROF_NUM_STAGES];
+  prof_compute_stats(&phy->profile, stats);
+
+  print_topology();
+  printf("threads: %u%s\n", enkiGetNumTaskThreads(phy->scheduler),
+    args->pin_threads ? " (pinned)" : "");
+  printf("bodies/shapes/contacts/joints: %d/%d/%d/%d\n", c.bodyCount,
+    c.shapeCount, c.contactCount, c.jointCount);
+  printf("islands/tasks: %d/%d\n", c.islandCount, c.taskCount);
+
+  // The last color is the overflow.
+  int32_t num_colors = 0;
+  for (uint32_t i = 0; i + 1 < _countof(c.colorCounts); ++i)
+    num_colors += c.colorCounts[i] > 0;
+  printf("colors: %d  overflow contacts/joints: %d/%d (last step)\n",
+    num_colors, c.overflowContactCount, c.overflowJointCount);
+  printf("stack: %d K  worker arenas used/capacity: %d/%d K (last step)\n",
+    c.stackUsed / 1024, c.arenaUsed / 1024, c.arenaCapacity / 1024);
+  printf("simd: %s  trees: %s", simd_names[b2World_GetSIMDType(phy->world)],
+    args->narrow_trees ? "binary" : "4-wide");
+  if (args->grid_cell_size > 0.0f)
+    printf("  dynamic grid: %.2f m", args->grid_cell_size);
+  printf("\n");
+  printf("task pool last/max/capacity: %d/%d/%d\n", phy->num_step_tasks,
+    phy->max_step_tasks, phy->task_pool.capacity);
+  print_wake_stats(phy->scheduler, args->spin_us);
+  printf("steps: %d  substeps: %d  sleep: %s\n", phy->num_steps,
+    args->num_substeps, args->enable_sleep ? "on" : "off");
+  if (args->enable_checksum)
+    printf("checksum: %016llx\n", (unsigned long long)checksum);
+  printf("wall time: %.3f s\n", total_ms / 1000.0f);
+  // Saving, restoring and replaying for rollbacks isn't stepping time.
+  float step_ms = total_ms - rollback->total_save_ms -
+    rollback->total_restore_ms - rollback->total_replay_ms;
+  printf("steps/sec: %.1f\n",
+    step_ms > 0.0f ? 1000.0f * (float)phy->num_steps / step_ms : 0.0f);
+  if (args->num_queries > 0) {
+    float num_queries = 3.0f * (float)args->num_queries * (float)phy->num_steps;
+    printf("queries: %.0f  hits: %llu  queries/sec: %.0f\n", num_queries,
+      (unsigned long long)bench->total_hits,
+      bench->total_ms > 0.0f ? 1000.0f * num_queries / bench->total_ms : 0.0f);
+  }
+  if (rollback->num_rollbacks > 0) {
+    printf("rollbacks: %u x %u steps  mismatches: %u  state: %d KB\n",
+      rollback->num_rollbacks, rollback->num_frames, rollback->num_mismatches,
+      rollback->max_state_size / 1024);
+    printf("save avg: %.3f ms  restore avg/max: %.3f/%.3f ms\n",
+      rollback->total_save_ms / (float)rollback->num_saves,
+      rollback->total_restore_ms / (float)rollback->num_rollbacks,
+      rollback->max_restore_ms);
+    uint32_t num_replayed = rollback->num_rollbacks * rollback->num_frames;
+    printf("replayed steps: %u  replay steps/sec: %.1f\n", num_replayed,
+      rollback->total_replay_ms > 0.0f ?
+        1000.0f * (float)num_replayed / rollback->total_replay_ms : 0.0f);
+  }
+  printf("\n%-20s %10s %10s %10s %10s\n", "stage [ms]", "p50", "p95", "p99",
+    "max");
+
+  for (uint32_t i = 0; i < PROF_NUM_STAGES; ++i) {
+    const ProfStats *s = &stats[i];
+    printf("%-20s %10.3f %10.3f %10.3f %10.3f\n", prof_stages[i].name, s->p50,
+      s->p95, s->p99, s->max);
+  }
+}
+
+// Steps `num_worlds` copies of the default scene with `phy_group_step()` and
+// prints the aggregate throughput and the step time of every world.
+static int
+run_world_group(const HeadlessArgs *args)
+{
+  PhyInitArgs init_args = {
+    .num_threads = args->num_threads,
+    .pin_threads = args->pin_threads,
+    .enable_sleep = args->enable_sleep,
+    .num_substeps = args->num_substeps,
+    .profile_window = args->num_steps,
+    .simd_type = args->simd_type,
+    .enable_checksum = args->enable_checksum,
+    .narrow_trees = args->narrow_trees,
+    .grid_cell_size = args->grid_cell_size,
+    .spin_us = args->spin_us,
+  };
+
+  if (args->trace_filename) trace_init(0);
+
+  PhyWorldGroup group = {0};
+  phy_group_init(&group, &init_args);
+
+  ObjStore *objects = M_ALLOC(args->num_worlds * sizeof(ObjStore));
+  for (uint32_t i = 0; i < args->num_worlds; ++i) {
+    PhyGroupWorld *world = phy_group_create_world(&group, &init_args);
+    objects[i] = (ObjStore){0};
+    obj_store_init(&objects[i], args->num_bodies + 3);
+    create_scene(world->world, args->num_bodies, &objects[i]);
+  }
+
+  float time_step = 1.0f / PHY_DEFAULT_STEP_RATE;
+  float step_ms = args->step_rate > 0.0f ? 1000.0f / args->step_rate : 0.0f;
+  uint64_t checksum = 0xcbf29ce484222325ull;
+
+  enkiResetWakeStats(group.scheduler);
+  b2Timer total_timer = b2CreateTimer();
+
+  for (uint32_t i = 0; i < args->num_steps; ++i) {
+    b2Timer step_timer = b2CreateTimer();
+
+    phy_group_step(&group, time_step, args->num_substeps);
+    for (uint32_t w = 0; w < args->num_worlds; ++w) {
+      checksum = (checksum ^ b2World_GetChecksum(group.worlds[w]->world)) *
+        0x100000001b3ull;
+    }
+
+    if (step_ms > 0.0f) {
+      float remaining_ms = step_ms - b2GetMilliseconds(&step_timer);
+      if (remaining_ms >= 1.0f) b2SleepMilliseconds((int)remaining_ms);
+      while (b2GetMilliseconds(&step_timer) < step_ms) b2Yield();
+    }
+  }
+
+  float total_ms = b2GetMilliseconds(&total_timer);
+  float num_steps = (float)args->num_steps;
+
+  print_topology();
+  printf("threads: %u%s\n", enkiGetNumTaskThreads(group.scheduler),
+    args->pin_threads ? " (pinned)" : "");
+  printf("worlds: %u  bodies per world: %u  steps: %u  substeps: %d\n",
+    args->num_worlds, args->num_bodies, args->num_steps, args->num_substeps);
+  if (args->enable_checksum)
+    printf("checksum: %016llx\n", (unsigned long long)checksum);
+  printf("wall time: %.3f s\n", total_ms / 1000.0f);
+  printf("group steps/sec: %.1f  world steps/sec: %.1f\n",
+    total_ms > 0.0f ? 1000.0f * num_steps / total_ms : 0.0f,
+    total_ms > 0.0f ?
+      1000.0f * num_steps * (float)args->num_worlds / total_ms : 0.0f);
+  print_wake_stats(group.scheduler, args->spin_us);
+  printf("\n%-6s %10s %10s %10s %10s %10s %8s\n", "world", "contacts",
+    "step p50", "p95", "p99", "max", "tasks");
+
+  for (uint32_t w = 0; w < args->num_worlds; ++w) {
+    PhyGroupWorld *world = group.worlds[w];
+    b2Counters c = b2World_GetCounters(world->world);
+    ProfStats stats[PROF_NUM_STAGES];
+    prof_compute_stats(&world->profile, stats);
+
+    // Stage 0 is the whole step.
+    const ProfStats *s = &stats[0];
+    printf("%-6u %10d %10.3f %10.3f %10.3f %10.3f %8d\n", w, c.contactCount,
+      s->p50, s->p95, s->p99, s->max, world->max_step_tasks);
+  }
+
+  int result = 0;
+  if (args->trace_filename && !trace_export_json(args->trace_filename))
+    result = 1;
+
+  for (uint32_t i = 0; i < args->num_worlds; ++i) {
+    obj_store_deinit(&objects[i]);
+  }
+  M_FREE(objects);
+  phy_group_deinit(&group);
+  trace_deinit();
+  return result;
+}
+
+int
+main(int argc, char **argv)
+{
+  HeadlessArgs args = {
+    .num_bodies = 1000,
+    .num_steps = 1000,
+    .num_substeps = 1,
+    .enable_sleep = true,
+  };
+  if (!parse_args(argc, argv, &args)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (args.num_worlds > 0)
+    return run_world_group(&args);
+
+  // Before phy_init(), the scheduler reports its waits when tracing is on.
+  if (args.trace_filename) trace_init(0);
+
+  PhyState phy = {0};
+  phy_init(&phy,
+    &(PhyInitArgs){
+      .num_threads = args.num_threads,
+      .pin_threads = args.pin_threads,
+      .enable_sleep = args.enable_sleep,
+      .num_substeps = args.num_substeps,
+      .profile_window = args.num_steps,
+      .simd_type = args.simd_type,
+      .enable_checksum = args.enable_checksum || args.num_rollback > 0,
+      .narrow_trees = args.narrow_trees,
+      .grid_cell_size = args.grid_cell_size,
+      .spin_us = args.spin_us,
+    });
+
+  ObjStore objects = {0};
+  obj_store_init(&objects, args.num_bodies + 3);
+  float half_width;
+  if (args.scene_filename) {
+    b2Timer load_timer = b2CreateTimer();
+    // Objects are not drawn, their mesh and texture bindings don't matter.
+    if (!scn_load(args.scene_filename, NULL, phy.world, &objects)) {
+      obj_store_deinit(&objects);
+      phy_deinit(&phy);
+      trace_deinit();
+      return 1;
+    }
+    printf("scene: %u objects loaded from %s in %.3f ms\n",
+      obj_count(&objects), args.scene_filename,
+      b2GetMilliseconds(&load_timer));
+    half_width = scene_half_width(&objects);
+  } else {
+    half_width = create_scene(phy.world, args.num_bodies, &objects);
+  }
+
+  QueryBench bench;
+  query_bench_init(&bench, args.num_queries);
+
+  RollbackBench rollback;
+  rollback_bench_init(&rollback, args.num_rollback);
+
+  float time_step = 1.0f / phy.step_rate;
+  float step_ms = args.step_rate > 0.0f ? 1000.0f / args.step_rate : 0.0f;
+
+  // Step checksums folded in order (FNV-1a style), so a desync in any step
+  // changes the result.
+  uint64_t checksum = 0xcbf29ce484222325ull;
+
+  enkiResetWakeStats(phy.scheduler);
+  b2Timer total_timer = b2CreateTimer();
+
+  for (uint32_t i = 0; i < args.num_steps; ++i) {
+    b2Timer step_timer = b2CreateTimer();
+
+    if (args.num_churn > 0)
+      churn_scene(&phy, &objects, args.num_churn, half_width);
+
+    uint32_t frame = args.num_rollback > 0 ? i % args.num_rollback : 0;
+    if (args.num_rollback > 0) save_rollback_state(&phy, &rollback, frame);
+
+    phy_step(&phy, time_step, phy.num_substeps);
+    checksum = (checksum ^ b2World_GetChecksum(phy.world)) * 0x100000001b3ull;
+
+    if (args.num_rollback > 0) {
+      rollback.checksums[frame] = b2World_GetChecksum(phy.world);
+      if (frame == args.num_rollback - 1)
+        run_rollback(&phy, &rollback, time_step);
+    }
+    phy_sync_objects(&phy, &objects);
+    obj_clear_dirty(&objects);
+
+    if (args.num_queries > 0)
+      run_queries(&phy, &bench, args.num_queries, half_width);
+
+    if (step_ms > 0.0f) {
+      float remaining_ms = step_ms - b2GetMilliseconds(&step_timer);
+      if (remaining_ms >= 1.0f) b2SleepMilliseconds((int)remaining_ms);
+      while (b2GetMilliseconds(&step_timer) < step_ms) b2Yield();
+    }
+  }
+
+  print_report(&phy, &args, &bench, &rollback, checksum,
+    b2GetMilliseconds(&total_timer));
+
+  int result = 0;
+  if (args.csv_filename && !prof_export_csv(&phy.profile, args.csv_filename))
+    result = 1;
+  if (args.json_filename &&
+    !prof_export_json(&phy.profile, args.json_filename))
+    result = 1;
+  if (args.save_scene_filename &&
+    !scn_save(args.save_scene_filename, &objects))
+    result = 1;
+  if (args.trace_filename && !trace_export_json(args.trace_filename))
+    result = 1;
+
+  query_bench_deinit(&bench);
+  rollback_bench_deinit(&rollback);
+  obj_store_deinit(&objects);
+  phy_deinit(&phy);
+  trace_deinit();
+  return result;
+}
@@ -4,8 +4,14 @@
 #include "shaders.h"
 #include "gui.h"
 #include "audio.h"
-
-#define OBJ_MAX 1000
+#include "prof.h"
+#include "trace.h"
+#include "phy.h"
+#include "frame.h"
+#include "obj.h"
+#include "scn.h"
+
+#define OBJ_INITIAL_CAPACITY 1000
 #define OBJ_MAX_TEXTURES 64
 
 #define FONT_NORMAL 0
@@ -24,6 +30,7 @@
 #define MIN_WINDOW_SIZE 400
 
 #define WORLD_SIZE_Y 12.0f
+#define SCENE_FILENAME "scene.cgsc"
 
 typedef struct Mesh
 {
@@ -31,25 +38,36 @@ typedef struct Mesh
   uint32_t num_vertices;
 } Mesh;
 
-typedef struct PhyTask
+// What the GUI node shows, copied before the frame graph runs because the
+// physics node changes the world at the same time.
+typedef struct GameView
 {
-  enkiTaskSet *task_set;
-  b2TaskCallback *cb;
-  void *cb_context;
-} PhyTask;
-
-typedef struct PhyState
+  ProfStats phy_stats[PROF_NUM_STAGES];
+  float phy_samples[PROF_DEFAULT_WINDOW];
+  uint32_t phy_samples_num;
+  b2Counters phy_counters;
+  int32_t phy_num_dropped_steps;
+  int32_t phy_num_step_tasks;
+  int32_t phy_max_step_tasks;
+  int32_t phy_task_pool_capacity;
+  struct enkiWakeStats phy_wake_stats;
+} GameView;
+
+// Requested by the GUI node, applied by the main thread at the start of the
+// next frame when nothing else runs.
+typedef struct GameActions
 {
-  b2WorldId world;
-  b2Profile max_profile;
-  b2Profile total_profile;
-  int32_t num_steps;
-  b2JointId mouse_joint;
-  b2BodyId mouse_fixed_body;
-  enkiTaskScheduler *scheduler;
-  PhyTask tasks[64];
-  int32_t num_tasks;
-} PhyState;
+  bool reset_profile;
+  bool export_csv;
+  bool export_json;
+  bool export_trace;
+  bool save_scene;
+  bool load_scene;
+  uint32_t num_sounds;
+  float step_rate;
+  bool pipelined;
+  uint32_t spin_us;
+} GameActions;
 
 typedef struct GameState
 {
@@ -61,6 +79,7 @@ typedef struct GameState
   ID3D12PipelineState *pso[PSO_MAX];
   ID3D12Resource *vertex_buffer_static;
   ID3D12Resource *object_buffer;
+  uint32_t object_buffer_capacity;
   ID3D12Resource *object_textures[OBJ_MAX_TEXTURES];
   uint32_t object_textures_num;
   struct nk_font *fonts[FONT_MAX];
@@ -70,10 +89,19 @@ typedef struct GameState
   Mesh meshes[MESH_MAX];
   uint32_t meshes_num;
 
-  CgObject objects[OBJ_MAX];
-  uint32_t objects_num;
+  ObjStore objects;
 
   PhyState phy;
+  uint32_t phy_profile_stage; // stage shown in the profile sparkline
+
+  // Physics (with the transform sync) -> object upload, audio and GUI run
+  // concurrently on the physics scheduler.
+  FrameGraph frame_graph;
+  float frame_delta_time;
+  ID3D12GraphicsCommandList10 *frame_cmdlist; // upload node records into it
+  uint32_t num_queued_sounds; // played by the audio node
+  GameView view;
+  GameActions actions;
 } GameState;
 
 static_assert(sizeof(GameState) <= 128 * 1024);
@@ -138,44 +166,6 @@ m4x4_transpose(float4x4 m)
   m[3][3] = t[3][3];
 }
 
-static void
-phy_task_execute_range(uint32_t start_index, uint32_t end_index,
-  uint32_t worker_index, void *args)
-{
-  assert(args);
-  PhyTask *task = (PhyTask *)args;
-  task->cb(start_index, end_index, worker_index, task->cb_context);
-}
-
-static void *
-phy_enqueue_task(b2TaskCallback *cb, int32_t item_count, int32_t min_range,
-  void *cb_context, void *user_context)
-{
-  PhyState *phy = (PhyState *)user_context;
-  if (phy->num_tasks < _countof(phy->tasks)) {
-    PhyTask *task = &phy->tasks[phy->num_tasks++];
-    task->cb = cb;
-    task->cb_context = cb_context;
-    enkiAddTaskSetMinRange(phy->scheduler, task->task_set, task,
-      item_count, min_range);
-    return task;
-  } else {
-    assert(false && "increase size of GameState.phy.tasks array");
-    cb(0, item_count, 0, cb_context);
-    return NULL;
-  }
-}
-
-static void
-phy_finish_task(void *task_ptr, void *user_context)
-{
-  if (task_ptr != NULL) {
-    PhyTask *task = (PhyTask *)task_ptr;
-    PhyState *phy = (PhyState *)user_context;
-    enkiWaitForTaskSet(phy->scheduler, task->task_set);
-  }
-}
-
 static double
 get_time(void)
 {
@@ -265,6 +255,55 @@ screen_to_world_coords(float mx, float my, float w, float h)
   return (b2Vec2){ u * world_size_x, v * world_size_y };
 }
 
+static void
+game_destroy_object(GameState *game_state, ObjHandle handle)
+{
+  CgObject *object = obj_get(&game_state->objects, handle);
+  if (object == NULL) return;
+
+  b2BodyId body_id = *(b2BodyId *)&object->phy_body_id;
+  b2DestroyBody(body_id);
+  obj_destroy(&game_state->objects, handle);
+}
+
+static bool
+game_load_scene(GameState *game_state, const char *filename)
+{
+  PhyState *phy = &game_state->phy;
+  phy_wait(phy);
+
+  // Validate before anything is destroyed, a missing or bad file keeps the
+  // current scene.
+  ScnFile file;
+  ScnLimits limits = {
+    .num_meshes = game_state->meshes_num,
+    .invalid_mesh = MESH_INVALID,
+    .first_texture = RDH_OBJECT_TEX0,
+    .num_textures = game_state->object_textures_num,
+  };
+  if (!scn_open(&file, filename, &limits)) {
+    LOG("[game] Scene %s not loaded, keeping the current scene.", filename);
+    return false;
+  }
+
+  if (B2_IS_NON_NULL(phy->mouse_joint)) {
+    b2DestroyJoint(phy->mouse_joint);
+    b2DestroyBody(phy->mouse_fixed_body);
+    phy->mouse_joint = b2_nullJointId;
+    phy->mouse_fixed_body = b2_nullBodyId;
+  }
+
+  // Scene replaces every object, destroying a body destroys its joints too.
+  while (obj_count(&game_state->objects) > 0) {
+    uint32_t last = obj_count(&game_state->objects) - 1;
+    game_destroy_object(game_state, game_state->objects.handles[last]);
+  }
+
+  scn_create(&file, phy->world, &game_state->objects);
+  scn_close(&file);
+  return true;
+}
+
 static LRESULT CALLBACK
 window_handle_event(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
 {
@@ -334,12 +373,13 @@ window_handle_event(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
         overlap_any_query_callback, &query_context);
 
       if (B2_IS_NULL(query_context.body)) {
-        CgObject *object = &gs->objects[gs->objects_num++];
+        CgObject *object;
+        ObjHandle handle = obj_create(&gs->objects, &object);
 
         b2BodyDef body_def = b2DefaultBodyDef();
         body_def.type = b2_dynamicBody;
         body_def.position = p;
-        body_def.userData = object;
+        body_def.userData = obj_handle_to_ptr(handle);
         b2BodyId body_id = b2CreateBody(gs->phy.world, &body_def);
         b2CreatePolygonShape(body_id, &g_shape_def, &g_box1m);
 
@@ -349,6 +389,10 @@ window_handle_event(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
           .phy_body_id = *(uint64_t *)&body_id,
         };
         return 0;
+      } else if (b2Body_GetType(query_context.body) == b2_dynamicBody) {
+        game_destroy_object(gs,
+          obj_handle_from_ptr(b2Body_GetUserData(query_context.body)));
+        return 0;
       }
     } break;
     case WM_LBUTTONDOWN: {
@@ -448,6 +492,307 @@ load_mesh(const char *filename, uint32_t *points_num, CgVertex *points)
   CloseHandle(file);
 }
 
+static void
+create_object_buffer(GameState *game_state, uint32_t capacity)
+{
+  assert(game_state && game_state->object_buffer == NULL && capacity > 0);
+  GpuContext *gpu = &game_state->gpu_context;
+
+  VHR(ID3D12Device14_CreateCommittedResource3(gpu->device,
+    &(D3D12_HEAP_PROPERTIES){ .Type = D3D12_HEAP_TYPE_DEFAULT },
+    D3D12_HEAP_FLAG_NONE,
+    &(D3D12_RESOURCE_DESC1){
+      .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+      .Width = capacity * sizeof(CgObject),
+      .Height = 1,
+      .DepthOrArraySize = 1,
+      .MipLevels = 1,
+      .SampleDesc = { .Count = 1 },
+      .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+    },
+    D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL,
+    &IID_ID3D12Resource, &game_state->object_buffer));
+
+  ID3D12Device14_CreateShaderResourceView(gpu->device,
+    game_state->object_buffer,
+    &(D3D12_SHADER_RESOURCE_VIEW_DESC){
+      .ViewDimension = D3D12_SRV_DIMENSION_BUFFER,
+      .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+      .Buffer = {
+        .FirstElement = 0,
+        .NumElements = capacity,
+        .StructureByteStride = sizeof(CgObject),
+      },
+    },
+    (D3D12_CPU_DESCRIPTOR_HANDLE){
+      .ptr = gpu->shader_dheap_start_cpu.ptr + RDH_OBJECT_BUFFER
+        * gpu->shader_dheap_descriptor_size
+    });
+
+  game_state->object_buffer_capacity = capacity;
+}
+
+//
+// Frame graph nodes, they run on the physics scheduler's threads. Each node
+// touches only its own part of GameState, see `game_update()`.
+//
+
+static void
+frame_physics(void *context)
+{
+  GameState *game_state = (GameState *)context;
+  phy_update(&game_state->phy, &game_state->objects,
+    game_state->frame_delta_time);
+}
+
+// Upload only the range of objects that has changed since the last frame.
+static void
+frame_object_upload(void *context)
+{
+  GameState *game_state = (GameState *)context;
+  GpuContext *gpu = &game_state->gpu_context;
+  ID3D12GraphicsCommandList10 *cmdlist = game_state->frame_cmdlist;
+
+  ObjStore *objects = &game_state->objects;
+  if (objects->dirty_begin >= objects->dirty_end) return;
+
+  ID3D12GraphicsCommandList10_Barrier(cmdlist, 1,
+    &(D3D12_BARRIER_GROUP){
+      .Type = D3D12_BARRIER_TYPE_BUFFER,
+      .NumBarriers = 1,
+      .pBufferBarriers = &(D3D12_BUFFER_BARRIER){
+        .SyncBefore = D3D12_BARRIER_SYNC_NONE,
+        .SyncAfter = D3D12_BARRIER_SYNC_COPY,
+        .AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS,
+        .AccessAfter = D3D12_BARRIER_ACCESS_COPY_DEST,
+        .pResource = game_state->object_buffer,
+        .Size = UINT64_MAX,
+      },
+    });
+
+  uint32_t dirty_num = objects->dirty_end - objects->dirty_begin;
+
+  GpuUploadBufferRegion upload = gpu_alloc_upload_memory(gpu,
+    dirty_num * sizeof(CgObject));
+
+  memcpy(upload.cpu_addr, &objects->objects[objects->dirty_begin],
+    dirty_num * sizeof(CgObject));
+
+  ID3D12GraphicsCommandList10_CopyBufferRegion(cmdlist,
+    game_state->object_buffer, objects->dirty_begin * sizeof(CgObject),
+    upload.buffer, upload.buffer_offset, upload.size);
+
+  ID3D12GraphicsCommandList10_Barrier(cmdlist, 1,
+    &(D3D12_BARRIER_GROUP){
+      .Type = D3D12_BARRIER_TYPE_BUFFER,
+      .NumBarriers = 1,
+      .pBufferBarriers = &(D3D12_BUFFER_BARRIER){
+        .SyncBefore = D3D12_BARRIER_SYNC_COPY,
+        .SyncAfter = D3D12_BARRIER_SYNC_DRAW,
+        .AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST,
+        .AccessAfter = D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
+        .pResource = game_state->object_buffer,
+        .Size = UINT64_MAX,
+      },
+    });
+
+  obj_clear_dirty(objects);
+}
+
+static void
+frame_audio(void *context)
+{
+  GameState *game_state = (GameState *)context;
+
+  for (uint32_t i = 0; i < game_state->num_queued_sounds; ++i) {
+    aud_play_sound(&game_state->audio_context,
+      game_state->sounds[rand() % 2], NULL);
+  }
+  game_state->num_queued_sounds = 0;
+}
+
+static void
+frame_gui(void *context)
+{
+  GameState *game_state = (GameState *)context;
+  const GameView *view = &game_state->view;
+  GameActions *actions = &game_state->actions;
+
+  GuiContext *gui = &game_state->gui_context;
+  float dpi_scale = gui->dpi_scale_factor;
+  struct nk_context *nkctx = &gui->nkctx;
+
+  if (nk_begin(nkctx, "Statistics", nk_rect(10.0f * dpi_scale, 10.0f * dpi_scale,
+    dpi_scale * 350.0f, dpi_scale * 300.0f), NK_WINDOW_BORDER |
+    NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_MINIMIZABLE |
+    NK_WINDOW_TITLE))
+  {
+    if (nk_tree_push(nkctx, NK_TREE_TAB, "Physics counters", NK_MINIMIZED)) {
+      const b2Counters *s = &view->phy_counters;
+
+      nk_layout_row_dynamic(nkctx, FONT_NORMAL_HEIGHT * dpi_scale, 1);
+
+      nk_labelf(nkctx, NK_TEXT_LEFT,
+        "bodies/shapes/contacts/joints = %d/%d/%d/%d", s->bodyCount,
+        s->shapeCount, s->contactCount, s->jointCount);
+      nk_labelf(nkctx, NK_TEXT_LEFT, "islands/tasks = %d/%d", s->islandCount,
+        s->taskCount);
+      nk_labelf(nkctx, NK_TEXT_LEFT, "dropped steps = %d",
+        view->phy_num_dropped_steps);
+      nk_labelf(nkctx, NK_TEXT_LEFT, "task pool last/max/capacity = %d/%d/%d",
+        view->phy_num_step_tasks, view->phy_max_step_tasks,
+        view->phy_task_pool_capacity);
+      {
+        const struct enkiWakeStats *w = &view->phy_wake_stats;
+        nk_labelf(nkctx, NK_TEXT_LEFT,
+          "worker wakes = %llu, latency avg/max = %.0f/%.0f us",
+          (unsigned long long)w->numWakes, w->numWakes > 0 ?
+            (double)w->wakeLatencyTotalNs / w->numWakes / 1000.0 : 0.0,
+          (double)w->wakeLatencyMaxNs / 1000.0);
+      }
+      nk_labelf(nkctx, NK_TEXT_LEFT, "tree height static/movable = %d/%d",
+        s->staticTreeHeight, s->treeHeight);
+      nk_labelf(nkctx, NK_TEXT_LEFT, "stack allocator size = %d K",
+        s->stackUsed / 1024);
+      nk_labelf(nkctx, NK_TEXT_LEFT, "worker arenas used/capacity = %d/%d K",
+        s->arenaUsed / 1024, s->arenaCapacity / 1024);
+      nk_labelf(nkctx, NK_TEXT_LEFT, "total allocation = %d K",
+        s->byteCount / 1024);
+
+      nk_tree_pop(nkctx);
+    }
+
+    if (nk_tree_push(nkctx, NK_TREE_TAB, "Physics profile", NK_MINIMIZED)) {
+      static const float columns[] = {
+        0.32f, 0.136f, 0.136f, 0.136f, 0.136f, 0.136f,
+      };
+      nk_layout_row(nkctx, NK_DYNAMIC, FONT_NORMAL_HEIGHT * dpi_scale,
+        (int)_countof(columns), columns);
+
+      nk_label(nkctx, "stage [ms]", NK_TEXT_LEFT);
+      nk_label(nkctx, "last", NK_TEXT_RIGHT);
+      nk_label(nkctx, "p50", NK_TEXT_RIGHT);
+      nk_label(nkctx, "p95", NK_TEXT_RIGHT);
+      nk_label(nkctx, "p99", NK_TEXT_RIGHT);
+      nk_label(nkctx, "max", NK_TEXT_RIGHT);
+
+      for (uint32_t i = 0; i < PROF_NUM_STAGES; ++i) {
+        const ProfStats *s = &view->phy_stats[i];
+        bool selected = game_state->phy_profile_stage == i;
+
+        if (nk_selectable_label(nkctx, prof_stages[i].name, NK_TEXT_LEFT,
+          &selected) && selected)
+        {
+          game_state->phy_profile_stage = i;
+        }
+        nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f", s->last);
+        nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f", s->p50);
+        nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f", s->p95);
+        nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f", s->p99);
+        nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f", s->max);
+      }
+
+      // Sparkline of the selected stage over the window.
+      nk_layout_row_dynamic(nkctx, 4.0f * FONT_NORMAL_HEIGHT * dpi_scale, 1);
+      float chart_max = view->phy_stats[game_state->phy_profile_stage].max;
+      if (nk_chart_begin(nkctx, NK_CHART_LINES, (int)view->phy_samples_num,
+        0.0f, chart_max > 0.0f ? chart_max : 1.0f))
+      {
+        for (uint32_t i = 0; i < view->phy_samples_num; ++i) {
+          nk_chart_push(nkctx, view->phy_samples[i]);
+        }
+        nk_chart_end(nkctx);
+      }
+
+      nk_layout_row_dynamic(nkctx, 10.0f * dpi_scale, 1);
+      nk_layout_row_dynamic(nkctx, 0.0f, 1);
+      if (nk_button_label(nkctx, "Reset profile")) {
+        actions->reset_profile = true;
+      }
+      nk_layout_row_dynamic(nkctx, 0.0f, 2);
+      if (nk_button_label(nkctx, "Export CSV")) {
+        actions->export_csv = true;
+      }
+      if (nk_button_label(nkctx, "Export JSON")) {
+        actions->export_json = true;
+      }
+      nk_layout_row_dynamic(nkctx, 0.0f, 1);
+      if (nk_button_label(nkctx, "Export trace")) {
+        actions->export_trace = true;
+      }
+      nk_tree_pop(nkctx);
+    }
+
+    // Times of the previous frame, `frame_graph_run()` doesn't write them
+    // until every node is done.
+    if (nk_tree_push(nkctx, NK_TREE_TAB, "Frame graph", NK_MINIMIZED)) {
+      const FrameGraph *fg = &game_state->frame_graph;
+
+      nk_layout_row_dynamic(nkctx, FONT_NORMAL_HEIGHT * dpi_scale, 2);
+      for (uint32_t i = 0; i < fg->num_nodes; ++i) {
+        bool critical = false;
+        for (uint32_t j = 0; j < fg->critical_path_len; ++j) {
+          if (fg->critical_path[j] == i) critical = true;
+        }
+        nk_labelf(nkctx, NK_TEXT_LEFT, "%s%s", fg->nodes[i].name,
+          critical ? " *" : "");
+        nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f ms", fg->node_ms[i]);
+      }
+      nk_label(nkctx, "critical path (*)", NK_TEXT_LEFT);
+      nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f ms", fg->critical_ms);
+      nk_label(nkctx, "graph", NK_TEXT_LEFT);
+      nk_labelf(nkctx, NK_TEXT_RIGHT, "%.2f ms", fg->frame_ms);
+
+      nk_tree_pop(nkctx);
+    }
+
+    nk_layout_row_dynamic(nkctx, 0.0f, 2);
+    if (nk_button_label(nkctx, "Save scene")) {
+      actions->save_scene = true;
+    }
+    if (nk_button_label(nkctx, "Load scene")) {
+      actions->load_scene = true;
+    }
+
+    nk_layout_row_dynamic(nkctx, 0.0f, 1);
+    {
+      int step_rate = (int)actions->step_rate;
+      nk_property_int(nkctx, "Physics step rate [Hz]:", 30, &step_rate, 240,
+        10, 1.0f);
+      actions->step_rate = (float)step_rate;
+    }
+    nk_checkbox_label(nkctx, "Pipelined physics", &actions->pipelined);
+    {
+      // Workers spin through the gaps between the task bursts of a step
+      // instead of sleeping, more power for less step latency.
+      int spin_us = (int)actions->spin_us;
+      nk_property_int(nkctx, "Worker spin [us]:", 0, &spin_us, 2000, 50,
+        10.0f);
+      actions->spin_us = (uint32_t)spin_us;
+    }
+
+    if (nk_button_label(nkctx, "Play test sound")) {
+      actions->num_sounds += 1;
+    }
+  }
+  nk_end(nkctx);
+}
+
+static void
+game_init_frame_graph(GameState *game_state)
+{
+  FrameGraph *fg = &game_state->frame_graph;
+  frame_graph_init(fg, game_state->phy.scheduler);
+
+  uint32_t physics = frame_graph_add(fg, "physics", frame_physics, game_state);
+  uint32_t upload = frame_graph_add(fg, "object upload", frame_object_upload,
+    game_state);
+  frame_graph_add(fg, "audio", frame_audio, game_state);
+  frame_graph_add(fg, "gui", frame_gui, game_state);
+
+  frame_graph_depend(fg, upload, physics);
+}
+
 static void
 game_init(GameState *game_state)
 {
@@ -606,36 +951,7 @@ game_init(GameState *game_state)
   //
   // Object buffer (dynamic)
   //
-  VHR(ID3D12Device14_CreateCommittedResource3(gpu->device,
-    &(D3D12_HEAP_PROPERTIES){ .Type = D3D12_HEAP_TYPE_DEFAULT },
-    D3D12_HEAP_FLAG_NONE,
-    &(D3D12_RESOURCE_DESC1){
-      .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-      .Width = OBJ_MAX * sizeof(CgObject),
-      .Height = 1,
-      .DepthOrArraySize = 1,
-      .MipLevels = 1,
-      .SampleDesc = { .Count = 1 },
-      .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-    },
-    D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL,
-    &IID_ID3D12Resource, &game_state->object_buffer));
-
-  ID3D12Device14_CreateShaderResourceView(gpu->device,
-    game_state->object_buffer,
-    &(D3D12_SHADER_RESOURCE_VIEW_DESC){
-      .ViewDimension = D3D12_SRV_DIMENSION_BUFFER,
-      .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-      .Buffer = {
-        .FirstElement = 0,
-        .NumElements = OBJ_MAX,
-        .StructureByteStride = sizeof(CgObject),
-      },
-    },
-    (D3D12_CPU_DESCRIPTOR_HANDLE){
-      .ptr = gpu->shader_dheap_start_cpu.ptr + RDH_OBJECT_BUFFER
-        * gpu->shader_dheap_descriptor_size
-    });
+  create_object_buffer(game_state, OBJ_INITIAL_CAPACITY);
 
   //
   // Static geometry buffer
@@ -765,44 +1081,33 @@ game_init(GameState *game_state)
 
   PhyState *phy = &game_state->phy;
 
-  phy->scheduler = enkiNewTaskScheduler();
-  {
-    SYSTEM_INFO info;
-    GetSystemInfo(&info);
-    // TODO: Get number of physical, performance cores.
-    enkiInitTaskSchedulerNumThreads(phy->scheduler,
-      info.dwNumberOfProcessors / 2);
-  }
-
-  for (uint32_t i = 0; i < _countof(phy->tasks); ++i) {
-    phy->tasks[i].task_set = enkiCreateTaskSet(phy->scheduler,
-      phy_task_execute_range);
-  }
-
   //
   // Objects
   //
-  {
-    b2WorldDef world_def = b2DefaultWorldDef();
-    world_def.workerCount = enkiGetNumTaskThreads(phy->scheduler);
-    world_def.enqueueTask = phy_enqueue_task;
-    world_def.finishTask = phy_finish_task;
-    world_def.userTaskContext = phy;
-    world_def.enableSleep = true;
-    phy->world = b2CreateWorld(&world_def);
-  }
+  // Before phy_init(), the scheduler reports its waits when tracing is on.
+  trace_init(0);
+  phy_init(phy, &(PhyInitArgs){ .enable_sleep = true });
+  obj_store_init(&game_state->objects, OBJ_INITIAL_CAPACITY);
+
+  game_init_frame_graph(game_state);
+  game_state->actions = (GameActions){
+    .step_rate = phy->step_rate,
+    .pipelined = phy->pipelined,
+    .spin_us = phy_get_spin(phy),
+  };
 
   g_box1m = b2MakeBox(0.5f, 0.5f);
   g_shape_def = b2DefaultShapeDef();
 
   {
-    CgObject *object = &game_state->objects[game_state->objects_num++];
+    CgObject *object;
+    ObjHandle handle = obj_create(&game_state->objects, &object);
 
     b2BodyDef body_def = b2DefaultBodyDef();
     body_def.type = b2_staticBody;
     body_def.position = (b2Vec2){ 0.0f, 0.0f };
     body_def.rotation = (b2Rot){ cosf(0.0f), sinf(0.0f) };
-    body_def.userData = object;
+    body_def.userData = obj_handle_to_ptr(handle);
     b2BodyId body_id = b2CreateBody(phy->world, &body_def);
     b2CreatePolygonShape(body_id, &g_shape_def, &g_box1m);
 
@@ -813,13 +1118,14 @@ game_init(GameState *game_state)
     };
   }
   {
-    CgObject *object = &game_state->objects[game_state->objects_num++];
+    CgObject *object;
+    ObjHandle handle = obj_create(&game_state->objects, &object);
 
     b2BodyDef body_def = b2DefaultBodyDef();
     body_def.type = b2_dynamicBody;
     body_def.position = (b2Vec2){ 0.25f, 6.0f };
     body_def.rotation = (b2Rot){ cosf(0.5f), sinf(0.5f) };
-    body_def.userData = object;
+    body_def.userData = obj_handle_to_ptr(handle);
     b2BodyId body_id = b2CreateBody(phy->world, &body_def);
     b2CreateCircleShape(body_id, &g_shape_def, &(b2Circle){ .radius = 0.5f });
 
@@ -830,12 +1136,13 @@ game_init(GameState *game_state)
     };
   }
   {
-    CgObject *object = &game_state->objects[game_state->objects_num++];
+    CgObject *object;
+    ObjHandle handle = obj_create(&game_state->objects, &object);
 
     b2BodyDef body_def = b2DefaultBodyDef();
     body_def.type = b2_staticBody;
     body_def.position = (b2Vec2){ 0.0f, -WORLD_SIZE_Y * 0.5f - 0.5f };
-    body_def.userData = object;
+    body_def.userData = obj_handle_to_ptr(handle);
     b2BodyId body_id = b2CreateBody(phy->world, &body_def);
 
     b2Polygon ground = b2MakeBox(WORLD_SIZE_Y * 2, 0.5f);
@@ -848,12 +1155,13 @@ game_init(GameState *game_state)
     };
   }
   {
-    CgObject *object = &game_state->objects[game_state->objects_num++];
+    CgObject *object;
+    ObjHandle handle = obj_create(&game_state->objects, &object);
 
     b2BodyDef body_def = b2DefaultBodyDef();
     body_def.type = b2_staticBody;
     body_def.position = (b2Vec2){ 0.0f, WORLD_SIZE_Y * 0.5f + 0.5f };
-    body_def.userData = object;
+    body_def.userData = obj_handle_to_ptr(handle);
     b2BodyId body_id = b2CreateBody(phy->world, &body_def);
 
     b2Polygon ground = b2MakeBox(WORLD_SIZE_Y * 2, 0.5f);
@@ -870,13 +1178,14 @@ game_init(GameState *game_state)
     for (int32_t sign = -1; sign < 2; ++sign) {
       if (sign == 0) continue;
 
-      CgObject *object = &game_state->objects[game_state->objects_num++];
+      CgObject *object;
+      ObjHandle handle = obj_create(&game_state->objects, &object);
 
       b2BodyDef body_def = b2DefaultBodyDef();
       body_def.type = b2_staticBody;
       body_def.position = (b2Vec2){ sign * WORLD_SIZE_Y * 0.75f,
         i * 1.1f };
-      body_def.userData = object;
+      body_def.userData = obj_handle_to_ptr(handle);
       b2BodyId body_id = b2CreateBody(phy->world, &body_def);
       b2CreatePolygonShape(body_id, &g_shape_def, &g_box1m);
 
@@ -891,13 +1200,14 @@ game_init(GameState *game_state)
     for (int32_t sign = -1; sign < 2; ++sign) {
       if (sign == 0) continue;
 
-      CgObject *object = &game_state->objects[game_state->objects_num++];
+      CgObject *object;
+      ObjHandle handle = obj_create(&game_state->objects, &object);
 
       b2BodyDef body_def = b2DefaultBodyDef();
       body_def.type = b2_staticBody;
       body_def.position = (b2Vec2){ sign * WORLD_SIZE_Y * 0.75f,
         -i * 1.1f };
-      body_def.userData = object;
+      body_def.userData = obj_handle_to_ptr(handle);
       b2BodyId body_id = b2CreateBody(phy->world, &body_def);
       b2CreatePolygonShape(body_id, &g_shape_def, &g_box1m);
 
@@ -916,18 +1226,12 @@ game_deinit(GameState *game_state)
   GpuContext *gpu = &game_state->gpu_context;
 
   gpu_wait_for_completion(gpu);
+  phy_wait(&game_state->phy);
 
-  b2DestroyWorld(game_state->phy.world);
-
-  if (game_state->phy.scheduler) {
-    for (uint32_t i = 0; i < _countof(game_state->phy.tasks); ++i) {
-      if (game_state->phy.tasks[i].task_set) {
-        enkiDeleteTaskSet(
-          game_state->phy.scheduler, game_state->phy.tasks[i].task_set);
-      }
-    }
-    enkiDeleteTaskScheduler(game_state->phy.scheduler);
-  }
+  frame_graph_deinit(&game_state->frame_graph);
+  phy_deinit(&game_state->phy);
+  trace_deinit();
+  obj_store_deinit(&game_state->objects);
 
   gui_deinit(&game_state->gui_context);
 
@@ -946,27 +1250,91 @@ game_deinit(GameState *game_state)
   gpu_deinit_context(gpu);
 }
 
+static void
+game_apply_actions(GameState *game_state)
+{
+  GameActions *actions = &game_state->actions;
+  PhyState *phy = &game_state->phy;
+
+  // The main loop waited for the physics step, exports and scene changes
+  // can't race with it.
+  if (actions->reset_profile) {
+    phy_reset_profile(phy);
+    enkiResetWakeStats(phy->scheduler);
+  }
+  if (actions->export_csv)
+    prof_export_csv(&phy->profile, "physics_profile.csv");
+  if (actions->export_json)
+    prof_export_json(&phy->profile, "physics_profile.json");
+  if (actions->export_trace)
+    trace_export_json("physics_trace.json");
+  if (actions->save_scene)
+    scn_save(SCENE_FILENAME, &game_state->objects);
+  if (actions->load_scene)
+    game_load_scene(game_state, SCENE_FILENAME);
+
+  phy->step_rate = actions->step_rate;
+  phy->pipelined = actions->pipelined;
+  phy_set_spin(phy, actions->spin_us);
+  game_state->num_queued_sounds += actions->num_sounds;
+
+  *actions = (GameActions){
+    .step_rate = phy->step_rate,
+    .pipelined = phy->pipelined,
+    .spin_us = phy_get_spin(phy),
+  };
+}
+
+static void
+game_grow_object_buffer(GameState *game_state)
+{
+  GpuContext *gpu = &game_state->gpu_context;
+  uint32_t objects_num = obj_count(&game_state->objects);
+
+  // Grow the object buffer when the store outgrows it. This is rare so we
+  // simply wait for the GPU to stop using the old buffer.
+  if (objects_num > game_state->object_buffer_capacity) {
+    uint32_t capacity = game_state->object_buffer_capacity * 2;
+    while (capacity < objects_num) capacity *= 2;
+
+    gpu_wait_for_completion(gpu);
+    SAFE_RELEASE(game_state->object_buffer);
+    create_object_buffer(game_state, capacity);
+    obj_mark_all_dirty(&game_state->objects);
+  }
+}
+
 static bool
 game_update(GameState *game_state)
 {
   GpuContext *gpu = &game_state->gpu_context;
 
-  b2World_Step(game_state->phy.world, 1.0f / 60.0f, 1);
-  game_state->phy.num_tasks = 0;
-  game_state->phy.num_steps += 1;
+  float delta_time = window_update_frame_stats(gpu->window, game_state->name);
 
-  for (uint32_t i = 0; i < game_state->objects_num; ++i) {
-    b2BodyId body_id = *(b2BodyId *)&game_state->objects[i].phy_body_id;
-    b2Transform t = b2Body_GetTransform(body_id);
-    memcpy(&game_state->objects[i], &t, sizeof(t));
-  }
+  game_apply_actions(game_state);
+
+  // With pipelined physics the world is stepped on worker threads while we
+  // build and render this frame, read everything we show first.
+  GameView *view = &game_state->view;
+  prof_compute_stats(&game_state->phy.profile, view->phy_stats);
+
+  view->phy_samples_num = prof_copy_samples(&game_state->phy.profile,
+    game_state->phy_profile_stage, view->phy_samples,
+    (uint32_t)_countof(view->phy_samples));
 
-  window_update_frame_stats(gpu->window, game_state->name);
+  view->phy_counters = b2World_GetCounters(game_state->phy.world);
+  view->phy_num_dropped_steps = game_state->phy.num_dropped_steps;
+  view->phy_num_step_tasks = game_state->phy.num_step_tasks;
+  view->phy_max_step_tasks = game_state->phy.max_step_tasks;
+  view->phy_task_pool_capacity = game_state->phy.task_pool.capacity;
+  view->phy_wake_stats = enkiGetWakeStats(game_state->phy.scheduler);
 
   GpuContextState gpu_ctx_state = gpu_update_context(gpu);
 
-  if (gpu_ctx_state == GpuContextState_WindowMinimized)
+  if (gpu_ctx_state == GpuContextState_WindowMinimized) {
+    phy_update(&game_state->phy, &game_state->objects, delta_time);
     return false;
+  }
 
   if (gpu_ctx_state == GpuContextState_WindowResized) {
 
@@ -974,157 +1342,13 @@ game_update(GameState *game_state)
     // TODO:
   }
 
-  GuiContext *gui = &game_state->gui_context;
-  float dpi_scale = gui->dpi_scale_factor;
-  struct nk_context *nkctx = &gui->nkctx;
-
-  b2Profile phy_avg_profile = {0};
-  b2Profile phy_profile = b2World_GetProfile(game_state->phy.world);
-  {
-    const b2Profile *p = &phy_profile;
-    b2Profile *mp = &game_state->phy.max_profile;
-
-    mp->step = b2MaxFloat(mp->step, p->step);
-    mp->pairs = b2MaxFloat(mp->pairs, p->pairs);
-    mp->collide = b2MaxFloat(mp->collide, p->collide);
-    mp->solve = b2MaxFloat(mp->solve, p->solve);
-    mp->buildIslands = b2MaxFloat(mp->buildIslands, p->buildIslands);
-    mp->solveConstraints = b2MaxFloat(mp->solveConstraints, p->solveConstraints);
-    mp->prepareTasks = b2MaxFloat(mp->prepareTasks, p->prepareTasks);
-    mp->solverTasks = b2MaxFloat(mp->solverTasks, p->solverTasks);
-    mp->prepareConstraints = b2MaxFloat(mp->prepareConstraints,
-      p->prepareConstraints);
-    mp->integrateVelocities = b2MaxFloat(mp->integrateVelocities,
-      p->integrateVelocities);
-    mp->warmStart = b2MaxFloat(mp->warmStart, p->warmStart);
-    mp->solveVelocities = b2MaxFloat(mp->solveVelocities, p->solveVelocities);
-    mp->integratePositions = b2MaxFloat(mp->integratePositions,
-      p->integratePositions);
-    mp->relaxVelocities = b2MaxFloat(mp->relaxVelocities, p->relaxVelocities);
-    mp->applyRestitution = b2MaxFloat(mp->applyRestitution, p->applyRestitution);
-    mp->storeImpulses = b2MaxFloat(mp->storeImpulses, p->storeImpulses);
-    mp->finalizeBodies = b2MaxFloat(mp->finalizeBodies, p->finalizeBodies);
-    mp->sleepIslands = b2MaxFloat(mp->sleepIslands, p->sleepIslands);
-    mp->splitIslands = b2MaxFloat(mp->splitIslands, p->splitIslands);
-    mp->hitEvents = b2MaxFloat(mp->hitEvents, p->hitEvents);
-    mp->broadphase = b2MaxFloat(mp->broadphase, p->broadphase);
-    mp->continuous = b2MaxFloat(mp->continuous, p->continuous);
-
-    b2Profile *tp = &game_state->phy.total_profile;
-    tp->step += p->step;
-    tp->pairs += p->pairs;
-    tp->collide += p->collide;
-    tp->solve += p->solve;
-    tp->buildIslands += p->buildIslands;
-    tp->solveConstraints += p->solveConstraints;
-    tp->prepareTasks += p->prepareTasks;
-    tp->solverTasks += p->solverTasks;
-    tp->prepareConstraints += p->prepareConstraints;
-    tp->integrateVelocities += p->integrateVelocities;
-    tp->warmStart += p->warmStart;
-    tp->solveVelocities += p->solveVelocities;
-    tp->integratePositions += p->integratePositions;
-    tp->relaxVelocities += p->relaxVelocities;
-    tp->applyRestitution += p->applyRestitution;
-    tp->storeImpulses += p->storeImpulses;
-    tp->finalizeBodies += p->finalizeBodies;
-    tp->sleepIslands += p->sleepIslands;
-    tp->splitIslands += p->splitIslands;
-    tp->hitEvents += p->hitEvents;
-    tp->broadphase += p->broadphase;
-    tp->continuous += p->continuous;
-
-    b2Profile *ap = &phy_avg_profile;
-    if (game_state->phy.num_steps > 0) {
-      float scale = 1.0f / game_state->phy.num_steps;
-
-      ap->step = scale * tp->step;
-      ap->pairs = scale * tp->pairs;
-      ap->collide = scale * tp->collide;
-      ap->solve = scale * tp->solve;
-      ap->buildIslands = scale * tp->buildIslands;
-      ap->solveConstraints = scale * tp->solveConstraints;
-      ap->prepareTasks = scale * tp->prepareTasks;
-      ap->solverTasks = scale * tp->solverTasks;
-      ap->prepareConstraints = scale * tp->prepareConstraints;
-      ap->integrateVelocities = scale * tp->integrateVelocities;
-      ap->warmStart = scale * tp->warmStart;
-      ap->solveVelocities = scale * tp->solveVelocities;
-      ap->integratePositions = scale * tp->integratePositions;
-      ap->relaxVelocities = scale * tp->relaxVelocities;
-      ap->applyRestitution = scale * tp->applyRestitution;
-      ap->storeImpulses = scale * tp->storeImpulses;
-      ap->finalizeBodies = scale * tp->finalizeBodies;
-      ap->sleepIslands = scale * tp->sleepIslands;
-      ap->splitIslands = scale * tp->splitIslands;
-      ap->hitEvents = scale * tp->hitEvents;
-      ap->broadphase = scale * tp->broadphase;
-      ap->continuous = scale * tp->continuous;
-    }
-  }
-
-  if (nk_begin(nkctx, "Statistics", nk_rect(10.0f * dpi_scale, 10.0f * dpi_scale,
-    dpi_scale * 350.0f, dpi_scale * 300.0f), NK_WINDOW_BORDER |
-    NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_MINIMIZABLE |
-    NK_WINDOW_TITLE))
-  {
-    if (nk_tree_push(nkctx, NK_TREE_TAB, "Physics counters", NK_MINIMIZED)) {
-      b2Counters s = b2World_GetCounters(game_state->phy.world);
-
-      nk_layout_row_dynamic(nkctx, FONT_NORMAL_HEIGHT * dpi_scale, 1);
-
-      nk_labelf(nkctx, NK_TEXT_LEFT,
-        "bodies/shapes/contacts/joints = %d/%d/%d/%d", s.bodyCount,
-        s.shapeCount, s.contactCount, s.jointCount);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "islands/tasks = %d/%d", s.islandCount,
-        s.taskCount);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "tree height static/movable = %d/%d",
-        s.staticTreeHeight, s.treeHeight);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "stack allocator size = %d K",
-        s.stackUsed / 1024);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "total allocation = %d K",
-        s.byteCount / 1024);
-
-      nk_tree_pop(nkctx);
-    }
-
-    if (nk_tree_push(nkctx, NK_TREE_TAB, "Physics profile", NK_MINIMIZED)) {
-      nk_layout_row_dynamic(nkctx, FONT_NORMAL_HEIGHT * dpi_scale, 1);
+  // Waits for the GPU, it can't run while a command list is recorded.
+  game_grow_object_buffer(game_state);
 
-      const b2Profile *p = &phy_profile;
-      const b2Profile *ap = &phy_avg_profile;
-      const b2Profile *mp = &game_state->phy.max_profile;
-
-      nk_labelf(nkctx, NK_TEXT_LEFT, "step [avg] (max) = %.2f [%.2f] (%.2f)",
-        p->step, ap->step, mp->step);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "pairs [avg] (max) = %.2f [%.2f] (%.2f)",
-        p->pairs, ap->pairs, mp->pairs);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "collide [avg] (max) = %.2f [%.2f] (%.2f)",
-        p->collide, ap->collide, mp->collide);
-      nk_labelf(nkctx, NK_TEXT_LEFT, "solve [avg] (max) = %.2f [%.2f] (%.2f)",
-        p->solve, ap->solve, mp->solve);
-      nk_labelf(nkctx, NK_TEXT_LEFT,
-        "builds island [avg] (max) = %.2f [%.2f] (%.2f)", p->buildIslands,
-        ap->buildIslands, mp->buildIslands);
-
-      // TODO: Add all the rest.
-
-      nk_layout_row_dynamic(nkctx, 10.0f * dpi_scale, 1);
-      nk_layout_row_dynamic(nkctx, 0.0f, 1);
-      if (nk_button_label(nkctx, "Reset profile")) {
-        game_state->phy.total_profile = (b2Profile){0};
-        game_state->phy.max_profile = (b2Profile){0};
-        game_state->phy.num_steps = 0;
-      }
-      nk_tree_pop(nkctx);
-    }
+  game_state->frame_delta_time = delta_time;
+  game_state->frame_cmdlist = gpu_begin_command_list(gpu);
 
-    if (nk_button_label(nkctx, "Play test sound")) {
-      aud_play_sound(&game_state->audio_context,
-        game_state->sounds[rand() % 2], NULL);
-    }
-  }
-  nk_end(nkctx);
+  frame_graph_run(&game_state->frame_graph);
 
   return true;
 }
@@ -1133,47 +1357,11 @@ static void
 game_draw(GameState *game_state)
 {
   GpuContext *gpu = &game_state->gpu_context;
-  ID3D12GraphicsCommandList10 *cmdlist = gpu_begin_command_list(gpu);
-
-  {
-    ID3D12GraphicsCommandList10_Barrier(cmdlist, 1,
-      &(D3D12_BARRIER_GROUP){
-        .Type = D3D12_BARRIER_TYPE_BUFFER,
-        .NumBarriers = 1,
-        .pBufferBarriers = &(D3D12_BUFFER_BARRIER){
-          .SyncBefore = D3D12_BARRIER_SYNC_NONE,
-          .SyncAfter = D3D12_BARRIER_SYNC_COPY,
-          .AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS,
-          .AccessAfter = D3D12_BARRIER_ACCESS_COPY_DEST,
-          .pResource = game_state->object_buffer,
-          .Size = UINT64_MAX,
-        },
-      });
+  uint32_t objects_num = obj_count(&game_state->objects);
 
-    GpuUploadBufferRegion upload = gpu_alloc_upload_memory(gpu,
-      game_state->objects_num * sizeof(CgObject));
-
-    memcpy(upload.cpu_addr, &game_state->objects[0], game_state->objects_num *
-      sizeof(CgObject));
-
-    ID3D12GraphicsCommandList10_CopyBufferRegion(cmdlist,
-      game_state->object_buffer, 0, upload.buffer, upload.buffer_offset,
-      upload.size);
-
-    ID3D12GraphicsCommandList10_Barrier(cmdlist, 1,
-      &(D3D12_BARRIER_GROUP){
-        .Type = D3D12_BARRIER_TYPE_BUFFER,
-        .NumBarriers = 1,
-        .pBufferBarriers = &(D3D12_BUFFER_BARRIER){
-          .SyncBefore = D3D12_BARRIER_SYNC_COPY,
-          .SyncAfter = D3D12_BARRIER_SYNC_DRAW,
-          .AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST,
-          .AccessAfter = D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
-          .pResource = game_state->object_buffer,
-          .Size = UINT64_MAX,
-        },
-      });
-  }
+  // Begun by `game_update()`, the upload node recorded the object copy.
+  ID3D12GraphicsCommandList10 *cmdlist = game_state->frame_cmdlist;
+  game_state->frame_cmdlist = NULL;
 
   ID3D12GraphicsCommandList10_OMSetRenderTargets(cmdlist, 1,
     &gpu->color_target_descriptor, TRUE, &gpu->ds_target_descriptor);
@@ -1207,8 +1395,8 @@ game_draw(GameState *game_state)
       upload.gpu_addr);
   }
 
-  for (uint32_t i = 0; i < game_state->objects_num; ++i) {
-    CgObject *obj = &game_state->objects[i];
+  for (uint32_t i = 0; i < objects_num; ++i) {
+    CgObject *obj = &game_state->objects.objects[i];
     if (obj->mesh_index == MESH_INVALID) continue;
     Mesh *mesh = &game_state->meshes[obj->mesh_index];
 
@@ -1248,6 +1436,9 @@ main(void)
   bool running = true;
 
   while (running) {
+    // Window events modify the physics world, it must not be stepping.
+    phy_wait(&game_state.phy);
+
     MSG msg = {0};
     nk_input_begin(&game_state.gui_context.nkctx);
     while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "obj.h"
+#include "cpu_gpu_common.h"
+
+void
+obj_store_init(ObjStore *store, uint32_t capacity)
+{
+  assert(store && store->slots == NULL);
+
+  arrsetcap(store->objects, capacity);
+  arrsetcap(store->handles, capacity);
+  arrsetcap(store->motions, capacity);
+  arrsetcap(store->slots, capacity + 1);
+
+  arrpush(store->slots, ((ObjSlot){0}));
+  store->free_slot = 0;
+}
+
+void
+obj_store_deinit(ObjStore *store)
+{
+  assert(store);
+  arrfree(store->objects);
+  arrfree(store->handles);
+  arrfree(store->motions);
+  arrfree(store->slots);
+  arrfree(store->created);
+  arrfree(store->moved);
+  *store = (ObjStore){0};
+}
+
+ObjHandle
+obj_create(ObjStore *store, CgObject **object)
+{
+  assert(store && store->slots);
+
+  uint32_t slot_idx = store->free_slot;
+  if (slot_idx != 0) {
+    store->free_slot = store->slots[slot_idx].dense_index;
+  } else {
+    slot_idx = (uint32_t)arrlenu(store->slots);
+    arrpush(store->slots, ((ObjSlot){ .generation = 1 }));
+  }
+
+  ObjSlot *slot = &store->slots[slot_idx];
+  slot->dense_index = (uint32_t)arrlenu(store->objects);
+
+  ObjHandle handle = { .index = slot_idx, .generation = slot->generation };
+
+  arrpush(store->objects, ((CgObject){0}));
+  arrpush(store->handles, handle);
+  arrpush(store->motions, ((ObjMotion){0}));
+  arrpush(store->created, handle);
+  obj_mark_dirty(store, slot->dense_index);
+
+  if (object) *object = &store->objects[slot->dense_index];
+  return handle;
+}
+
+void
+obj_destroy(ObjStore *store, ObjHandle handle)
+{
+  assert(store);
+  if (!obj_is_valid(store, handle)) return;
+
+  ObjSlot *slot = &store->slots[handle.index];
+  uint32_t dense_idx = slot->dense_index;
+  uint32_t last_idx = (uint32_t)arrlenu(store->objects) - 1;
+
+  // Keep objects densely packed by moving the last object into the hole.
+  if (dense_idx != last_idx) {
+    store->objects[dense_idx] = store->objects[last_idx];
+    store->handles[dense_idx] = store->handles[last_idx];
+    store->motions[dense_idx] = store->motions[last_idx];
+    store->slots[store->handles[dense_idx].index].dense_index = dense_idx;
+    obj_mark_dirty(store, dense_idx);
+  }
+  arrsetlen(store->objects, last_idx);
+  arrsetlen(store->handles, last_idx);
+  arrsetlen(store->motions, last_idx);
+
+  if (store->dirty_end > last_idx) store->dirty_end = last_idx;
+  if (store->dirty_begin >= store->dirty_end) obj_clear_dirty(store);
+
+  slot->generation += 1;
+  if (slot->generation == 0) slot->generation = 1;
+  slot->dense_index = store->free_slot;
+  store->free_slot = handle.index;
+}
+
+bool
+obj_is_valid(const ObjStore *store, ObjHandle handle)
+{
+  assert(store);
+  if (handle.index == 0 || handle.index >= arrlenu(store->slots))
+    return false;
+
+  const ObjSlot *slot = &store->slots[handle.index];
+  return handle.generation != 0 &&
+    handle.generation == slot->generation &&
+    slot->dense_index < arrlenu(store->handles) &&
+    store->handles[slot->dense_index].index == handle.index;
+}
+
+CgObject *
+obj_get(ObjStore *store, ObjHandle handle)
+{
+  assert(store);
+  if (obj_is_valid(store, handle)) {
+    return &store->objects[store->slots[handle.index].dense_index];
+  }
+  return NULL;
+}
+
+uint32_t
+obj_count(const ObjStore *store)
+{
+  assert(store);
+  return (uint32_t)arrlenu(store->objects);
+}
+
+void
+obj_mark_dirty(ObjStore *store, uint32_t dense_index)
+{
+  assert(store && dense_index < arrlenu(store->objects));
+  if (store->dirty_begin >= store->dirty_end) {
+    store->dirty_begin = dense_index;
+    store->dirty_end = dense_index + 1;
+  } else {
+    if (dense_index < store->dirty_begin) store->dirty_begin = dense_index;
+    if (dense_index >= store->dirty_end) store->dirty_end = dense_index + 1;
+  }
+}
+
+void
+obj_mark_all_dirty(ObjStore *store)
+{
+  assert(store);
+  store->dirty_begin = 0;
+  store->dirty_end = (uint32_t)arrlenu(store->objects);
+}
+
+void
+obj_clear_dirty(ObjStore *store)
+{
+  assert(store);
+  store->dirty_begin = 0;
+  store->dirty_end = 0;
+}
+
+void
+obj_clear_created(ObjStore *store)
+{
+  assert(store);
+  // Not arrsetlen(), its capacity check warns for a constant 0 length.
+  if (store->created) stbds_header(store->created)->length = 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+typedef struct CgObject CgObject;
+
+typedef struct ObjHandle
+{
+  alignas(8) uint32_t index;
+  uint32_t generation;
+} ObjHandle;
+
+static_assert(sizeof(ObjHandle) == 8 && alignof(ObjHandle) == 8);
+static_assert(sizeof(ObjHandle) <= sizeof(void *));
+
+typedef struct ObjSlot
+{
+  uint32_t dense_index; // next free slot when the slot is not in use
+  uint32_t generation;
+} ObjSlot;
+
+// Transforms of the two most recent physics steps, rendered transform is
+// interpolated between them.
+typedef struct ObjMotion
+{
+  b2Transform prev;
+  b2Transform curr;
+} ObjMotion;
+
+typedef struct ObjStore
+{
+  // Live objects are densely packed (stb_ds arrays) so they can be synced and
+  // uploaded to the GPU in one go. `handles[i]` is the handle of `objects[i]`.
+  CgObject *objects;
+  ObjHandle *handles;
+  ObjMotion *motions;
+  ObjSlot *slots; // slot 0 is reserved, handle with index 0 is always invalid
+  uint32_t free_slot;
+
+  // Range of dense indices modified since the last `obj_clear_dirty()`, used
+  // to upload only the part of the GPU object buffer that has changed.
+  uint32_t dirty_begin;
+  uint32_t dirty_end;
+
+  // Objects created since the last `obj_clear_created()`. Their transforms
+  // have not been synced from the physics world yet.
+  ObjHandle *created;
+
+  // Objects whose bodies moved during the last physics step.
+  ObjHandle *moved;
+} ObjStore;
+
+void obj_store_init(ObjStore *store, uint32_t capacity);
+void obj_store_deinit(ObjStore *store);
+
+/// Returned object is zero-initialized. Pointers returned by `obj_create` and
+/// `obj_get` are valid until the next call to `obj_create` or `obj_destroy`.
+ObjHandle obj_create(ObjStore *store, CgObject **object);
+void obj_destroy(ObjStore *store, ObjHandle handle);
+bool obj_is_valid(const ObjStore *store, ObjHandle handle);
+CgObject *obj_get(ObjStore *store, ObjHandle handle);
+uint32_t obj_count(const ObjStore *store);
+
+void obj_mark_dirty(ObjStore *store, uint32_t dense_index);
+void obj_mark_all_dirty(ObjStore *store);
+void obj_clear_dirty(ObjStore *store);
+void obj_clear_created(ObjStore *store);
+
+// Handles are stored as user data of physics bodies.
+static inline void *
+obj_handle_to_ptr(ObjHandle handle)
+{
+  uint64_t bits;
+  memcpy(&bits, &handle, sizeof(bits));
+  return (void *)(uintptr_t)bits;
+}
+
+static inline ObjHandle
+obj_handle_from_ptr(void *ptr)
+{
+  uint64_t bits = (uint64_t)(uintptr_t)ptr;
+  ObjHandle handle;
+  memcpy(&handle, &bits, sizeof(handle));
+  return handle;
+}
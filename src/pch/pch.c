@@ -17,3 +17,15 @@ void mem_free(void *ptr, const char *file, int32_t line)
   (void)line;
   free(ptr);
 }
+
+FILE *file_open(const char *filename, const char *mode)
+{
+  FILE *file = NULL;
+#if defined(_WIN32)
+  if (fopen_s(&file, filename, mode) != 0) file = NULL;
+#else
+  file = fopen(filename, mode);
+#endif
+  if (file == NULL) LOG("[file_open()] Failed to open %s.", filename);
+  return file;
+}
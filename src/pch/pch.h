@@ -1,5 +1,6 @@
 #pragma once
 
+#if defined(_WIN32)
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -16,6 +17,15 @@
 #pragma warning(pop)
 #include <mfidl.h>
 #include <mfreadwrite.h>
+#else
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +34,7 @@
 #include <stdnoreturn.h>
 #include <stdalign.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <assert.h>
 #include <math.h>
 #include <string.h>
@@ -52,6 +63,7 @@ typedef struct array_double_t { double *items; } array_double_t;
   fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
 } while(0)
 
+#if defined(_WIN32)
 #define VHR(r) do \
 { \
   if (FAILED(r)) { \
@@ -68,6 +80,11 @@ typedef struct array_double_t { double *items; } array_double_t;
     (obj) = NULL; \
   } \
 } while(0)
+#endif
+
+#if !defined(_countof)
+#define _countof(arr) (sizeof(arr) / sizeof((arr)[0]))
+#endif
 
 #define M_ALLOC(size) mem_alloc((size), __FILE__, __LINE__)
 #define M_FREE(ptr) mem_free((ptr), __FILE__, __LINE__)
@@ -75,6 +92,10 @@ typedef struct array_double_t { double *items; } array_double_t;
 void *mem_alloc(size_t size, const char *file, int32_t line);
 void mem_free(void *ptr, const char *file, int32_t line);
 
+// fopen() that builds without CRT deprecation warnings, logs on failure.
+FILE *file_open(const char *filename, const char *mode);
+
+#if defined(_WIN32)
 #undef ID3D12Device14_CreateCommandQueue
 #define ID3D12Device14_CreateCommandQueue(This,...)	\
   ( (This)->lpVtbl -> CreateCommandQueue(This,__VA_ARGS__) )
@@ -154,3 +175,4 @@ void mem_free(void *ptr, const char *file, int32_t line);
 #undef IXAudio2SourceVoice_SubmitSourceBuffer
 #define IXAudio2SourceVoice_SubmitSourceBuffer(This,...)	\
   ( (This)->lpVtbl -> SubmitSourceBuffer(This,__VA_ARGS__) )
+#endif
@@ -0,0 +1,765 @@
+#include "pch.h"
+#include "cpu.h"
+#include "prof.h"
+#include "trace.h"
+#include "phy.h"
+#include "obj.h"
+#include "cpu_gpu_common.h"
+
+static void
+phy_task_execute_range(uint32_t start_index, uint32_t end_index,
+  uint32_t worker_index, void *args)
+{
+  assert(args);
+  PhyTask *task = (PhyTask *)args;
+  trace_begin_task();
+  task->cb(start_index, end_index, worker_index, task->cb_context);
+  trace_end();
+}
+
+static PhyTask *
+phy_get_task(PhyTaskPool *pool, int32_t index)
+{
+  int32_t chunk = 0;
+  int32_t chunk_size = PHY_TASK_CHUNK_SIZE;
+  while (index >= chunk_size) {
+    index -= chunk_size;
+    chunk += 1;
+    chunk_size *= 2;
+  }
+  if (chunk >= PHY_MAX_TASK_CHUNKS) return NULL;
+
+  PhyTask *tasks = atomic_load_explicit(&pool->chunks[chunk],
+    memory_order_acquire);
+  if (tasks) return &tasks[index];
+
+  // Enqueue may come from several threads, only one of them grows the pool.
+  while (atomic_flag_test_and_set_explicit(&pool->grow_lock,
+    memory_order_acquire))
+  {
+    b2Yield();
+  }
+  tasks = atomic_load_explicit(&pool->chunks[chunk], memory_order_relaxed);
+  if (tasks == NULL) {
+    tasks = M_ALLOC(chunk_size * sizeof(PhyTask));
+    for (int32_t i = 0; i < chunk_size; ++i) {
+      tasks[i] = (PhyTask){
+        .task_set = enkiCreateTaskSet(pool->scheduler, phy_task_execute_range),
+      };
+    }
+    pool->capacity += chunk_size;
+    atomic_store_explicit(&pool->chunks[chunk], tasks, memory_order_release);
+  }
+  atomic_flag_clear_explicit(&pool->grow_lock, memory_order_release);
+
+  return &tasks[index];
+}
+
+static void *
+phy_enqueue_task(b2TaskCallback *cb, int32_t item_count, int32_t min_range,
+  void *cb_context, void *user_context)
+{
+  PhyTaskPool *pool = (PhyTaskPool *)user_context;
+
+  int32_t index = atomic_fetch_add_explicit(&pool->num_used, 1,
+    memory_order_relaxed);
+  PhyTask *task = phy_get_task(pool, index);
+  if (task == NULL) {
+    // Pool covers millions of tasks, this is a runaway step.
+    assert(false && "increase PHY_MAX_TASK_CHUNKS");
+    cb(0, item_count, 0, cb_context);
+    return NULL;
+  }
+
+  task->cb = cb;
+  task->cb_context = cb_context;
+  if (pool->spin_ns > 0)
+    enkiSpinTaskThreadsFor(pool->scheduler, pool->spin_ns);
+  enkiAddTaskSetMinRange(pool->scheduler, task->task_set, task, item_count,
+    min_range);
+  return task;
+}
+
+static void
+phy_finish_task(void *task_ptr, void *user_context)
+{
+  if (task_ptr != NULL) {
+    PhyTask *task = (PhyTask *)task_ptr;
+    PhyTaskPool *pool = (PhyTaskPool *)user_context;
+    enkiWaitForTaskSet(pool->scheduler, task->task_set);
+  }
+}
+
+static void
+phy_task_pool_init(PhyTaskPool *pool, enkiTaskScheduler *scheduler,
+  uint64_t spin_ns)
+{
+  pool->scheduler = scheduler;
+  pool->spin_ns = spin_ns;
+
+  // Create the first chunk up front, steps of small worlds never grow it.
+  phy_get_task(pool, 0);
+}
+
+static void
+phy_task_pool_deinit(PhyTaskPool *pool)
+{
+  int32_t chunk_size = PHY_TASK_CHUNK_SIZE;
+  for (int32_t c = 0; c < PHY_MAX_TASK_CHUNKS; ++c, chunk_size *= 2) {
+    PhyTask *tasks = atomic_load(&pool->chunks[c]);
+    if (tasks == NULL) break;
+
+    for (int32_t i = 0; i < chunk_size; ++i) {
+      enkiDeleteTaskSet(pool->scheduler, tasks[i].task_set);
+    }
+    M_FREE(tasks);
+    atomic_store(&pool->chunks[c], NULL);
+  }
+  pool->capacity = 0;
+}
+
+static void
+phy_step_task_execute(uint32_t start_index, uint32_t end_index,
+  uint32_t worker_index, void *args)
+{
+  (void)start_index;
+  (void)end_index;
+  (void)worker_index;
+  assert(args);
+  PhyState *phy = (PhyState *)args;
+
+  for (int32_t i = 0; i < phy->step_task_num_steps; ++i) {
+    phy_step(phy, phy->step_task_time_step, phy->num_substeps);
+
+    // Body events only live until the next step, keep them all.
+    b2BodyEvents events = b2World_GetBodyEvents(phy->world);
+    if (events.moveCount > 0) {
+      b2BodyMoveEvent *dst = arraddnptr(phy->step_task_events,
+        events.moveCount);
+      memcpy(dst, events.moveEvents,
+        events.moveCount * sizeof(b2BodyMoveEvent));
+    }
+  }
+}
+
+// enkiTS thread callbacks get no user data, workers look up their logical
+// processor here (indexed by enkiTS thread number). Shared by all schedulers,
+// `phy_create_scheduler()` waits for the workers to start before the next
+// scheduler may overwrite it.
+static uint32_t g_worker_logical[CPU_MAX_CORES];
+static uint32_t g_num_worker_logical;
+static atomic_uint g_num_started_workers;
+
+static void
+phy_worker_thread_start(uint32_t thread_num)
+{
+  if (thread_num < g_num_worker_logical)
+    cpu_pin_current_thread(g_worker_logical[thread_num]);
+  trace_name_thread("worker", (int32_t)thread_num);
+  atomic_fetch_add_explicit(&g_num_started_workers, 1, memory_order_release);
+}
+
+// Scheduler waits on the timeline, see trace.h.
+static void
+phy_trace_idle_begin(uint32_t thread_num)
+{
+  (void)thread_num;
+  trace_begin("Idle");
+}
+
+static void
+phy_trace_wait_begin(uint32_t thread_num)
+{
+  (void)thread_num;
+  trace_begin("Wait");
+}
+
+static void
+phy_trace_wait_sleep_begin(uint32_t thread_num)
+{
+  (void)thread_num;
+  trace_begin("Wait Sleep");
+}
+
+static void
+phy_trace_end(uint32_t thread_num)
+{
+  (void)thread_num;
+  trace_end();
+}
+
+typedef struct PhyOverlapContext
+{
+  b2ShapeId *hits;
+  int32_t max_hits;
+  int32_t num_hits;
+} PhyOverlapContext;
+
+static bool
+overlap_query_callback(b2ShapeId shape, void *context)
+{
+  PhyOverlapContext *ctx = (PhyOverlapContext *)context;
+  ctx->hits[ctx->num_hits++] = shape;
+  return ctx->num_hits < ctx->max_hits;
+}
+
+static float
+cast_closest_callback(b2ShapeId shape, b2Vec2 point, b2Vec2 normal,
+  float fraction, void *context)
+{
+  b2RayResult *result = (b2RayResult *)context;
+  *result = (b2RayResult){
+    .shapeId = shape,
+    .point = point,
+    .normal = normal,
+    .fraction = fraction,
+    .hit = true,
+  };
+  // Clip the cast, later hits are closer.
+  return fraction;
+}
+
+static void
+phy_query_task_execute(uint32_t start_index, uint32_t end_index,
+  uint32_t worker_index, void *args)
+{
+  (void)worker_index;
+  assert(args);
+  PhyState *phy = (PhyState *)args;
+  const PhyQueryBatch *b = phy->query_batch;
+
+  trace_begin("Query Batch");
+
+  for (uint32_t i = start_index; i < end_index; ++i) {
+    switch (b->type) {
+      case PhyQueryType_OverlapAABB: {
+        PhyOverlapContext ctx = {
+          .hits = &b->hits[i * b->max_hits],
+          .max_hits = b->max_hits,
+        };
+        if (ctx.max_hits > 0) {
+          b2World_OverlapAABB(phy->world, b->aabbs[i], b->filter,
+            overlap_query_callback, &ctx);
+        }
+        b->num_hits[i] = ctx.num_hits;
+      } break;
+      case PhyQueryType_CastRay: {
+        b->results[i] = b2World_CastRayClosest(phy->world, b->origins[i].p,
+          b->translations[i], b->filter);
+      } break;
+      case PhyQueryType_CastPolygon: {
+        b->results[i] = (b2RayResult){0};
+        b2World_CastPolygon(phy->world, b->polygon, b->origins[i],
+          b->translations[i], b->filter, cast_closest_callback,
+          &b->results[i]);
+      } break;
+    }
+  }
+
+  trace_end();
+}
+
+static enkiTaskScheduler *
+phy_create_scheduler(const PhyInitArgs *args)
+{
+  enkiTaskScheduler *scheduler = enkiNewTaskScheduler();
+
+  CpuTopology topo;
+  cpu_get_topology(&topo);
+
+  // Solver stages spin-wait on each other, a worker on an SMT sibling or an
+  // efficiency core holds back all the others. Use one thread per
+  // performance core by default.
+  uint32_t num_threads = args->num_threads;
+  if (num_threads == 0) num_threads = topo.num_performance_cores;
+  if (num_threads == 0) num_threads = 1;
+
+  struct enkiTaskSchedulerConfig config =
+    enkiGetTaskSchedulerConfig(scheduler);
+  config.numTaskThreadsToCreate = num_threads - 1;
+
+  g_num_worker_logical = 0;
+  if (args->pin_threads) {
+    // Thread 0 is the caller, it is not pinned. Workers get the following
+    // cores, fastest first. Workers beyond the core count are left to the OS,
+    // two workers pinned to one core would stall every solver stage.
+    g_num_worker_logical = num_threads < topo.num_cores ?
+      num_threads : topo.num_cores;
+    for (uint32_t i = 0; i < g_num_worker_logical; ++i) {
+      g_worker_logical[i] = topo.cores[i].first_logical;
+    }
+    config.profilerCallbacks.threadStart = phy_worker_thread_start;
+  }
+  if (trace_is_enabled()) {
+    trace_name_thread("main", -1);
+
+    struct enkiProfilerCallbacks *cb = &config.profilerCallbacks;
+    cb->threadStart = phy_worker_thread_start;
+    cb->waitForNewTaskSuspendStart = phy_trace_idle_begin;
+    cb->waitForNewTaskSuspendStop = phy_trace_end;
+    cb->waitForTaskCompleteStart = phy_trace_wait_begin;
+    cb->waitForTaskCompleteStop = phy_trace_end;
+    cb->waitForTaskCompleteSuspendStart = phy_trace_wait_sleep_begin;
+    cb->waitForTaskCompleteSuspendStop = phy_trace_end;
+  }
+  atomic_store_explicit(&g_num_started_workers, 0, memory_order_relaxed);
+  enkiInitTaskSchedulerWithConfig(scheduler, config);
+  if (config.profilerCallbacks.threadStart) {
+    while (atomic_load_explicit(&g_num_started_workers,
+      memory_order_acquire) < config.numTaskThreadsToCreate)
+    {
+      b2Yield();
+    }
+  }
+  return scheduler;
+}
+
+static b2WorldDef
+phy_world_def(const PhyInitArgs *args, PhyTaskPool *pool)
+{
+  b2WorldDef world_def = b2DefaultWorldDef();
+  world_def.workerCount = enkiGetNumTaskThreads(pool->scheduler);
+  world_def.enqueueTask = phy_enqueue_task;
+  world_def.finishTask = phy_finish_task;
+  world_def.userTaskContext = pool;
+  world_def.enableSleep = args->enable_sleep;
+  world_def.simdType = args->simd_type;
+  world_def.enableChecksum = args->enable_checksum;
+  world_def.enableWideTrees = !args->narrow_trees;
+  if (args->grid_cell_size > 0.0f) {
+    world_def.broadPhaseType = b2_broadPhaseGrid;
+    world_def.gridCellSize = args->grid_cell_size;
+  }
+  return world_def;
+}
+
+void
+phy_init(PhyState *phy, const PhyInitArgs *args)
+{
+  assert(phy && args && phy->scheduler == NULL);
+
+  phy->scheduler = phy_create_scheduler(args);
+  phy_task_pool_init(&phy->task_pool, phy->scheduler,
+    args->spin_us * 1000ull);
+
+  b2WorldDef world_def = phy_world_def(args, &phy->task_pool);
+  phy->world = b2CreateWorld(&world_def);
+
+  phy->step_rate = args->step_rate > 0.0f ?
+    args->step_rate : PHY_DEFAULT_STEP_RATE;
+  phy->max_steps_per_update = args->max_steps_per_update > 0 ?
+    args->max_steps_per_update : PHY_DEFAULT_MAX_STEPS_PER_UPDATE;
+  phy->num_substeps = args->num_substeps > 0 ?
+    args->num_substeps : PHY_DEFAULT_NUM_SUBSTEPS;
+
+  phy->pipelined = args->pipelined;
+  phy->step_task = enkiCreateTaskSet(phy->scheduler, phy_step_task_execute);
+  enkiSetArgsTaskSet(phy->step_task, phy);
+
+  phy->query_task = enkiCreateTaskSet(phy->scheduler, phy_query_task_execute);
+
+  prof_init(&phy->profile, args->profile_window > 0 ?
+    args->profile_window : PROF_DEFAULT_WINDOW);
+}
+
+void
+phy_deinit(PhyState *phy)
+{
+  assert(phy);
+
+  phy_wait(phy);
+
+  if (B2_IS_NON_NULL(phy->world)) {
+    b2DestroyWorld(phy->world);
+    phy->world = b2_nullWorldId;
+  }
+
+  if (phy->scheduler) {
+    phy_task_pool_deinit(&phy->task_pool);
+    if (phy->step_task) {
+      enkiDeleteTaskSet(phy->scheduler, phy->step_task);
+      phy->step_task = NULL;
+    }
+    if (phy->query_task) {
+      enkiDeleteTaskSet(phy->scheduler, phy->query_task);
+      phy->query_task = NULL;
+    }
+    enkiDeleteTaskScheduler(phy->scheduler);
+    phy->scheduler = NULL;
+  }
+  arrfree(phy->step_task_events);
+  prof_deinit(&phy->profile);
+}
+
+void
+phy_replay_step(PhyState *phy, float time_step, int32_t num_substeps)
+{
+  assert(phy);
+
+  // Wakes sleeping workers while the step prepares its first tasks.
+  if (phy->task_pool.spin_ns > 0)
+    enkiSpinTaskThreadsFor(phy->scheduler, phy->task_pool.spin_ns);
+
+  b2World_Step(phy->world, time_step, num_substeps);
+
+  // All tasks are finished by now, recycle them for the next step.
+  phy->num_step_tasks = atomic_exchange(&phy->task_pool.num_used, 0);
+  if (phy->num_step_tasks > phy->max_step_tasks)
+    phy->max_step_tasks = phy->num_step_tasks;
+}
+
+void
+phy_step(PhyState *phy, float time_step, int32_t num_substeps)
+{
+  phy_replay_step(phy, time_step, num_substeps);
+  phy->num_steps += 1;
+
+  b2Profile profile = b2World_GetProfile(phy->world);
+  prof_push(&phy->profile, &profile);
+}
+
+static void
+sync_created_objects(ObjStore *objects)
+{
+  for (uint32_t i = 0; i < arrlenu(objects->created); ++i) {
+    CgObject *object = obj_get(objects, objects->created[i]);
+    if (object == NULL) continue;
+
+    uint32_t dense_idx = (uint32_t)(object - objects->objects);
+    b2BodyId body_id = *(b2BodyId *)&object->phy_body_id;
+    b2Transform t = b2Body_GetTransform(body_id);
+
+    objects->motions[dense_idx] = (ObjMotion){ .prev = t, .curr = t };
+    memcpy(object, &t, sizeof(t));
+    obj_mark_dirty(objects, dense_idx);
+  }
+  obj_clear_created(objects);
+}
+
+static void
+sync_moved_objects(ObjStore *objects, const b2BodyMoveEvent *events,
+  int32_t num_events)
+{
+  // Objects that moved in the previous step may have stopped, snap them to
+  // their current transform. The ones that keep moving are updated below.
+  for (uint32_t i = 0; i < arrlenu(objects->moved); ++i) {
+    CgObject *object = obj_get(objects, objects->moved[i]);
+    if (object == NULL) continue;
+
+    uint32_t dense_idx = (uint32_t)(object - objects->objects);
+    memcpy(object, &objects->motions[dense_idx].curr, sizeof(b2Transform));
+    obj_mark_dirty(objects, dense_idx);
+  }
+  if (objects->moved) stbds_header(objects->moved)->length = 0;
+
+  for (int32_t i = 0; i < num_events; ++i) {
+    const b2BodyMoveEvent *event = &events[i];
+    ObjHandle handle = obj_handle_from_ptr(event->userData);
+    CgObject *object = obj_get(objects, handle);
+    if (object == NULL) continue;
+
+    uint32_t dense_idx = (uint32_t)(object - objects->objects);
+    ObjMotion *motion = &objects->motions[dense_idx];
+    motion->prev = motion->curr;
+    motion->curr = event->transform;
+
+    memcpy(object, &event->transform, sizeof(event->transform));
+    obj_mark_dirty(objects, dense_idx);
+    arrpush(objects->moved, handle);
+  }
+}
+
+void
+phy_sync_objects(PhyState *phy, ObjStore *objects)
+{
+  assert(phy && objects);
+
+  sync_created_objects(objects);
+
+  b2BodyEvents events = b2World_GetBodyEvents(phy->world);
+  sync_moved_objects(objects, events.moveEvents, events.moveCount);
+}
+
+void
+phy_interpolate_objects(ObjStore *objects, float alpha)
+{
+  assert(objects);
+
+  for (uint32_t i = 0; i < arrlenu(objects->moved); ++i) {
+    CgObject *object = obj_get(objects, objects->moved[i]);
+    if (object == NULL) continue;
+
+    uint32_t dense_idx = (uint32_t)(object - objects->objects);
+    const ObjMotion *motion = &objects->motions[dense_idx];
+    b2Transform t = {
+      .p = b2Lerp(motion->prev.p, motion->curr.p, alpha),
+      .q = b2NLerp(motion->prev.q, motion->curr.q, alpha),
+    };
+    memcpy(object, &t, sizeof(t));
+    obj_mark_dirty(objects, dense_idx);
+  }
+}
+
+static int32_t
+consume_accumulator(PhyState *phy, float delta_time, float time_step)
+{
+  phy->accumulator += delta_time;
+
+  int32_t num_steps = (int32_t)(phy->accumulator / time_step);
+  if (num_steps > phy->max_steps_per_update) {
+    // We can't keep up, drop the time instead of taking even more steps
+    // next frame (spiral of death).
+    phy->num_dropped_steps += num_steps - phy->max_steps_per_update;
+    phy->accumulator = fmodf(phy->accumulator, time_step);
+    num_steps = phy->max_steps_per_update;
+  } else {
+    phy->accumulator -= (float)num_steps * time_step;
+    if (phy->accumulator < 0.0f) phy->accumulator = 0.0f;
+  }
+  return num_steps;
+}
+
+int32_t
+phy_update(PhyState *phy, ObjStore *objects, float delta_time)
+{
+  assert(phy && objects && delta_time >= 0.0f);
+
+  phy_wait(phy);
+
+  if (phy->profile_reset_requested) {
+    prof_reset(&phy->profile);
+    phy->profile_reset_requested = false;
+  }
+
+  // Apply results of the steps kicked by the previous (pipelined) update.
+  if (phy->step_task_num_steps > 0) {
+    sync_moved_objects(objects, phy->step_task_events,
+      (int32_t)arrlen(phy->step_task_events));
+    if (phy->step_task_events)
+      stbds_header(phy->step_task_events)->length = 0;
+    phy->step_task_num_steps = 0;
+  }
+
+  float time_step = 1.0f / phy->step_rate;
+  int32_t num_steps = consume_accumulator(phy, delta_time, time_step);
+
+  if (phy->pipelined) {
+    sync_created_objects(objects);
+
+    if (num_steps > 0) {
+      phy->step_task_num_steps = num_steps;
+      phy->step_task_time_step = time_step;
+      enkiAddTaskSet(phy->scheduler, phy->step_task);
+    }
+  } else {
+    for (int32_t i = 0; i < num_steps; ++i) {
+      phy_step(phy, time_step, phy->num_substeps);
+      phy_sync_objects(phy, objects);
+    }
+
+    // Body events are only valid right after a step, objects created this
+    // frame still need their initial transform.
+    if (num_steps == 0)
+      sync_created_objects(objects);
+  }
+
+  phy_interpolate_objects(objects, phy->accumulator / time_step);
+  return num_steps;
+}
+
+void
+phy_wait(PhyState *phy)
+{
+  assert(phy);
+  if (phy->step_task)
+    enkiWaitForTaskSet(phy->scheduler, phy->step_task);
+}
+
+void
+phy_reset_profile(PhyState *phy)
+{
+  assert(phy);
+  phy->profile_reset_requested = true;
+}
+
+void
+phy_set_spin(PhyState *phy, uint32_t spin_us)
+{
+  assert(phy);
+  phy->task_pool.spin_ns = spin_us * 1000ull;
+}
+
+uint32_t
+phy_get_spin(const PhyState *phy)
+{
+  assert(phy);
+  return (uint32_t)(phy->task_pool.spin_ns / 1000);
+}
+
+void
+phy_query_batch(PhyState *phy, const PhyQueryBatch *batch)
+{
+  assert(phy && batch && batch->num_queries >= 0);
+  if (batch->num_queries == 0) return;
+
+  assert(batch->type != PhyQueryType_OverlapAABB ||
+    (batch->aabbs && batch->num_hits && (batch->hits || !batch->max_hits)));
+  assert(batch->type != PhyQueryType_CastRay ||
+    (batch->origins && batch->translations && batch->results));
+  assert(batch->type != PhyQueryType_CastPolygon ||
+    (batch->origins && batch->translations && batch->polygon &&
+    batch->results));
+
+  // World is locked while it steps.
+  phy_wait(phy);
+
+  phy->query_batch = batch;
+  enkiAddTaskSetMinRange(phy->scheduler, phy->query_task, phy,
+    (uint32_t)batch->num_queries, PHY_QUERY_MIN_RANGE);
+  enkiWaitForTaskSet(phy->scheduler, phy->query_task);
+  phy->query_batch = NULL;
+}
+
+static int
+compare_group_worlds(const void *a, const void *b)
+{
+  const PhyGroupWorld *wa = *(PhyGroupWorld *const *)a;
+  const PhyGroupWorld *wb = *(PhyGroupWorld *const *)b;
+  return (wa->last_step_ms < wb->last_step_ms) -
+    (wa->last_step_ms > wb->last_step_ms);
+}
+
+static void
+phy_group_step_task_execute(uint32_t start_index, uint32_t end_index,
+  uint32_t worker_index, void *args)
+{
+  (void)worker_index;
+  assert(args);
+  PhyWorldGroup *group = (PhyWorldGroup *)args;
+
+  for (uint32_t i = start_index; i < end_index; ++i) {
+    PhyGroupWorld *world = group->step_order[i];
+
+    // Box2d waits for its tasks inside the step, the waiting thread runs
+    // other tasks in the meantime, including the steps of other worlds.
+    b2World_Step(world->world, group->step_time_step,
+      group->step_num_substeps);
+    world->num_steps += 1;
+
+    world->num_step_tasks = atomic_exchange(&world->task_pool.num_used, 0);
+    if (world->num_step_tasks > world->max_step_tasks)
+      world->max_step_tasks = world->num_step_tasks;
+
+    b2Profile profile = b2World_GetProfile(world->world);
+    world->last_step_ms = profile.step;
+    prof_push(&world->profile, &profile);
+  }
+}
+
+void
+phy_group_init(PhyWorldGroup *group, const PhyInitArgs *args)
+{
+  assert(group && args && group->scheduler == NULL);
+
+  group->scheduler = phy_create_scheduler(args);
+  group->profile_window = args->profile_window > 0 ?
+    args->profile_window : PROF_DEFAULT_WINDOW;
+  group->spin_ns = args->spin_us * 1000ull;
+
+  group->step_task = enkiCreateTaskSet(group->scheduler,
+    phy_group_step_task_execute);
+}
+
+void
+phy_group_deinit(PhyWorldGroup *group)
+{
+  assert(group);
+
+  while (arrlenu(group->worlds) > 0) {
+    phy_group_destroy_world(group, arrlast(group->worlds));
+  }
+  arrfree(group->worlds);
+  arrfree(group->step_order);
+
+  if (group->scheduler) {
+    enkiDeleteTaskSet(group->scheduler, group->step_task);
+    group->step_task = NULL;
+    enkiDeleteTaskScheduler(group->scheduler);
+    group->scheduler = NULL;
+  }
+}
+
+PhyGroupWorld *
+phy_group_create_world(PhyWorldGroup *group, const PhyInitArgs *args)
+{
+  assert(group && group->scheduler && args);
+
+  PhyGroupWorld *world = M_ALLOC(sizeof(PhyGroupWorld));
+  *world = (PhyGroupWorld){0};
+  phy_task_pool_init(&world->task_pool, group->scheduler, group->spin_ns);
+
+  b2WorldDef world_def = phy_world_def(args, &world->task_pool);
+  world_def.solverWorkerCount = 1;
+  world->world = b2CreateWorld(&world_def);
+
+  prof_init(&world->profile, group->profile_window);
+
+  arrpush(group->worlds, world);
+  return world;
+}
+
+void
+phy_group_destroy_world(PhyWorldGroup *group, PhyGroupWorld *world)
+{
+  assert(group && world);
+
+  for (uint32_t i = 0; i < arrlenu(group->worlds); ++i) {
+    if (group->worlds[i] == world) {
+      arrdel(group->worlds, i);
+      break;
+    }
+  }
+
+  b2DestroyWorld(world->world);
+  phy_task_pool_deinit(&world->task_pool);
+  prof_deinit(&world->profile);
+  M_FREE(world);
+}
+
+PhyGroupWorld *
+phy_group_find_world(const PhyWorldGroup *group, b2WorldId world)
+{
+  assert(group);
+
+  for (uint32_t i = 0; i < arrlenu(group->worlds); ++i) {
+    b2WorldId id = group->worlds[i]->world;
+    if (id.index1 == world.index1 && id.revision == world.revision)
+      return group->worlds[i];
+  }
+  return NULL;
+}
+
+void
+phy_group_step(PhyWorldGroup *group, float time_step, int32_t num_substeps)
+{
+  assert(group && group->scheduler);
+
+  uint32_t num_worlds = (uint32_t)arrlenu(group->worlds);
+  if (num_worlds == 0) return;
+
+  // Start the worlds that took longest last time first, the short ones
+  // finish in the gaps they leave.
+  arrsetlen(group->step_order, num_worlds);
+  memcpy(group->step_order, group->worlds,
+    num_worlds * sizeof(PhyGroupWorld *));
+  qsort(group->step_order, num_worlds, sizeof(PhyGroupWorld *),
+    compare_group_worlds);
+
+  group->step_time_step = time_step;
+  group->step_num_substeps = num_substeps;
+  if (group->spin_ns > 0)
+    enkiSpinTaskThreadsFor(group->scheduler, group->spin_ns);
+  enkiAddTaskSetMinRange(group->scheduler, group->step_task, group,
+    num_worlds, 1);
+  enkiWaitForTaskSet(group->scheduler, group->step_task);
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#define PHY_DEFAULT_STEP_RATE 60.0f
+#define PHY_DEFAULT_MAX_STEPS_PER_UPDATE 4
+#define PHY_DEFAULT_NUM_SUBSTEPS 1
+
+// Task pool chunk `i` holds PHY_TASK_CHUNK_SIZE << i tasks.
+#define PHY_TASK_CHUNK_SIZE 64
+#define PHY_MAX_TASK_CHUNKS 16
+
+// Queries per task range of a batch, see `phy_query_batch()`.
+#define PHY_QUERY_MIN_RANGE 32
+
+typedef struct ObjStore ObjStore;
+
+typedef struct PhyTask
+{
+  enkiTaskSet *task_set;
+  b2TaskCallback *cb;
+  void *cb_context;
+} PhyTask;
+
+// Tasks handed to box2d. Grows by adding chunks so tasks never move, tasks
+// are recycled after every step.
+typedef struct PhyTaskPool
+{
+  enkiTaskScheduler *scheduler;
+  _Atomic(PhyTask *) chunks[PHY_MAX_TASK_CHUNKS];
+  atomic_flag grow_lock;
+  atomic_int num_used; // tasks enqueued during the current step
+  int32_t capacity;
+  uint64_t spin_ns; // spin window opened by every enqueued task
+} PhyTaskPool;
+
+typedef struct PhyState
+{
+  b2WorldId world;
+  ProfHistory profile; // per-step profiles of the last steps
+  int32_t num_steps;
+  b2JointId mouse_joint;
+  b2BodyId mouse_fixed_body;
+  enkiTaskScheduler *scheduler;
+  PhyTaskPool task_pool;
+  int32_t num_step_tasks; // tasks used by the last step
+  int32_t max_step_tasks;
+
+  // Fixed time step state, see `phy_update()`.
+  float step_rate;
+  int32_t max_steps_per_update;
+  int32_t num_substeps;
+  float accumulator;
+  int32_t num_dropped_steps;
+  bool profile_reset_requested;
+
+  // Pipelined stepping, see `phy_update()`. Task state is owned by the step
+  // task while it is in flight.
+  bool pipelined;
+  enkiTaskSet *step_task;
+  int32_t step_task_num_steps;
+  float step_task_time_step;
+  b2BodyMoveEvent *step_task_events; // stb_ds array
+
+  // Batch queries, see `phy_query_batch()`.
+  enkiTaskSet *query_task;
+  const struct PhyQueryBatch *query_batch;
+} PhyState;
+
+// World of a PhyWorldGroup. Heap allocated, the pointer stays valid until
+// `phy_group_destroy_world()`.
+typedef struct PhyGroupWorld
+{
+  b2WorldId world;
+  PhyTaskPool task_pool; // tasks of this world only, recycled per step
+  ProfHistory profile; // per-step profiles of the last steps
+  int32_t num_steps;
+  int32_t num_step_tasks; // tasks used by the last step
+  int32_t max_step_tasks;
+  float last_step_ms; // orders the next group step
+} PhyGroupWorld;
+
+// Worlds (e.g. simultaneous matches) stepped together on one scheduler, see
+// `phy_group_step()`.
+typedef struct PhyWorldGroup
+{
+  enkiTaskScheduler *scheduler;
+  PhyGroupWorld **worlds; // stb_ds array
+  uint32_t profile_window;
+  uint64_t spin_ns; // see PhyInitArgs::spin_us
+
+  // Step state, see `phy_group_step()`.
+  enkiTaskSet *step_task;
+  PhyGroupWorld **step_order; // stb_ds array, slowest world first
+  float step_time_step;
+  int32_t step_num_substeps;
+} PhyWorldGroup;
+
+typedef enum PhyQueryType
+{
+  PhyQueryType_OverlapAABB,
+  PhyQueryType_CastRay,
+  PhyQueryType_CastPolygon,
+} PhyQueryType;
+
+// Batch of queries of one type sharing a filter. Inputs and outputs are
+// arrays of `num_queries` elements provided by the caller, only the ones
+// used by `type` need to be set.
+typedef struct PhyQueryBatch
+{
+  PhyQueryType type;
+  int32_t num_queries;
+  b2QueryFilter filter;
+
+  // OverlapAABB: shapes whose bounds overlap `aabbs[i]` are written to
+  // `hits[i * max_hits ...]`, their count to `num_hits[i]`. The search stops
+  // when `max_hits` is reached.
+  const b2AABB *aabbs;
+  int32_t max_hits;
+  b2ShapeId *hits;
+  int32_t *num_hits;
+
+  // CastRay, CastPolygon: closest hit along `translations[i]` is written to
+  // `results[i]`. CastPolygon sweeps `polygon` placed at `origins[i]`, the
+  // ray starts at `origins[i].p`.
+  const b2Transform *origins;
+  const b2Vec2 *translations;
+  const b2Polygon *polygon;
+  b2RayResult *results;
+} PhyQueryBatch;
+
+typedef struct PhyInitArgs
+{
+  uint32_t num_threads; // 0 selects one thread per performance core
+  // Pin workers to distinct cores, fastest first. Workers beyond the core
+  // count are not pinned.
+  bool pin_threads;
+  bool enable_sleep;
+  float step_rate; // Hz, 0 selects PHY_DEFAULT_STEP_RATE
+  int32_t max_steps_per_update; // 0 selects PHY_DEFAULT_MAX_STEPS_PER_UPDATE
+  int32_t num_substeps; // 0 selects PHY_DEFAULT_NUM_SUBSTEPS
+  bool pipelined;
+  uint32_t profile_window; // steps, 0 selects PROF_DEFAULT_WINDOW
+  b2SIMDType simd_type; // contact solver, default is the widest the CPU has
+  bool enable_checksum; // see b2World_GetChecksum
+  bool narrow_trees; // query the binary broad-phase trees, see b2WorldDef
+  float grid_cell_size; // > 0 keeps dynamic shapes in a grid, see b2BroadPhaseType
+  // Workers out of tasks keep spinning this long after a step starts and
+  // after every task it enqueues before they sleep, so the next burst of
+  // tasks doesn't pay the OS wake-up. 0 sleeps right away (least power).
+  // See `enkiSpinTaskThreadsFor()`, `enkiGetWakeStats()`.
+  uint32_t spin_us;
+} PhyInitArgs;
+
+void phy_init(PhyState *phy, const PhyInitArgs *args);
+void phy_deinit(PhyState *phy);
+
+void phy_step(PhyState *phy, float time_step, int32_t num_substeps);
+/// Steps like `phy_step()` but neither counts nor profiles the step, for
+/// re-simulating steps already taken (e.g. after a rollback).
+void phy_replay_step(PhyState *phy, float time_step, int32_t num_substeps);
+
+/// Advances the simulation by `delta_time` seconds in fixed steps of
+/// `1 / step_rate`, syncing objects after every step, and interpolates object
+/// transforms by the time left in the accumulator. At most
+/// `max_steps_per_update` steps are taken, the rest of the time is dropped.
+/// Returns the number of steps taken.
+///
+/// When `pipelined` is set the steps are kicked as a task and the function
+/// returns immediately. Objects then show the result of the steps kicked by
+/// the previous call (one frame of latency) and the world (and PhyState
+/// profile) must not be touched until `phy_wait()` returns.
+int32_t phy_update(PhyState *phy, ObjStore *objects, float delta_time);
+
+/// Waits for the steps kicked by a pipelined `phy_update()`.
+void phy_wait(PhyState *phy);
+
+/// Copies transforms of the bodies that moved during the last step (and of
+/// objects created since the last sync) to their objects and marks them dirty.
+/// Bodies that are static, asleep or moved with `b2Body_SetTransform()` after
+/// their first sync are not visited. Call once after every step.
+void phy_sync_objects(PhyState *phy, ObjStore *objects);
+
+/// Blends transforms of the objects that moved during the last step between
+/// the previous (`alpha` = 0) and the current (`alpha` = 1) step.
+void phy_interpolate_objects(ObjStore *objects, float alpha);
+
+/// Profile is reset by the next `phy_update()`.
+void phy_reset_profile(PhyState *phy);
+
+/// Changes the worker spin window, see PhyInitArgs::spin_us. Call while no
+/// step is in flight.
+void phy_set_spin(PhyState *phy, uint32_t spin_us);
+uint32_t phy_get_spin(const PhyState *phy);
+
+/// Runs the queries of `batch` in parallel on the physics scheduler and
+/// returns when all results are written. Waits for a pipelined step first.
+/// Call from one thread at a time.
+void phy_query_batch(PhyState *phy, const PhyQueryBatch *batch);
+
+/// Creates the shared scheduler from `num_threads`, `pin_threads`, `spin_us`
+/// and `profile_window` of `args`. The group starts empty.
+void phy_group_init(PhyWorldGroup *group, const PhyInitArgs *args);
+/// Destroys the remaining worlds and the scheduler.
+void phy_group_deinit(PhyWorldGroup *group);
+
+/// Creates a world configured like `phy_init()` does from the world options
+/// of `args` (the scheduler options are ignored). Solver stages of the world
+/// run on one worker, they spin-wait on each other and would deadlock with
+/// the solvers of other worlds on the shared threads. The broad-phase,
+/// island and finalize tasks are still spread over all workers.
+/// Call between steps.
+PhyGroupWorld *phy_group_create_world(PhyWorldGroup *group,
+  const PhyInitArgs *args);
+void phy_group_destroy_world(PhyWorldGroup *group, PhyGroupWorld *world);
+
+/// Returns the group world of `world` or NULL.
+PhyGroupWorld *phy_group_find_world(const PhyWorldGroup *group,
+  b2WorldId world);
+
+/// Steps every world of the group once and returns when all are done. Each
+/// world steps as its own task, slowest last step first, so the parallel
+/// tasks of small worlds fill workers that a large world leaves idle.
+/// Profiles of each world are pushed to its `profile`.
+void phy_group_step(PhyWorldGroup *group, float time_step,
+  int32_t num_substeps);
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "prof.h"
+
+#define PROF_STAGE(field) { #field, offsetof(b2Profile, field) }
+
+const ProfStage prof_stages[PROF_NUM_STAGES] = {
+  PROF_STAGE(step),
+  PROF_STAGE(pairs),
+  PROF_STAGE(collide),
+  PROF_STAGE(solve),
+  PROF_STAGE(buildIslands),
+  PROF_STAGE(solveConstraints),
+  PROF_STAGE(prepareTasks),
+  PROF_STAGE(solverTasks),
+  PROF_STAGE(prepareConstraints),
+  PROF_STAGE(integrateVelocities),
+  PROF_STAGE(warmStart),
+  PROF_STAGE(solveVelocities),
+  PROF_STAGE(integratePositions),
+  PROF_STAGE(relaxVelocities),
+  PROF_STAGE(applyRestitution),
+  PROF_STAGE(storeImpulses),
+  PROF_STAGE(finalizeBodies),
+  PROF_STAGE(splitIslands),
+  PROF_STAGE(sleepIslands),
+  PROF_STAGE(hitEvents),
+  PROF_STAGE(broadphase),
+  PROF_STAGE(continuous),
+};
+
+// Fails when box2d adds or removes a stage, update `prof_stages` then.
+static_assert(sizeof(b2Profile) == PROF_NUM_STAGES * sizeof(float));
+
+static int
+compare_floats(const void *a, const void *b)
+{
+  float fa = *(const float *)a;
+  float fb = *(const float *)b;
+  return (fa > fb) - (fa < fb);
+}
+
+static float
+sorted_percentile(const float *sorted, uint32_t count, float p)
+{
+  uint32_t rank = (uint32_t)ceilf(p * (float)count);
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void
+prof_init(ProfHistory *hist, uint32_t window)
+{
+  assert(hist && hist->samples == NULL && window > 0);
+
+  hist->samples = M_ALLOC(PROF_NUM_STAGES * window * sizeof(float));
+  hist->scratch = M_ALLOC(window * sizeof(float));
+  hist->window = window;
+  prof_reset(hist);
+}
+
+void
+prof_deinit(ProfHistory *hist)
+{
+  assert(hist);
+  if (hist->samples) M_FREE(hist->samples);
+  if (hist->scratch) M_FREE(hist->scratch);
+  *hist = (ProfHistory){0};
+}
+
+void
+prof_reset(ProfHistory *hist)
+{
+  assert(hist);
+  hist->head = 0;
+  hist->count = 0;
+}
+
+void
+prof_push(ProfHistory *hist, const b2Profile *profile)
+{
+  assert(hist && hist->samples && profile);
+
+  const uint8_t *fields = (const uint8_t *)profile;
+  for (uint32_t s = 0; s < PROF_NUM_STAGES; ++s) {
+    float value;
+    memcpy(&value, fields + prof_stages[s].offset, sizeof(value));
+    hist->samples[s * hist->window + hist->head] = value;
+  }
+  hist->head = (hist->head + 1) % hist->window;
+  if (hist->count < hist->window) hist->count += 1;
+}
+
+void
+prof_compute_stats(ProfHistory *hist, ProfStats *stats)
+{
+  assert(hist && stats);
+
+  if (hist->count == 0) {
+    memset(stats, 0, PROF_NUM_STAGES * sizeof(ProfStats));
+    return;
+  }
+
+  uint32_t last = (hist->head + hist->window - 1) % hist->window;
+
+  for (uint32_t s = 0; s < PROF_NUM_STAGES; ++s) {
+    // Samples are stored from index 0 until the buffer wraps, so the first
+    // `count` entries are always the ones in the window.
+    const float *samples = &hist->samples[s * hist->window];
+    memcpy(hist->scratch, samples, hist->count * sizeof(float));
+    qsort(hist->scratch, hist->count, sizeof(float), compare_floats);
+
+    stats[s] = (ProfStats){
+      .last = samples[last],
+      .p50 = sorted_percentile(hist->scratch, hist->count, 0.50f),
+      .p95 = sorted_percentile(hist->scratch, hist->count, 0.95f),
+      .p99 = sorted_percentile(hist->scratch, hist->count, 0.99f),
+      .max = hist->scratch[hist->count - 1],
+    };
+  }
+}
+
+uint32_t
+prof_copy_samples(const ProfHistory *hist, uint32_t stage, float *samples,
+  uint32_t max_samples)
+{
+  assert(hist && stage < PROF_NUM_STAGES && samples);
+
+  uint32_t count = hist->count < max_samples ? hist->count : max_samples;
+  uint32_t first = (hist->head + hist->window - count) % hist->window;
+  const float *src = &hist->samples[stage * hist->window];
+
+  for (uint32_t i = 0; i < count; ++i) {
+    samples[i] = src[(first + i) % hist->window];
+  }
+  return count;
+}
+
+bool
+prof_export_csv(const ProfHistory *hist, const char *filename)
+{
+  assert(hist && filename);
+
+  FILE *file = file_open(filename, "wb");
+  if (file == NULL) return false;
+
+  for (uint32_t s = 0; s < PROF_NUM_STAGES; ++s) {
+    fprintf(file, "%s%s", s > 0 ? "," : "", prof_stages[s].name);
+  }
+  fprintf(file, "\n");
+
+  uint32_t first = (hist->head + hist->window - hist->count) % hist->window;
+
+  for (uint32_t i = 0; i < hist->count; ++i) {
+    uint32_t idx = (first + i) % hist->window;
+    for (uint32_t s = 0; s < PROF_NUM_STAGES; ++s) {
+      fprintf(file, "%s%.4f", s > 0 ? "," : "",
+        hist->samples[s * hist->window + idx]);
+    }
+    fprintf(file, "\n");
+  }
+
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
+
+bool
+prof_export_json(ProfHistory *hist, const char *filename)
+{
+  assert(hist && filename);
+
+  FILE *file = file_open(filename, "wb");
+  if (file == NULL) return false;
+
+  ProfStats stats[PROF_NUM_STAGES];
+  prof_compute_stats(hist, stats);
+
+  uint32_t first = (hist->head + hist->window - hist->count) % hist->window;
+
+  fprintf(file, "{\n  \"window\": %u,\n  \"count\": %u,\n  \"stages\": {\n",
+    hist->window, hist->count);
+
+  for (uint32_t s = 0; s < PROF_NUM_STAGES; ++s) {
+    const ProfStats *st = &stats[s];
+    fprintf(file,
+      "    \"%s\": {\n"
+      "      \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f,\n"
+      "      \"samples\": [", prof_stages[s].name, st->p50, st->p95, st->p99,
+      st->max);
+
+    for (uint32_t i = 0; i < hist->count; ++i) {
+      uint32_t idx = (first + i) % hist->window;
+      fprintf(file, "%s%.4f", i > 0 ? ", " : "",
+        hist->samples[s * hist->window + idx]);
+    }
+    fprintf(file, "]\n    }%s\n", s + 1 < PROF_NUM_STAGES ? "," : "");
+  }
+  fprintf(file, "  }\n}\n");
+
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
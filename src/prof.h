@@ -0,0 +1,52 @@
+#pragma once
+
+#define PROF_DEFAULT_WINDOW 600 // 10 s of steps at 60 Hz
+#define PROF_NUM_STAGES 22
+
+// Stage of `b2Profile`, `offset` is the byte offset of its float field.
+typedef struct ProfStage
+{
+  const char *name;
+  size_t offset;
+} ProfStage;
+
+extern const ProfStage prof_stages[PROF_NUM_STAGES];
+
+typedef struct ProfStats
+{
+  float last;
+  float p50;
+  float p95;
+  float p99;
+  float max;
+} ProfStats;
+
+// Rolling window of the last `window` per-step profiles.
+typedef struct ProfHistory
+{
+  float *samples; // PROF_NUM_STAGES ring buffers of `window` samples [ms]
+  float *scratch; // `window` floats used to sort samples
+  uint32_t window;
+  uint32_t head; // index of the next sample
+  uint32_t count;
+} ProfHistory;
+
+void prof_init(ProfHistory *hist, uint32_t window);
+void prof_deinit(ProfHistory *hist);
+void prof_reset(ProfHistory *hist);
+
+void prof_push(ProfHistory *hist, const b2Profile *profile);
+
+/// Computes stats of every stage over the samples in the window (nearest-rank
+/// percentiles). `stats` must have room for PROF_NUM_STAGES elements.
+void prof_compute_stats(ProfHistory *hist, ProfStats *stats);
+
+/// Copies up to `max_samples` most recent samples of `stage` to `samples`,
+/// oldest first. Returns the number of samples copied.
+uint32_t prof_copy_samples(const ProfHistory *hist, uint32_t stage,
+  float *samples, uint32_t max_samples);
+
+/// One row per step, one column per stage, oldest step first.
+bool prof_export_csv(const ProfHistory *hist, const char *filename);
+/// Stats and samples of every stage.
+bool prof_export_json(ProfHistory *hist, const char *filename);
@@ -0,0 +1,649 @@
+#include "pch.h"
+#include "obj.h"
+#include "scn.h"
+#include "cpu_gpu_common.h"
+
+// Records are read in place from the mapped file, keep them 8-byte aligned
+// and fail when box2d changes the layout of a stored type.
+static_assert(sizeof(ScnHeader) == 32);
+static_assert(sizeof(ScnBody) == 88);
+static_assert(sizeof(ScnShape) == 192);
+static_assert(sizeof(ScnJoint) == 104);
+static_assert(alignof(ScnShape) == 8);
+
+#define SCN_INVALID_INDEX UINT32_MAX
+
+static const void *
+map_file(const char *filename, size_t *size)
+{
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) return NULL;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return NULL;
+  }
+
+  // The view keeps the file and the mapping object alive.
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) return NULL;
+
+  const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+
+  *size = (size_t)file_size.QuadPart;
+  return data;
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  // Everything is read once right away, fault all pages in up front.
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ,
+    MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return NULL;
+
+  *size = (size_t)st.st_size;
+  return data;
+#endif
+}
+
+static void
+unmap_file(const void *data, size_t size)
+{
+#if defined(_WIN32)
+  (void)size;
+  UnmapViewOfFile(data);
+#else
+  munmap((void *)data, size);
+#endif
+}
+
+static uint32_t
+find_body_index(const ObjStore *objects, const uint32_t *body_indices,
+  b2BodyId body_id)
+{
+  ObjHandle handle = obj_handle_from_ptr(b2Body_GetUserData(body_id));
+  if (!obj_is_valid(objects, handle)) return SCN_INVALID_INDEX;
+  return body_indices[objects->slots[handle.index].dense_index];
+}
+
+static bool
+save_joint(b2JointId joint_id, uint32_t body_a, uint32_t body_b,
+  ScnJoint *joint)
+{
+  memset(joint, 0, sizeof(*joint));
+  joint->type = (uint32_t)b2Joint_GetType(joint_id);
+  joint->body_a = body_a;
+  joint->body_b = body_b;
+  joint->local_anchor_a = b2Joint_GetLocalAnchorA(joint_id);
+  joint->local_anchor_b = b2Joint_GetLocalAnchorB(joint_id);
+  if (b2Joint_GetCollideConnected(joint_id))
+    joint->flags |= ScnJointFlag_CollideConnected;
+
+  switch (b2Joint_GetType(joint_id)) {
+    case b2_distanceJoint: {
+      if (b2DistanceJoint_IsSpringEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableSpring;
+      if (b2DistanceJoint_IsLimitEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableLimit;
+      if (b2DistanceJoint_IsMotorEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableMotor;
+      joint->length = b2DistanceJoint_GetLength(joint_id);
+      joint->hertz = b2DistanceJoint_GetSpringHertz(joint_id);
+      joint->damping_ratio = b2DistanceJoint_GetSpringDampingRatio(joint_id);
+      joint->lower = b2DistanceJoint_GetMinLength(joint_id);
+      joint->upper = b2DistanceJoint_GetMaxLength(joint_id);
+      joint->motor_speed = b2DistanceJoint_GetMotorSpeed(joint_id);
+      joint->max_motor = b2DistanceJoint_GetMaxMotorForce(joint_id);
+    } break;
+    case b2_motorJoint: {
+      joint->linear_offset = b2MotorJoint_GetLinearOffset(joint_id);
+      joint->reference_angle = b2MotorJoint_GetAngularOffset(joint_id);
+      joint->max_force = b2MotorJoint_GetMaxForce(joint_id);
+      joint->max_torque = b2MotorJoint_GetMaxTorque(joint_id);
+      joint->correction_factor = b2MotorJoint_GetCorrectionFactor(joint_id);
+    } break;
+    case b2_prismaticJoint: {
+      if (b2PrismaticJoint_IsSpringEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableSpring;
+      if (b2PrismaticJoint_IsLimitEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableLimit;
+      if (b2PrismaticJoint_IsMotorEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableMotor;
+      joint->local_axis_a = b2PrismaticJoint_GetLocalAxisA(joint_id);
+      joint->reference_angle = b2PrismaticJoint_GetReferenceAngle(joint_id);
+      joint->hertz = b2PrismaticJoint_GetSpringHertz(joint_id);
+      joint->damping_ratio = b2PrismaticJoint_GetSpringDampingRatio(joint_id);
+      joint->lower = b2PrismaticJoint_GetLowerLimit(joint_id);
+      joint->upper = b2PrismaticJoint_GetUpperLimit(joint_id);
+      joint->motor_speed = b2PrismaticJoint_GetMotorSpeed(joint_id);
+      joint->max_motor = b2PrismaticJoint_GetMaxMotorForce(joint_id);
+    } break;
+    case b2_revoluteJoint: {
+      if (b2RevoluteJoint_IsSpringEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableSpring;
+      if (b2RevoluteJoint_IsLimitEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableLimit;
+      if (b2RevoluteJoint_IsMotorEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableMotor;
+      joint->reference_angle = b2RevoluteJoint_GetReferenceAngle(joint_id);
+      joint->hertz = b2RevoluteJoint_GetSpringHertz(joint_id);
+      joint->damping_ratio = b2RevoluteJoint_GetSpringDampingRatio(joint_id);
+      joint->lower = b2RevoluteJoint_GetLowerLimit(joint_id);
+      joint->upper = b2RevoluteJoint_GetUpperLimit(joint_id);
+      joint->motor_speed = b2RevoluteJoint_GetMotorSpeed(joint_id);
+      joint->max_motor = b2RevoluteJoint_GetMaxMotorTorque(joint_id);
+    } break;
+    case b2_weldJoint: {
+      joint->reference_angle = b2WeldJoint_GetReferenceAngle(joint_id);
+      joint->hertz = b2WeldJoint_GetLinearHertz(joint_id);
+      joint->damping_ratio = b2WeldJoint_GetLinearDampingRatio(joint_id);
+      joint->angular_hertz = b2WeldJoint_GetAngularHertz(joint_id);
+      joint->angular_damping_ratio =
+        b2WeldJoint_GetAngularDampingRatio(joint_id);
+    } break;
+    case b2_wheelJoint: {
+      if (b2WheelJoint_IsSpringEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableSpring;
+      if (b2WheelJoint_IsLimitEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableLimit;
+      if (b2WheelJoint_IsMotorEnabled(joint_id))
+        joint->flags |= ScnJointFlag_EnableMotor;
+      joint->local_axis_a = b2WheelJoint_GetLocalAxisA(joint_id);
+      joint->hertz = b2WheelJoint_GetSpringHertz(joint_id);
+      joint->damping_ratio = b2WheelJoint_GetSpringDampingRatio(joint_id);
+      joint->lower = b2WheelJoint_GetLowerLimit(joint_id);
+      joint->upper = b2WheelJoint_GetUpperLimit(joint_id);
+      joint->motor_speed = b2WheelJoint_GetMotorSpeed(joint_id);
+      joint->max_motor = b2WheelJoint_GetMaxMotorTorque(joint_id);
+    } break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+bool
+scn_save(const char *filename, const ObjStore *objects)
+{
+  assert(filename && objects);
+
+  uint32_t num_objects = obj_count(objects);
+  ScnBody *bodies = NULL;
+  ScnShape *shapes = NULL;
+  ScnJoint *joints = NULL;
+  b2ShapeId *shape_ids = NULL;
+  b2JointId *joint_ids = NULL;
+  uint32_t num_skipped_shapes = 0;
+  uint32_t num_skipped_joints = 0;
+
+  // File index of the body of every object, joints refer to bodies by it.
+  uint32_t *body_indices = M_ALLOC((num_objects + 1) * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < num_objects; ++i) {
+    b2BodyId body_id = *(b2BodyId *)&objects->objects[i].phy_body_id;
+    body_indices[i] = SCN_INVALID_INDEX;
+    if (!b2Body_IsValid(body_id)) continue;
+
+    body_indices[i] = (uint32_t)arrlenu(bodies);
+    arrpush(bodies, ((ScnBody){0}));
+  }
+
+  for (uint32_t i = 0; i < num_objects; ++i) {
+    if (body_indices[i] == SCN_INVALID_INDEX) continue;
+
+    const CgObject *object = &objects->objects[i];
+    b2BodyId body_id = *(b2BodyId *)&object->phy_body_id;
+    ScnBody *body = &bodies[body_indices[i]];
+
+    memset(body, 0, sizeof(*body));
+    body->type = (uint32_t)b2Body_GetType(body_id);
+    if (b2Body_IsSleepEnabled(body_id)) body->flags |= ScnBodyFlag_EnableSleep;
+    if (b2Body_IsAwake(body_id)) body->flags |= ScnBodyFlag_Awake;
+    if (b2Body_IsFixedRotation(body_id))
+      body->flags |= ScnBodyFlag_FixedRotation;
+    if (b2Body_IsBullet(body_id)) body->flags |= ScnBodyFlag_Bullet;
+    if (b2Body_IsEnabled(body_id)) body->flags |= ScnBodyFlag_Enabled;
+    if (b2Body_GetAutomaticMass(body_id))
+      body->flags |= ScnBodyFlag_AutomaticMass;
+
+    body->position = b2Body_GetPosition(body_id);
+    body->rotation = b2Body_GetRotation(body_id);
+    body->linear_velocity = b2Body_GetLinearVelocity(body_id);
+    body->angular_velocity = b2Body_GetAngularVelocity(body_id);
+    body->linear_damping = b2Body_GetLinearDamping(body_id);
+    body->angular_damping = b2Body_GetAngularDamping(body_id);
+    body->gravity_scale = b2Body_GetGravityScale(body_id);
+    body->sleep_threshold = b2Body_GetSleepThreshold(body_id);
+    body->mass_data = b2Body_GetMassData(body_id);
+    body->mesh_index = object->mesh_index;
+    body->texture_index = object->texture_index;
+    body->first_shape = (uint32_t)arrlenu(shapes);
+
+    arrsetlen(shape_ids, b2Body_GetShapeCount(body_id));
+    int num_shape_ids = b2Body_GetShapes(body_id, shape_ids,
+      (int)arrlen(shape_ids));
+
+    for (int s = 0; s < num_shape_ids; ++s) {
+      b2ShapeId shape_id = shape_ids[s];
+      ScnShape shape;
+      memset(&shape, 0, sizeof(shape));
+
+      shape.type = (uint32_t)b2Shape_GetType(shape_id);
+      switch (b2Shape_GetType(shape_id)) {
+        case b2_circleShape: shape.circle = b2Shape_GetCircle(shape_id); break;
+        case b2_capsuleShape:
+          shape.capsule = b2Shape_GetCapsule(shape_id);
+          break;
+        case b2_segmentShape:
+          shape.segment = b2Shape_GetSegment(shape_id);
+          break;
+        case b2_polygonShape:
+          shape.polygon = b2Shape_GetPolygon(shape_id);
+          break;
+        default:
+          // Chain segments are owned by their chain.
+          num_skipped_shapes += 1;
+          continue;
+      }
+
+      if (b2Shape_IsSensor(shape_id)) shape.flags |= ScnShapeFlag_Sensor;
+      if (b2Shape_AreSensorEventsEnabled(shape_id))
+        shape.flags |= ScnShapeFlag_SensorEvents;
+      if (b2Shape_AreContactEventsEnabled(shape_id))
+        shape.flags |= ScnShapeFlag_ContactEvents;
+      if (b2Shape_AreHitEventsEnabled(shape_id))
+        shape.flags |= ScnShapeFlag_HitEvents;
+      if (b2Shape_ArePreSolveEventsEnabled(shape_id))
+        shape.flags |= ScnShapeFlag_PreSolveEvents;
+
+      shape.density = b2Shape_GetDensity(shape_id);
+      shape.friction = b2Shape_GetFriction(shape_id);
+      shape.restitution = b2Shape_GetRestitution(shape_id);
+
+      // Field by field, padding of b2Filter stays zero.
+      b2Filter filter = b2Shape_GetFilter(shape_id);
+      shape.filter.categoryBits = filter.categoryBits;
+      shape.filter.maskBits = filter.maskBits;
+      shape.filter.groupIndex = filter.groupIndex;
+
+      arrpush(shapes, shape);
+    }
+    body->num_shapes = (uint32_t)arrlenu(shapes) - body->first_shape;
+
+    // Every joint is seen from both of its bodies, store it once from body A.
+    arrsetlen(joint_ids, b2Body_GetJointCount(body_id));
+    int num_joint_ids = b2Body_GetJoints(body_id, joint_ids,
+      (int)arrlen(joint_ids));
+
+    for (int j = 0; j < num_joint_ids; ++j) {
+      b2JointId joint_id = joint_ids[j];
+      b2BodyId body_a = b2Joint_GetBodyA(joint_id);
+      if (B2_ID_EQUALS(body_a, body_id) == false) continue;
+
+      uint32_t index_b = find_body_index(objects, body_indices,
+        b2Joint_GetBodyB(joint_id));
+      ScnJoint joint;
+      if (index_b == SCN_INVALID_INDEX ||
+        !save_joint(joint_id, body_indices[i], index_b, &joint))
+      {
+        num_skipped_joints += 1;
+        continue;
+      }
+      arrpush(joints, joint);
+    }
+  }
+  M_FREE(body_indices);
+  arrfree(shape_ids);
+  arrfree(joint_ids);
+
+  if (num_skipped_shapes > 0 || num_skipped_joints > 0) {
+    LOG("[scn] %s: skipped %u unsupported shapes and %u unsupported joints.",
+      filename, num_skipped_shapes, num_skipped_joints);
+  }
+
+  bool ok = false;
+  FILE *file = file_open(filename, "wb");
+  if (file) {
+    ScnHeader header = {
+      .magic = SCN_MAGIC,
+      .version = SCN_VERSION,
+      .num_bodies = (uint32_t)arrlenu(bodies),
+      .num_shapes = (uint32_t)arrlenu(shapes),
+      .num_joints = (uint32_t)arrlenu(joints),
+    };
+    fwrite(&header, sizeof(header), 1, file);
+    if (bodies) fwrite(bodies, sizeof(ScnBody), arrlenu(bodies), file);
+    if (shapes) fwrite(shapes, sizeof(ScnShape), arrlenu(shapes), file);
+    if (joints) fwrite(joints, sizeof(ScnJoint), arrlenu(joints), file);
+    ok = ferror(file) == 0;
+    fclose(file);
+  }
+
+  arrfree(bodies);
+  arrfree(shapes);
+  arrfree(joints);
+  return ok;
+}
+
+static bool
+validate_scene(const ScnHeader *header, size_t size, const ScnLimits *limits)
+{
+  if (size < sizeof(ScnHeader) || header->magic != SCN_MAGIC) return false;
+  if (header->version != SCN_VERSION) return false;
+
+  uint64_t expected = sizeof(ScnHeader) +
+    (uint64_t)header->num_bodies * sizeof(ScnBody) +
+    (uint64_t)header->num_shapes * sizeof(ScnShape) +
+    (uint64_t)header->num_joints * sizeof(ScnJoint);
+  if (expected != size) return false;
+
+  const ScnBody *bodies = (const ScnBody *)(header + 1);
+  const ScnShape *shapes = (const ScnShape *)(bodies + header->num_bodies);
+  const ScnJoint *joints = (const ScnJoint *)(shapes + header->num_shapes);
+
+  for (uint32_t i = 0; i < header->num_bodies; ++i) {
+    if (bodies[i].type > b2_dynamicBody) return false;
+    // Indexed by the renderer and the shaders without further checks.
+    if (limits && bodies[i].mesh_index != limits->invalid_mesh) {
+      if (bodies[i].mesh_index >= limits->num_meshes) return false;
+      if (bodies[i].texture_index < limits->first_texture ||
+        bodies[i].texture_index - limits->first_texture >= limits->num_textures)
+      {
+        return false;
+      }
+    }
+    if (bodies[i].first_shape > header->num_shapes ||
+      bodies[i].num_shapes > header->num_shapes - bodies[i].first_shape)
+    {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->num_shapes; ++i) {
+    if (shapes[i].type == b2_polygonShape &&
+      (shapes[i].polygon.count < 3 ||
+      shapes[i].polygon.count > b2_maxPolygonVertices))
+    {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->num_joints; ++i) {
+    if (joints[i].body_a >= header->num_bodies ||
+      joints[i].body_b >= header->num_bodies)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void
+load_joint(b2WorldId world, const ScnJoint *joint, const b2BodyId *body_ids)
+{
+  b2BodyId body_a = body_ids[joint->body_a];
+  b2BodyId body_b = body_ids[joint->body_b];
+  bool collide_connected = joint->flags & ScnJointFlag_CollideConnected;
+
+  switch ((b2JointType)joint->type) {
+    case b2_distanceJoint: {
+      b2DistanceJointDef def = b2DefaultDistanceJointDef();
+      def.bodyIdA = body_a;
+      def.bodyIdB = body_b;
+      def.localAnchorA = joint->local_anchor_a;
+      def.localAnchorB = joint->local_anchor_b;
+      def.length = joint->length;
+      def.enableSpring = joint->flags & ScnJointFlag_EnableSpring;
+      def.hertz = joint->hertz;
+      def.dampingRatio = joint->damping_ratio;
+      def.enableLimit = joint->flags & ScnJointFlag_EnableLimit;
+      def.minLength = joint->lower;
+      def.maxLength = joint->upper;
+      def.enableMotor = joint->flags & ScnJointFlag_EnableMotor;
+      def.maxMotorForce = joint->max_motor;
+      def.motorSpeed = joint->motor_speed;
+      def.collideConnected = collide_connected;
+      b2CreateDistanceJoint(world, &def);
+    } break;
+    case b2_motorJoint: {
+      b2MotorJointDef def = b2DefaultMotorJointDef();
+      def.bodyIdA = body_a;
+      def.bodyIdB = body_b;
+      def.linearOffset = joint->linear_offset;
+      def.angularOffset = joint->reference_angle;
+      def.maxForce = joint->max_force;
+      def.maxTorque = joint->max_torque;
+      def.correctionFactor = joint->correction_factor;
+      def.collideConnected = collide_connected;
+      b2CreateMotorJoint(world, &def);
+    } break;
+    case b2_prismaticJoint: {
+      b2PrismaticJointDef def = b2DefaultPrismaticJointDef();
+      def.bodyIdA = body_a;
+      def.bodyIdB = body_b;
+      def.localAnchorA = joint->local_anchor_a;
+      def.localAnchorB = joint->local_anchor_b;
+      def.localAxisA = joint->local_axis_a;
+      def.referenceAngle = joint->reference_angle;
+      def.enableSpring = joint->flags & ScnJointFlag_EnableSpring;
+      def.hertz = joint->hertz;
+      def.dampingRatio = joint->damping_ratio;
+      def.enableLimit = joint->flags & ScnJointFlag_EnableLimit;
+      def.lowerTranslation = joint->lower;
+      def.upperTranslation = joint->upper;
+      def.enableMotor = joint->flags & ScnJointFlag_EnableMotor;
+      def.maxMotorForce = joint->max_motor;
+      def.motorSpeed = joint->motor_speed;
+      def.collideConnected = collide_connected;
+      b2CreatePrismaticJoint(world, &def);
+    } break;
+    case b2_revoluteJoint: {
+      b2RevoluteJointDef def = b2DefaultRevoluteJointDef();
+      def.bodyIdA = body_a;
+      def.bodyIdB = body_b;
+      def.localAnchorA = joint->local_anchor_a;
+      def.localAnchorB = joint->local_anchor_b;
+      def.referenceAngle = joint->reference_angle;
+      def.enableSpring = joint->flags & ScnJointFlag_EnableSpring;
+      def.hertz = joint->hertz;
+      def.dampingRatio = joint->damping_ratio;
+      def.enableLimit = joint->flags & ScnJointFlag_EnableLimit;
+      def.lowerAngle = joint->lower;
+      def.upperAngle = joint->upper;
+      def.enableMotor = joint->flags & ScnJointFlag_EnableMotor;
+      def.maxMotorTorque = joint->max_motor;
+      def.motorSpeed = joint->motor_speed;
+      def.collideConnected = collide_connected;
+      b2CreateRevoluteJoint(world, &def);
+    } break;
+    case b2_weldJoint: {
+      b2WeldJointDef def = b2DefaultWeldJointDef();
+      def.bodyIdA = body_a;
+      def.bodyIdB = body_b;
+      def.localAnchorA = joint->local_anchor_a;
+      def.localAnchorB = joint->local_anchor_b;
+      def.referenceAngle = joint->reference_angle;
+      def.linearHertz = joint->hertz;
+      def.linearDampingRatio = joint->damping_ratio;
+      def.angularHertz = joint->angular_hertz;
+      def.angularDampingRatio = joint->angular_damping_ratio;
+      def.collideConnected = collide_connected;
+      b2CreateWeldJoint(world, &def);
+    } break;
+    case b2_wheelJoint: {
+      b2WheelJointDef def = b2DefaultWheelJointDef();
+      def.bodyIdA = body_a;
+      def.bodyIdB = body_b;
+      def.localAnchorA = joint->local_anchor_a;
+      def.localAnchorB = joint->local_anchor_b;
+      def.localAxisA = joint->local_axis_a;
+      def.enableSpring = joint->flags & ScnJointFlag_EnableSpring;
+      def.hertz = joint->hertz;
+      def.dampingRatio = joint->damping_ratio;
+      def.enableLimit = joint->flags & ScnJointFlag_EnableLimit;
+      def.lowerTranslation = joint->lower;
+      def.upperTranslation = joint->upper;
+      def.enableMotor = joint->flags & ScnJointFlag_EnableMotor;
+      def.maxMotorTorque = joint->max_motor;
+      def.motorSpeed = joint->motor_speed;
+      def.collideConnected = collide_connected;
+      b2CreateWheelJoint(world, &def);
+    } break;
+    default:
+      LOG("[scn] Unsupported joint type %u.", joint->type);
+      break;
+  }
+}
+
+bool
+scn_open(ScnFile *file, const char *filename, const ScnLimits *limits)
+{
+  assert(file && filename);
+  *file = (ScnFile){0};
+
+  size_t size = 0;
+  const ScnHeader *header = map_file(filename, &size);
+  if (header == NULL) {
+    LOG("[scn] Failed to map %s.", filename);
+    return false;
+  }
+  if (!validate_scene(header, size, limits)) {
+    LOG("[scn] %s is not a valid scene (version %u expected, mesh and "
+      "texture indices within the limits).", filename, SCN_VERSION);
+    unmap_file(header, size);
+    return false;
+  }
+
+  *file = (ScnFile){ .header = header, .size = size };
+  return true;
+}
+
+void
+scn_close(ScnFile *file)
+{
+  assert(file);
+  if (file->header) unmap_file(file->header, file->size);
+  *file = (ScnFile){0};
+}
+
+void
+scn_create(const ScnFile *file, b2WorldId world, ObjStore *objects)
+{
+  assert(file && file->header && objects);
+
+  const ScnHeader *header = file->header;
+  const ScnBody *bodies = (const ScnBody *)(header + 1);
+  const ScnShape *shapes = (const ScnShape *)(bodies + header->num_bodies);
+  const ScnJoint *joints = (const ScnJoint *)(shapes + header->num_shapes);
+
+  b2BodyId *body_ids = M_ALLOC((header->num_bodies + 1) * sizeof(b2BodyId));
+
+  for (uint32_t i = 0; i < header->num_bodies; ++i) {
+    const ScnBody *body = &bodies[i];
+
+    CgObject *object;
+    ObjHandle handle = obj_create(objects, &object);
+
+    b2BodyDef body_def = b2DefaultBodyDef();
+    body_def.type = (b2BodyType)body->type;
+    body_def.position = body->position;
+    body_def.rotation = body->rotation;
+    body_def.linearVelocity = body->linear_velocity;
+    body_def.angularVelocity = body->angular_velocity;
+    body_def.linearDamping = body->linear_damping;
+    body_def.angularDamping = body->angular_damping;
+    body_def.gravityScale = body->gravity_scale;
+    body_def.sleepThreshold = body->sleep_threshold;
+    body_def.userData = obj_handle_to_ptr(handle);
+    body_def.enableSleep = body->flags & ScnBodyFlag_EnableSleep;
+    body_def.isAwake = body->flags & ScnBodyFlag_Awake;
+    body_def.fixedRotation = body->flags & ScnBodyFlag_FixedRotation;
+    body_def.isBullet = body->flags & ScnBodyFlag_Bullet;
+    body_def.isEnabled = body->flags & ScnBodyFlag_Enabled;
+    // Mass is computed once after all shapes are added, not per shape.
+    body_def.automaticMass = false;
+    b2BodyId body_id = b2CreateBody(world, &body_def);
+    body_ids[i] = body_id;
+
+    for (uint32_t s = 0; s < body->num_shapes; ++s) {
+      const ScnShape *shape = &shapes[body->first_shape + s];
+
+      b2ShapeDef shape_def = b2DefaultShapeDef();
+      shape_def.density = shape->density;
+      shape_def.friction = shape->friction;
+      shape_def.restitution = shape->restitution;
+      shape_def.filter = shape->filter;
+      shape_def.isSensor = shape->flags & ScnShapeFlag_Sensor;
+      shape_def.enableSensorEvents = shape->flags & ScnShapeFlag_SensorEvents;
+      shape_def.enableContactEvents = shape->flags & ScnShapeFlag_ContactEvents;
+      shape_def.enableHitEvents = shape->flags & ScnShapeFlag_HitEvents;
+      shape_def.enablePreSolveEvents =
+        shape->flags & ScnShapeFlag_PreSolveEvents;
+
+      switch ((b2ShapeType)shape->type) {
+        case b2_circleShape:
+          b2CreateCircleShape(body_id, &shape_def, &shape->circle);
+          break;
+        case b2_capsuleShape:
+          b2CreateCapsuleShape(body_id, &shape_def, &shape->capsule);
+          break;
+        case b2_segmentShape:
+          b2CreateSegmentShape(body_id, &shape_def, &shape->segment);
+          break;
+        case b2_polygonShape:
+          b2CreatePolygonShape(body_id, &shape_def, &shape->polygon);
+          break;
+        default:
+          LOG("[scn] Unsupported shape type %u.", shape->type);
+          break;
+      }
+    }
+
+    // Also computes the extents used by continuous collision, so it's needed
+    // even when the stored mass data overrides the mass afterwards.
+    b2Body_ApplyMassFromShapes(body_id);
+    if (body->flags & ScnBodyFlag_AutomaticMass) {
+      b2Body_SetAutomaticMass(body_id, true);
+    } else {
+      b2Body_SetMassData(body_id, body->mass_data);
+    }
+
+    *object = (CgObject){
+      .position = { body->position.x, body->position.y },
+      .rotation = { body->rotation.c, body->rotation.s },
+      .mesh_index = body->mesh_index,
+      .texture_index = body->texture_index,
+      .phy_body_id = *(uint64_t *)&body_id,
+    };
+  }
+
+  for (uint32_t i = 0; i < header->num_joints; ++i) {
+    load_joint(world, &joints[i], body_ids);
+  }
+
+  M_FREE(body_ids);
+}
+
+bool
+scn_load(const char *filename, const ScnLimits *limits, b2WorldId world,
+  ObjStore *objects)
+{
+  assert(filename && objects);
+
+  ScnFile file;
+  if (!scn_open(&file, filename, limits)) return false;
+
+  scn_create(&file, world, objects);
+  scn_close(&file);
+  return true;
+}
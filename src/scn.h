@@ -0,0 +1,152 @@
+#pragma once
+
+//
+// Binary scene file: header followed by tightly packed arrays of bodies,
+// shapes and joints. Records are stored as they are in memory (little-endian,
+// box2d geometry types included), loading maps the file and creates
+// everything in one pass without parsing. Bump SCN_VERSION on any change.
+//
+
+#define SCN_MAGIC 0x43534743 // "CGSC"
+#define SCN_VERSION 2
+
+typedef struct ObjStore ObjStore;
+
+typedef struct ScnHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_bodies;
+  uint32_t num_shapes;
+  uint32_t num_joints;
+  uint32_t _reserved[3];
+} ScnHeader;
+
+typedef enum ScnBodyFlag
+{
+  ScnBodyFlag_EnableSleep = 0x1,
+  ScnBodyFlag_Awake = 0x2,
+  ScnBodyFlag_FixedRotation = 0x4,
+  ScnBodyFlag_Bullet = 0x8,
+  ScnBodyFlag_Enabled = 0x10,
+  ScnBodyFlag_AutomaticMass = 0x20,
+} ScnBodyFlag;
+
+typedef struct ScnBody
+{
+  uint32_t type; // b2BodyType
+  uint32_t flags; // ScnBodyFlag
+  b2Vec2 position;
+  b2Rot rotation;
+  b2Vec2 linear_velocity;
+  float angular_velocity;
+  float linear_damping;
+  float angular_damping;
+  float gravity_scale;
+  float sleep_threshold;
+  b2MassData mass_data; // used when automatic mass is disabled
+  uint32_t first_shape; // shapes of a body are contiguous
+  uint32_t num_shapes;
+  uint32_t mesh_index; // CgObject bindings
+  uint32_t texture_index;
+  uint32_t _pad;
+} ScnBody;
+
+typedef enum ScnShapeFlag
+{
+  ScnShapeFlag_Sensor = 0x1,
+  ScnShapeFlag_SensorEvents = 0x2,
+  ScnShapeFlag_ContactEvents = 0x4,
+  ScnShapeFlag_HitEvents = 0x8,
+  ScnShapeFlag_PreSolveEvents = 0x10,
+} ScnShapeFlag;
+
+typedef struct ScnShape
+{
+  uint32_t type; // b2ShapeType
+  uint32_t flags; // ScnShapeFlag
+  float density;
+  float friction;
+  float restitution;
+  uint32_t _pad;
+  b2Filter filter;
+  union {
+    b2Circle circle;
+    b2Capsule capsule;
+    b2Segment segment;
+    b2Polygon polygon;
+  };
+} ScnShape;
+
+typedef enum ScnJointFlag
+{
+  ScnJointFlag_CollideConnected = 0x1,
+  ScnJointFlag_EnableSpring = 0x2,
+  ScnJointFlag_EnableLimit = 0x4,
+  ScnJointFlag_EnableMotor = 0x8,
+} ScnJointFlag;
+
+// Distance, motor, prismatic, revolute, weld and wheel joints.
+typedef struct ScnJoint
+{
+  uint32_t type; // b2JointType
+  uint32_t flags; // ScnJointFlag
+  uint32_t body_a; // index of the body in the file
+  uint32_t body_b;
+  b2Vec2 local_anchor_a;
+  b2Vec2 local_anchor_b;
+  b2Vec2 local_axis_a; // prismatic, wheel
+  float reference_angle; // prismatic, revolute, weld; motor: angular offset
+  float hertz; // spring; linear spring of weld joint
+  float damping_ratio;
+  float angular_hertz; // weld
+  float angular_damping_ratio; // weld
+  float length; // distance
+  float lower; // distance: min length, revolute: angle, else translation
+  float upper;
+  float motor_speed;
+  float max_motor; // force or torque
+  b2Vec2 linear_offset; // motor joint
+  float max_force; // motor joint
+  float max_torque; // motor joint
+  float correction_factor; // motor joint
+  uint32_t _pad;
+} ScnJoint;
+
+// Object bindings a scene may refer to. Bodies with `mesh_index` equal to
+// `invalid_mesh` are not drawn and their texture is not checked, the others
+// need `mesh_index < num_meshes` and a `texture_index` in
+// [first_texture, first_texture + num_textures).
+typedef struct ScnLimits
+{
+  uint32_t num_meshes;
+  uint32_t invalid_mesh;
+  uint32_t first_texture;
+  uint32_t num_textures;
+} ScnLimits;
+
+// Scene file mapped and validated by `scn_open()`.
+typedef struct ScnFile
+{
+  const ScnHeader *header;
+  size_t size;
+} ScnFile;
+
+/// Writes bodies of all objects in `objects`, their shapes and the joints
+/// between them.
+bool scn_save(const char *filename, const ObjStore *objects);
+
+/// Maps the file and validates it. Returns false (and logs why) when the
+/// file can't be mapped, is not a valid scene of this version or binds
+/// meshes and textures outside `limits`, nothing is created then, so
+/// callers can keep their current scene. NULL `limits` leaves the bindings
+/// unchecked, for callers that don't draw the objects.
+bool scn_open(ScnFile *file, const char *filename, const ScnLimits *limits);
+void scn_close(ScnFile *file);
+
+/// Creates an object with a body for every body of an opened file.
+void scn_create(const ScnFile *file, b2WorldId world, ObjStore *objects);
+
+/// `scn_open()`, `scn_create()` and `scn_close()` in one go.
+bool scn_load(const char *filename, const ScnLimits *limits, b2WorldId world,
+  ObjStore *objects);
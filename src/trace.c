@@ -0,0 +1,255 @@
+#include "pch.h"
+#include "trace.h"
+
+typedef struct TraceEvent
+{
+  const char *name; // string literal
+  uint64_t begin; // ns since `trace_init()`
+  uint64_t end;
+} TraceEvent;
+
+// Written by its thread only.
+typedef struct TraceRing
+{
+  TraceEvent *events; // `capacity` entries, power of two
+  atomic_uint_fast64_t num_written; // head is this modulo capacity
+  char thread_name[32];
+
+  // Zones not ended yet, innermost last. Deeper zones are counted but not
+  // recorded.
+  const char *open_names[TRACE_MAX_DEPTH];
+  uint64_t open_begins[TRACE_MAX_DEPTH];
+  int32_t depth;
+} TraceRing;
+
+// Marks a zone merged into the task zone it named, see `trace_begin_task()`.
+static const char trace_merged[] = "";
+
+static struct
+{
+  TraceRing rings[TRACE_MAX_THREADS];
+  atomic_uint num_rings;
+  uint32_t capacity;
+  uint32_t generation; // bumped by init, drops rings of a previous session
+  uint64_t epoch;
+  bool enabled;
+} g_trace;
+
+static _Thread_local TraceRing *t_ring;
+static _Thread_local uint32_t t_generation;
+
+static uint64_t
+trace_now(void)
+{
+#if defined(_WIN32)
+  static double ns_per_tick;
+  LARGE_INTEGER counter;
+  if (ns_per_tick == 0.0) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    ns_per_tick = 1e9 / (double)frequency.QuadPart;
+  }
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)((double)counter.QuadPart * ns_per_tick);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Ring of the calling thread, claimed by its first zone. NULL when all rings
+// are taken.
+static TraceRing *
+trace_get_ring(void)
+{
+  if (t_generation == g_trace.generation) return t_ring;
+  t_generation = g_trace.generation;
+
+  uint32_t index = atomic_fetch_add(&g_trace.num_rings, 1);
+  if (index >= TRACE_MAX_THREADS) {
+    t_ring = NULL;
+    return NULL;
+  }
+
+  TraceRing *ring = &g_trace.rings[index];
+  ring->events = M_ALLOC(g_trace.capacity * sizeof(TraceEvent));
+  snprintf(ring->thread_name, sizeof(ring->thread_name), "thread %u", index);
+  t_ring = ring;
+  return ring;
+}
+
+static void
+trace_b2_begin(const char *name)
+{
+  trace_begin(name);
+}
+
+static void
+trace_b2_end(void)
+{
+  trace_end();
+}
+
+void
+trace_init(uint32_t events_per_thread)
+{
+  assert(!g_trace.enabled);
+
+  uint32_t capacity = events_per_thread > 0 ?
+    events_per_thread : TRACE_DEFAULT_EVENTS_PER_THREAD;
+  g_trace.capacity = 1;
+  while (g_trace.capacity < capacity) g_trace.capacity *= 2;
+
+  atomic_store(&g_trace.num_rings, 0);
+  g_trace.generation += 1;
+  g_trace.epoch = trace_now();
+  g_trace.enabled = true;
+
+  b2SetTraceFcns(trace_b2_begin, trace_b2_end);
+}
+
+void
+trace_deinit(void)
+{
+  if (!g_trace.enabled) return;
+
+  b2SetTraceFcns(NULL, NULL);
+  g_trace.enabled = false;
+
+  uint32_t num_rings = atomic_load(&g_trace.num_rings);
+  if (num_rings > TRACE_MAX_THREADS) num_rings = TRACE_MAX_THREADS;
+  for (uint32_t i = 0; i < num_rings; ++i) {
+    M_FREE(g_trace.rings[i].events);
+    g_trace.rings[i] = (TraceRing){0};
+  }
+  atomic_store(&g_trace.num_rings, 0);
+}
+
+bool
+trace_is_enabled(void)
+{
+  return g_trace.enabled;
+}
+
+void
+trace_name_thread(const char *name, int32_t number)
+{
+  assert(name);
+  if (!g_trace.enabled) return;
+
+  TraceRing *ring = trace_get_ring();
+  if (ring == NULL) return;
+  if (number >= 0) {
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "%s %d", name,
+      number);
+  } else {
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", name);
+  }
+}
+
+void
+trace_begin(const char *name)
+{
+  if (!g_trace.enabled) return;
+
+  TraceRing *ring = trace_get_ring();
+  if (ring == NULL) return;
+
+  int32_t depth = ring->depth++;
+  if (depth >= TRACE_MAX_DEPTH) return;
+
+  // The first zone of a task names it and is not recorded on its own.
+  if (depth > 0 && ring->open_names[depth - 1] == NULL) {
+    ring->open_names[depth - 1] = name;
+    ring->open_names[depth] = trace_merged;
+    return;
+  }
+  ring->open_names[depth] = name;
+  ring->open_begins[depth] = trace_now();
+}
+
+void
+trace_begin_task(void)
+{
+  if (!g_trace.enabled) return;
+
+  TraceRing *ring = trace_get_ring();
+  if (ring == NULL) return;
+
+  int32_t depth = ring->depth++;
+  if (depth >= TRACE_MAX_DEPTH) return;
+
+  ring->open_names[depth] = NULL;
+  ring->open_begins[depth] = trace_now();
+}
+
+void
+trace_end(void)
+{
+  if (!g_trace.enabled) return;
+
+  TraceRing *ring = trace_get_ring();
+  if (ring == NULL) return;
+
+  assert(ring->depth > 0);
+  int32_t depth = --ring->depth;
+  if (depth >= TRACE_MAX_DEPTH) return;
+
+  const char *name = ring->open_names[depth];
+  if (name == trace_merged) return;
+
+  uint64_t index = atomic_load_explicit(&ring->num_written,
+    memory_order_relaxed);
+  ring->events[index & (g_trace.capacity - 1)] = (TraceEvent){
+    .name = name ? name : "Task",
+    .begin = ring->open_begins[depth] - g_trace.epoch,
+    .end = trace_now() - g_trace.epoch,
+  };
+  // Publishes the zone to `trace_export_json()`.
+  atomic_store_explicit(&ring->num_written, index + 1, memory_order_release);
+}
+
+bool
+trace_export_json(const char *filename)
+{
+  assert(filename);
+
+  FILE *file = file_open(filename, "wb");
+  if (file == NULL) return false;
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+  uint32_t num_rings = atomic_load(&g_trace.num_rings);
+  if (num_rings > TRACE_MAX_THREADS) num_rings = TRACE_MAX_THREADS;
+  if (!g_trace.enabled) num_rings = 0;
+
+  bool first_event = true;
+  for (uint32_t r = 0; r < num_rings; ++r) {
+    const TraceRing *ring = &g_trace.rings[r];
+
+    fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+      "\"tid\": %u, \"args\": {\"name\": \"%s\"}}", first_event ? "" : ",\n",
+      r, ring->thread_name);
+    fprintf(file, ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", "
+      "\"pid\": 0, \"tid\": %u, \"args\": {\"sort_index\": %u}}", r, r);
+    first_event = false;
+
+    uint64_t num_written = atomic_load_explicit(
+      (atomic_uint_fast64_t *)&ring->num_written, memory_order_acquire);
+    uint64_t first = num_written > g_trace.capacity ?
+      num_written - g_trace.capacity : 0;
+
+    for (uint64_t i = first; i < num_written; ++i) {
+      const TraceEvent *e = &ring->events[i & (g_trace.capacity - 1)];
+      fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, "
+        "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", e->name, r,
+        (double)e->begin / 1000.0, (double)(e->end - e->begin) / 1000.0);
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+//
+// Timeline of named zones on every thread, exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Each thread writes complete zones to
+// its own ring buffer without locks, old zones are overwritten. Box2d stages
+// and tasks arrive through `b2SetTraceFcns()`, enkiTS waits through the
+// scheduler profiler callbacks (see `phy_init()`).
+//
+
+#define TRACE_DEFAULT_EVENTS_PER_THREAD (1 << 16)
+#define TRACE_MAX_THREADS 64
+#define TRACE_MAX_DEPTH 32
+
+/// Starts recording, rings of `events_per_thread` zones (0 selects
+/// TRACE_DEFAULT_EVENTS_PER_THREAD) are allocated by the first zone of every
+/// thread. Call before `phy_init()` so it installs the scheduler callbacks.
+void trace_init(uint32_t events_per_thread);
+/// Stops recording and frees the rings. Schedulers must be destroyed first.
+void trace_deinit(void);
+bool trace_is_enabled(void);
+
+/// Names the row of the calling thread, e.g. "worker 3". A negative `number`
+/// is left out.
+void trace_name_thread(const char *name, int32_t number);
+
+void trace_begin(const char *name);
+void trace_end(void);
+
+/// Zone of a task whose work is named by the first zone opened inside it,
+/// e.g. the box2d stage of a `b2TaskCallback`. Ended by `trace_end()`.
+void trace_begin_task(void);
+
+/// Writes the zones in the rings to `filename`. Zones written while the
+/// export runs may be torn, export between steps.
+bool trace_export_json(const char *filename);